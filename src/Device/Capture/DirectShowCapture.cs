@@ -46,6 +46,7 @@ using DShowNET.Device;
 
 using GoblinXNA;
 using GoblinXNA.Device;
+using GoblinXNA.Device.Vision;
 
 namespace GoblinXNA.Device.Capture
 {
@@ -289,87 +290,40 @@ namespace GoblinXNA.Device.Capture
                 if (imageReadyCallback != null)
                     replaceBackground = imageReadyCallback(grabbedImage, returnImage);
 
-                int stride = 0;
-                int srcStride = 0;
-
-                if ((returnImage != null) && !replaceBackground)
-                {
-                    srcStride = cameraWidth * 4;
-                    int index = 0;
-                    unsafe
-                    {
-                        byte* src = (byte*)(new IntPtr(grabbedImage.ToInt32() +
-                                    (cameraHeight - 1) * srcStride));
-                        for (int i = 0; i < cameraHeight; i++)
-                        {
-                            for (int j = 0; j < srcStride; j += 4)
-                            {
-                                returnImage[index++] = (int)((*(src + j) << 16) | (*(src + j + 1) << 8) | *(src + j + 2));
-                            }
-
-                            src -= srcStride;
-                        }
-                    }
-                }
-
+                // check the tracker format before converting anything; the texture array is
+                // skipped if the callback already filled it
+                int trackerFormat = -1;
                 if (imagePtr != IntPtr.Zero)
                 {
                     switch (format)
                     {
+                        // this class has always written both 24-bit formats in the same byte order
                         case ImageFormat.R8G8B8_24:
                         case ImageFormat.B8G8R8_24:
-                            stride = cameraWidth * 3;
-                            srcStride = cameraWidth * 4;
-
-                            unsafe
-                            {
-                                byte* src = (byte*)(new IntPtr(grabbedImage.ToInt32() +
-                                    (cameraHeight - 1) * srcStride));
-                                byte* dst = (byte*)imagePtr;
-                                for (int i = 0; i < cameraHeight; i++)
-                                {
-                                    for (int j = 0, k = 0; j < stride; j += 3, k += 4)
-                                    {
-                                        *(dst + j) = *(src + k + 2);
-                                        *(dst + j + 1) = *(src + k + 1);
-                                        *(dst + j + 2) = *(src + k + 0);
-                                    }
-
-                                    src -= srcStride;
-                                    dst += stride;
-                                }
-                            }
+                            trackerFormat = (int)ImageFormat.B8G8R8_24;
                             break;
                         case ImageFormat.B8G8R8A8_32:
-                            //imagePtr = grabbedImage;
-                            stride = cameraWidth * 4;
-                            srcStride = cameraWidth * 4;
-
-                            unsafe
-                            {
-                                byte* src = (byte*)(new IntPtr(grabbedImage.ToInt32() +
-                                    (cameraHeight - 1) * srcStride));
-                                byte* dst = (byte*)imagePtr;
-                                for (int i = 0; i < cameraHeight; i++)
-                                {
-                                    for (int j = 0, k = 0; j < stride; j += 4, k += 4)
-                                    {
-                                        *(dst + j) = *(src + k + 2);
-                                        *(dst + j + 1) = *(src + k + 1);
-                                        *(dst + j + 2) = *(src + k + 0);
-                                    }
-
-                                    src -= srcStride;
-                                    dst += stride;
-                                }
-                            }
+                            trackerFormat = (int)ImageFormat.B8G8R8A8_32;
                             break;
                         default:
                             throw new GoblinException("Format: " + format.ToString() + " is not supported " +
-                                "by DirectShowCapture2");
+                                "by DirectShowCapture");
                     }
                 }
 
+                int[] textureImage = replaceBackground ? null : returnImage;
+
+                // convert the BGRX sample, that is bottom to top, to the tracker and texture
+                // formats, that are top to bottom, in a single native pass
+                if ((trackerFormat >= 0) || (textureImage != null))
+                {
+                    int srcStride = cameraWidth * 4;
+                    IntPtr lastRow = new IntPtr(grabbedImage.ToInt64() + (long)(cameraHeight - 1) * srcStride);
+                    ALVARDllBridge.alvar_convert_frame(lastRow, -srcStride, 4, cameraWidth, cameraHeight,
+                        (trackerFormat >= 0) ? trackerFormat : (int)ImageFormat.B8G8R8_24,
+                        (trackerFormat >= 0) ? imagePtr : IntPtr.Zero, textureImage);
+                }
+
                 processing = false;
             }
             else
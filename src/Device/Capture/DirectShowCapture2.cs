@@ -40,6 +40,8 @@ using System.Windows.Forms;
 
 using Microsoft.Xna.Framework.Graphics;
 
+using GoblinXNA.Device.Vision;
+
 // Reference for the DirectShow Library for C# originally from
 // http://www.codeproject.com/cs/media/directxcapture.asp
 // Update of this original library with capability of capture individual frame from
@@ -307,13 +309,11 @@ namespace GoblinXNA.Device.Capture
 
                 // convert the Bitmap pixel format, that is right to left and
                 // bottom to top, to artag pixel format, that is right to left and
-                // top to bottom
-                if ((imagePtr != IntPtr.Zero) && (returnImage != null))
-                    ReadBmpData(data, imagePtr, returnImage, image.Width, image.Height);
-                else if (imagePtr != IntPtr.Zero)
-                    ReadBmpData(data, imagePtr, image.Width, image.Height);
-                else if (returnImage != null)
-                    ReadBmpData(data, returnImage, image.Width, image.Height);
+                // top to bottom. Both the tracker image and the texture are produced
+                // in a single native pass.
+                if ((imagePtr != IntPtr.Zero) || (returnImage != null))
+                    ALVARDllBridge.alvar_convert_frame(data.Scan0, data.Stride, 3, image.Width, image.Height,
+                        (int)format, imagePtr, returnImage);
 
                 image.UnlockBits(data);
 
@@ -402,206 +402,6 @@ namespace GoblinXNA.Device.Capture
 
         #region Private Methods
 
-        /// <summary>
-        /// A helper function that extracts the image pixels stored in Bitmap instance to an array
-        /// of integers as well as copy them to the memory location pointed by 'cam_image'.
-        /// </summary>
-        /// <param name="bmpDataSource"></param>
-        /// <param name="cam_image"></param>
-        /// <param name="imageData"></param>
-        /// <param name="width"></param>
-        /// <param name="height"></param>
-        private void ReadBmpData(BitmapData bmpDataSource, IntPtr cam_image, int[] imageData, int width,
-            int height)
-        {
-            unsafe
-            {
-                byte* src = (byte*)bmpDataSource.Scan0;
-                byte* dst = (byte*)cam_image;
-                int R = 0, G = 0, B = 0, A = 0;
-                switch (format)
-                {
-                    case ImageFormat.GRAYSCALE_8:
-                        break;
-                    case ImageFormat.R5G6B5_16:
-                        for (int i = 0; i < height; i++)
-                        {
-                            for (int j = 0, k = 0; j < width * 3; j += 3, k += 2)
-                            {
-                                *(dst + k) = (byte)((*(src + j) & 0xF8) | (*(src + j + 1) >> 5));
-                                *(dst + k + 1) = (byte)(((*(src + j + 1) & 0x1C) << 3) |
-                                    ((*(src + j + 2) & 0xF8) >> 3));
-
-                                imageData[i * width + j / 3] = (*(src + j + 2) << 16) |
-                                    (*(src + j + 1) << 8) | *(src + j);
-                            }
-
-                            src -= (width * 3);
-                            dst += (width * 2);
-                        }
-                        break;
-                    case ImageFormat.B8G8R8_24:
-                    case ImageFormat.R8G8B8_24:
-                        if (format == ImageFormat.B8G8R8_24)
-                        {
-                            R = 2; G = 1; B = 0;
-                        }
-                        else
-                        {
-                            R = 0; G = 1; B = 2;
-                        }
-
-                        for (int i = 0; i < height; i++)
-                        {
-                            for (int j = 0; j < width * 3; j += 3)
-                            {
-                                *(dst + j) = *(src + j + R);
-                                *(dst + j + 1) = *(src + j + G);
-                                *(dst + j + 2) = *(src + j + B);
-
-                                imageData[i * width + j / 3] = (*(src + j) << 16) |
-                                    (*(src + j + 1) << 8) | *(src + j + 2);
-                            }
-
-                            src -= (width * 3);
-                            dst += (width * 3);
-                        }
-                        break;
-                    case ImageFormat.A8B8G8R8_32:
-                    case ImageFormat.B8G8R8A8_32:
-                    case ImageFormat.R8G8B8A8_32:
-                        if (format == ImageFormat.A8B8G8R8_32)
-                        {
-                            A = 0; B = 1; G = 2; R = 3;
-                        }
-                        else if (format == ImageFormat.B8G8R8A8_32)
-                        {
-                            B = 0; G = 1; R = 2; A = 3;
-                        }
-                        else
-                        {
-                            R = 0; G = 1; B = 2; A = 3;
-                        }
-
-                        for (int i = 0; i < height; i++)
-                        {
-                            for (int j = 0, k = 0; j < width * 3; j += 3, k += 4)
-                            {
-                                *(dst + k + R) = *(src + j);
-                                *(dst + k + G) = *(src + j + 1);
-                                *(dst + k + B) = *(src + j + 2);
-                                *(dst + k + A) = (byte)255;
-
-                                imageData[i * width + j / 3] = (*(src + j + 2) << 16) |
-                                    (*(src + j + 1) << 8) | *(src + j);
-                            }
-
-                            src -= (width * 3);
-                            dst += (width * 4);
-                        }
-                        break;
-                }
-            }
-        }
-
-        private void ReadBmpData(BitmapData bmpDataSource, int[] imageData, int width, int height)
-        {
-            unsafe
-            {
-                byte* src = (byte*)bmpDataSource.Scan0;
-                for (int i = 0; i < height; i++)
-                {
-                    for (int j = 0; j < width * 3; j += 3)
-                    {
-                        imageData[i * width + j / 3] = (*(src + j) << 16) |
-                            (*(src + j + 1) << 8) | *(src + j + 2);
-                    }
-                    src -= (width * 3);
-                }
-            }
-        }
-
-        private void ReadBmpData(BitmapData bmpDataSource, IntPtr cam_image, int width, int height)
-        {
-            unsafe
-            {
-                byte* src = (byte*)bmpDataSource.Scan0;
-                byte* dst = (byte*)cam_image;
-                int R = 0, G = 0, B = 0, A = 0;
-                switch (format)
-                {
-                    case ImageFormat.R5G6B5_16:
-                        for (int i = 0; i < height; i++)
-                        {
-                            for (int j = 0, k = 0; j < width * 3; j += 3, k += 2)
-                            {
-                                *(dst + k) = (byte)((*(src + j) & 0xF8) | (*(src + j + 1) >> 5));
-                                *(dst + k + 1) = (byte)(((*(src + j + 1) & 0x1C) << 3) |
-                                    ((*(src + j + 2) & 0xF8) >> 3));
-                            }
-
-                            src -= (width * 3);
-                            dst += (width * 2);
-                        }
-                        break;
-                    case ImageFormat.B8G8R8_24:
-                    case ImageFormat.R8G8B8_24:
-                        if (format == ImageFormat.B8G8R8_24)
-                        {
-                            R = 2; G = 1; B = 0;
-                        }
-                        else
-                        {
-                            R = 0; G = 1; B = 2;
-                        }
-
-                        for (int i = 0; i < height; i++)
-                        {
-                            for (int j = 0; j < width * 3; j += 3)
-                            {
-                                *(dst + j) = *(src + j + R);
-                                *(dst + j + 1) = *(src + j + G);
-                                *(dst + j + 2) = *(src + j + B);
-                            }
-
-                            src -= (width * 3);
-                            dst += (width * 3);
-                        }
-                        break;
-                    case ImageFormat.A8B8G8R8_32:
-                    case ImageFormat.B8G8R8A8_32:
-                    case ImageFormat.R8G8B8A8_32:
-                        if (format == ImageFormat.A8B8G8R8_32)
-                        {
-                            A = 0; B = 1; G = 2; R = 3;
-                        }
-                        else if (format == ImageFormat.B8G8R8A8_32)
-                        {
-                            B = 0; G = 1; R = 2; A = 3;
-                        }
-                        else
-                        {
-                            R = 0; G = 1; B = 2; A = 3;
-                        }
-
-                        for (int i = 0; i < height; i++)
-                        {
-                            for (int j = 0, k = 0; j < width * 3; j += 3, k += 4)
-                            {
-                                *(dst + k + R) = *(src + j);
-                                *(dst + k + G) = *(src + j + 1);
-                                *(dst + k + B) = *(src + j + 2);
-                                *(dst + k + A) = (byte)255;
-                            }
-
-                            src -= (width * 3);
-                            dst += (width * 4);
-                        }
-                        break;
-                }
-            }
-        }
-
         /// <summary>
         /// Assigns the video image returned by the DirectShow library to a temporary Bitmap holder.
         /// </summary>
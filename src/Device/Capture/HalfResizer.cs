@@ -37,6 +37,10 @@ using System.Text;
 
 using Microsoft.Xna.Framework;
 
+#if WINDOWS
+using GoblinXNA.Device.Vision;
+#endif
+
 namespace GoblinXNA.Device.Capture
 {
     /// <summary>
@@ -77,8 +81,18 @@ namespace GoblinXNA.Device.Capture
         {
             int newWidth = (int)(origSize.X * scale);
             int newHeight = (int)(origSize.Y * scale);
+
+            // Averages each 2x2 block instead of picking every other pixel, which keeps
+            // marker edges from aliasing. Packed 16-bit pixels (R5G6B5) can not be averaged
+            // byte by byte, so they are still point sampled.
+            if (bpp != 2)
+            {
+                ALVARDllBridge.alvar_resize_image(origImagePtr, (int)origSize.X, (int)origSize.Y, bpp,
+                    resizedImagePtr, newWidth, newHeight);
+                return;
+            }
+
             int srcStride = (int)(origSize.X * bpp);
-            int dstStride = (int)(newWidth * bpp);
             int incr = 2 * bpp;
 
             unsafe
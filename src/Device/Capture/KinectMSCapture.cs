@@ -45,6 +45,14 @@ using Microsoft.Kinect;
 
 namespace GoblinXNA.Device.Capture
 {
+    /// <summary>
+    /// A callback function that is called when a new depth frame arrives. The array is reused for
+    /// every frame, so copy it if it needs to be kept.
+    /// </summary>
+    /// <param name="depthData">The raw depth pixels, with the depth in millimeters in the upper 13
+    /// bits and the player index in the lower 3 bits</param>
+    public delegate void DepthReadyCallback(short[] depthData);
+
     /// <summary>
     /// An implementation of IVideoCapture for Kinect depth camera. This implementation uses
     /// Microsoft Kinect SDK.
@@ -74,6 +82,8 @@ namespace GoblinXNA.Device.Capture
         private bool copyingRawVideo = false;
 
         private bool depthStreamEnabled;
+        private short[] depthData;
+        private DepthReadyCallback depthReadyCallback;
 
         #endregion
 
@@ -149,6 +159,15 @@ namespace GoblinXNA.Device.Capture
             set { imageReadyCallback = value; }
         }
 
+        /// <summary>
+        /// Sets the callback function that is called with every depth frame. Only used if the
+        /// depth stream is enabled.
+        /// </summary>
+        public DepthReadyCallback DepthCallback
+        {
+            set { depthReadyCallback = value; }
+        }
+
         public KinectSensor Sensor
         {
             get { return sensor; }
@@ -214,6 +233,8 @@ namespace GoblinXNA.Device.Capture
                       select sensorToCheck).ElementAtOrDefault(videoDeviceID);
 
             sensor.ColorStream.Enable(colorFormat);
+            if (depthStreamEnabled)
+                sensor.DepthStream.Enable(DepthImageFormat.Resolution640x480Fps30);
 
             sensor.Start();
 
@@ -281,6 +302,21 @@ namespace GoblinXNA.Device.Capture
 
         private void AllImagesReady(object sender, AllFramesReadyEventArgs e)
         {
+            if (depthReadyCallback != null)
+            {
+                using (DepthImageFrame depthFrame = e.OpenDepthImageFrame())
+                {
+                    if (depthFrame != null)
+                    {
+                        if (depthData == null)
+                            depthData = new short[depthFrame.PixelDataLength];
+
+                        depthFrame.CopyPixelDataTo(depthData);
+                        depthReadyCallback(depthData);
+                    }
+                }
+            }
+
             if (!UsedForCalibration && videoData == null)
                 return;
 
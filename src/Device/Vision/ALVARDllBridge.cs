@@ -86,6 +86,74 @@ namespace GoblinXNA.Device.Vision
             int markerRes,
             double margin);
 
+        [DllImport("ALVARWrapper.dll", EntryPoint = "alvar_add_pattern_detector", CallingConvention = CallingConvention.Cdecl)]
+        public static extern int alvar_add_pattern_detector(
+            double markerSize,
+            double minScore,
+            int maxHashDistance);
+
+        [DllImport("ALVARWrapper.dll", EntryPoint = "alvar_add_pattern", CallingConvention = CallingConvention.Cdecl)]
+        public static extern int alvar_add_pattern(
+            int detectorID,
+            String patternFile);
+
+        [DllImport("ALVARWrapper.dll", EntryPoint = "alvar_set_detect_bands", CallingConvention = CallingConvention.Cdecl)]
+        public static extern int alvar_set_detect_bands(
+            int detectorID,
+            int numBands,
+            int overlap);
+
+        [DllImport("ALVARWrapper.dll", EntryPoint = "alvar_set_frame_quality_gate", CallingConvention = CallingConvention.Cdecl)]
+        public static extern int alvar_set_frame_quality_gate(
+            int detectorID,
+            int step,
+            double minSharpnessRatio,
+            double minBrightness,
+            double maxBrightness,
+            int maxSkippedFrames);
+
+        [DllImport("ALVARWrapper.dll", EntryPoint = "alvar_get_frame_quality", CallingConvention = CallingConvention.Cdecl)]
+        public static extern bool alvar_get_frame_quality(
+            int detectorID,
+            ref double sharpness,
+            ref double brightness);
+
+        [DllImport("ALVARWrapper.dll", EntryPoint = "alvar_set_marker_field", CallingConvention = CallingConvention.Cdecl)]
+        public static extern int alvar_set_marker_field(
+            int detectorID,
+            bool enable,
+            int learnFrames);
+
+        [DllImport("ALVARWrapper.dll", EntryPoint = "alvar_add_field_marker", CallingConvention = CallingConvention.Cdecl)]
+        public static extern int alvar_add_field_marker(
+            int detectorID,
+            int markerID,
+            [In] [MarshalAs(UnmanagedType.LPArray, SizeConst = 16)] double[] worldPose);
+
+        [DllImport("ALVARWrapper.dll", EntryPoint = "alvar_get_field_marker_pose", CallingConvention = CallingConvention.Cdecl)]
+        public static extern bool alvar_get_field_marker_pose(
+            int detectorID,
+            int markerID,
+            [Out] [MarshalAs(UnmanagedType.LPArray, SizeConst = 16)] double[] worldPose);
+
+        [DllImport("ALVARWrapper.dll", EntryPoint = "alvar_get_field_camera_pose", CallingConvention = CallingConvention.Cdecl)]
+        public static extern bool alvar_get_field_camera_pose(
+            int detectorID,
+            [Out] [MarshalAs(UnmanagedType.LPArray, SizeConst = 16)] double[] poseMatrix);
+
+        [DllImport("ALVARWrapper.dll", EntryPoint = "alvar_set_corner_refinement", CallingConvention = CallingConvention.Cdecl)]
+        public static extern int alvar_set_corner_refinement(
+            int detectorID,
+            bool enable,
+            int samplesPerEdge,
+            int searchRadius,
+            double maxShift);
+
+        [DllImport("ALVARWrapper.dll", EntryPoint = "alvar_set_detect_scale", CallingConvention = CallingConvention.Cdecl)]
+        public static extern int alvar_set_detect_scale(
+            int detectorID,
+            int factor);
+
         [DllImport("ALVARWrapper.dll", EntryPoint = "alvar_train_feature", CallingConvention = CallingConvention.Cdecl)]
         public static extern int alvar_train_feature(
             string imageFilename,
@@ -104,6 +172,27 @@ namespace GoblinXNA.Device.Vision
         [DllImport("ALVARWrapper.dll", EntryPoint = "alvar_add_multi_marker", CallingConvention = CallingConvention.Cdecl)]
         public static extern void alvar_add_multi_marker(String filename);
 
+        [DllImport("ALVARWrapper.dll", EntryPoint = "alvar_convert_frame", CallingConvention = CallingConvention.Cdecl)]
+        public static extern bool alvar_convert_frame(
+            IntPtr srcData,
+            int srcStride,
+            int srcBytes,
+            int width,
+            int height,
+            int format,
+            IntPtr trackerImage,
+            [Out] int[] textureImage);
+
+        [DllImport("ALVARWrapper.dll", EntryPoint = "alvar_resize_image", CallingConvention = CallingConvention.Cdecl)]
+        public static extern bool alvar_resize_image(
+            IntPtr srcData,
+            int srcWidth,
+            int srcHeight,
+            int channels,
+            IntPtr dstData,
+            int dstWidth,
+            int dstHeight);
+
         [DllImport("ALVARWrapper.dll", EntryPoint = "alvar_detect_feature", CallingConvention = CallingConvention.Cdecl)]
         public static extern bool alvar_detect_feature(
             int camID,
@@ -149,6 +238,46 @@ namespace GoblinXNA.Device.Vision
             [Out] IntPtr poseMatrices,
             [Out] IntPtr errors);
 
+        [DllImport("ALVARWrapper.dll", EntryPoint = "alvar_set_pose_change_thresholds", CallingConvention = CallingConvention.Cdecl)]
+        public static extern void alvar_set_pose_change_thresholds(
+            int detectorID,
+            double translation,
+            double rotation);
+
+        [DllImport("ALVARWrapper.dll", EntryPoint = "alvar_get_pose_changes", CallingConvention = CallingConvention.Cdecl)]
+        public static extern int alvar_get_pose_changes(
+            int detectorID,
+            [Out] IntPtr ids,
+            [Out] IntPtr changes,
+            [Out] IntPtr poseMatrices);
+
+        [DllImport("ALVARWrapper.dll", EntryPoint = "alvar_get_multi_marker_pose_changes", CallingConvention = CallingConvention.Cdecl)]
+        public static extern int alvar_get_multi_marker_pose_changes(
+            int detectorID,
+            int camID,
+            bool detectAdditional,
+            [Out] IntPtr ids,
+            [Out] IntPtr changes,
+            [Out] IntPtr poseMatrices);
+
+        [DllImport("ALVARWrapper.dll", EntryPoint = "alvar_set_reference_frame", CallingConvention = CallingConvention.Cdecl)]
+        public static extern void alvar_set_reference_frame(
+            int detectorID,
+            int camID,
+            int markerID,
+            int multiMarkerIndex);
+
+        [DllImport("ALVARWrapper.dll", EntryPoint = "alvar_get_reference_camera_pose", CallingConvention = CallingConvention.Cdecl)]
+        public static extern bool alvar_get_reference_camera_pose(
+            int detectorID,
+            [Out] [MarshalAs(UnmanagedType.LPArray, SizeConst = 16)] double[] poseMatrix);
+
+        [DllImport("ALVARWrapper.dll", EntryPoint = "alvar_get_allocation_count", CallingConvention = CallingConvention.Cdecl)]
+        public static extern int alvar_get_allocation_count();
+
+        [DllImport("ALVARWrapper.dll", EntryPoint = "alvar_check_allocation_count", CallingConvention = CallingConvention.Cdecl)]
+        public static extern bool alvar_check_allocation_count();
+
         [DllImport("ALVARWrapper.dll", EntryPoint = "alvar_calibrate_camera", CallingConvention = CallingConvention.Cdecl)]
         public static extern bool alvar_calibrate_camera(
             int camID, 
@@ -167,6 +296,20 @@ namespace GoblinXNA.Device.Vision
 
         #endregion
 
+        #region Enums
+
+        /// <summary>
+        /// The types of changes returned by alvar_get_pose_changes and alvar_get_multi_marker_pose_changes.
+        /// </summary>
+        public enum PoseChange
+        {
+            Appeared,
+            Moved,
+            Lost
+        }
+
+        #endregion
+
         #region Static Helpers
 
         public static Matrix GetCameraProjection(string calibFilename, int width, int height, float nearClipPlane,
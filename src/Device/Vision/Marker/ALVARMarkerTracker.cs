@@ -54,6 +54,11 @@ namespace GoblinXNA.Device.Vision.Marker
     {
         #region Member Fields
 
+        /// <summary>
+        /// The number of frames processed before CheckFrameAllocations starts checking.
+        /// </summary>
+        private const int ALLOCATION_WARMUP_FRAMES = 30;
+
         private Dictionary<int, Matrix> detectedMarkers;
         private Dictionary<String, Matrix> detectedMultiMarkers;
 
@@ -80,23 +85,40 @@ namespace GoblinXNA.Device.Vision.Marker
 
         private int colorChannel;
 
-        private int[] ids;
-        private double[] poseMats;
-        private IntPtr idPtr;
-        private IntPtr posePtr;
-        private int prevMarkerNum;
+        private int[] changeIDs;
+        private int[] changeTypes;
+        private double[] changePoseMats;
+        private IntPtr changeIdPtr;
+        private IntPtr changeTypePtr;
+        private IntPtr changePosePtr;
+        private int changeCapacity;
+
+        private double translationThreshold;
+        private double rotationThreshold;
 
-        private int[] multiIDs;
-        private double[] multiPoseMats;
-        private double[] multiErrors;
-        private IntPtr multiIdPtr;
-        private IntPtr multiPosePtr;
-        private IntPtr multiHideTexturePtr;
-        private IntPtr multiErrorPtr;
+        private Object referenceMarkerID;
+        private double[] referencePoseMat;
+        private bool referenceFound;
+        private Matrix referenceCameraMatrix;
 
         private int detectorID;
         private int cameraID;
         private bool detectAdditional;
+        private double patternMatchThreshold;
+        private int patternHashDistance;
+
+        private bool checkFrameAllocations;
+        private int checkedFrames;
+        private int maxFoundMarkerNums;
+
+        private bool frameQualityGated;
+        private bool frameSkipped;
+        private double frameSharpness;
+        private double frameBrightness;
+
+        private bool markerField;
+        private bool fieldCameraFound;
+        private Matrix fieldCameraMatrix;
 
         #endregion
 
@@ -130,23 +152,36 @@ namespace GoblinXNA.Device.Vision.Marker
             multiMarkerIDs = new List<string>();
             multiMarkerID = 0;
 
+            referenceMarkerID = null;
+            referencePoseMat = new double[16];
+            referenceFound = false;
+            referenceCameraMatrix = Matrix.Identity;
+
             colorChannel = 0;
 
-            ids = null;
-            poseMats = null;
-            prevMarkerNum = 0;
-            idPtr = IntPtr.Zero;
-            posePtr = IntPtr.Zero;
+            changeIDs = null;
+            changeTypes = null;
+            changePoseMats = null;
+            changeIdPtr = IntPtr.Zero;
+            changeTypePtr = IntPtr.Zero;
+            changePosePtr = IntPtr.Zero;
+            changeCapacity = 0;
 
-            multiIDs = null;
-            multiPoseMats = null;
-            multiErrors = null;
-            multiIdPtr = IntPtr.Zero;
-            multiPosePtr = IntPtr.Zero;
-            multiHideTexturePtr = IntPtr.Zero;
-            multiErrorPtr = IntPtr.Zero;
+            translationThreshold = 0;
+            rotationThreshold = 0;
 
             detectAdditional = false;
+            patternMatchThreshold = 0;
+            patternHashDistance = 20;
+            checkFrameAllocations = false;
+            checkedFrames = 0;
+            frameQualityGated = false;
+            frameSkipped = false;
+            frameSharpness = 0;
+            frameBrightness = 0;
+            markerField = false;
+            fieldCameraFound = false;
+            fieldCameraMatrix = Matrix.Identity;
             detectorID = -1;
             cameraID = -1;
 
@@ -200,6 +235,157 @@ namespace GoblinXNA.Device.Vision.Marker
             set { detectAdditional = value; }
         }
 
+        /// <summary>
+        /// Gets or sets the lowest normalized cross-correlation, between 0 and 1, at which a
+        /// candidate is taken as an ARToolKit pattern added with AddPattern. If set to a value
+        /// above 0 before calling InitTracker, the tracker detects ARToolKit pattern markers
+        /// instead of ALVAR markers, and the markerRes and margin passed to InitTracker are
+        /// ignored. Default value is 0.
+        /// </summary>
+        public double PatternMatchThreshold
+        {
+            get { return patternMatchThreshold; }
+            set { patternMatchThreshold = value; }
+        }
+
+        /// <summary>
+        /// Gets or sets in how many of 64 bits the coarse hashes of a candidate and a pattern can
+        /// differ before the pattern is skipped without being correlated. Lower values make large
+        /// pattern libraries cheaper to search, but may miss blurry or poorly lit markers. Set to
+        /// -1 to correlate every candidate with every pattern. Must be set before calling 
+        /// InitTracker. Default value is 20.
+        /// </summary>
+        public int PatternHashDistance
+        {
+            get { return patternHashDistance; }
+            set { patternHashDistance = value; }
+        }
+
+        /// <summary>
+        /// Gets or sets whether ProcessImage throws a MarkerException if the native wrapper allocated
+        /// memory while processing a frame, after the first 30 frames have warmed it up. Frames that
+        /// find more markers than any frame before are not checked, since the buffers that hold the
+        /// markers may have to grow. This is meant for tests that check that the steady 
+        /// state frame path does not allocate, and only works with an ALVARWrapper built with 
+        /// GOBLIN_COUNT_ALLOCATIONS. Only allocations made by the wrapper itself are counted, not the 
+        /// ones ALVAR and OpenCV make internally. Default value is false.
+        /// </summary>
+        /// <exception cref="MarkerException">If set to true and the wrapper does not count 
+        /// allocations</exception>
+        public bool CheckFrameAllocations
+        {
+            get { return checkFrameAllocations; }
+            set 
+            { 
+                if (value && !ALVARDllBridge.alvar_check_allocation_count())
+                    throw new MarkerException("CheckFrameAllocations needs an ALVARWrapper built with " +
+                        "GOBLIN_COUNT_ALLOCATIONS");
+
+                checkFrameAllocations = value;
+                checkedFrames = 0;
+                maxFoundMarkerNums = 0;
+            }
+        }
+
+        /// <summary>
+        /// Gets or sets how far, in marker size units, a found marker has to move since its pose was
+        /// last updated before its pose is updated again. Default value is 0, which updates the pose
+        /// whenever it changes.
+        /// </summary>
+        public double PoseTranslationThreshold
+        {
+            get { return translationThreshold; }
+            set
+            {
+                translationThreshold = value;
+                if (initialized)
+                    ALVARDllBridge.alvar_set_pose_change_thresholds(detectorID, translationThreshold,
+                        rotationThreshold);
+            }
+        }
+
+        /// <summary>
+        /// Gets or sets how far, in radians, a found marker has to rotate since its pose was last
+        /// updated before its pose is updated again. Default value is 0, which updates the pose
+        /// whenever it changes.
+        /// </summary>
+        public double PoseRotationThreshold
+        {
+            get { return rotationThreshold; }
+            set
+            {
+                rotationThreshold = value;
+                if (initialized)
+                    ALVARDllBridge.alvar_set_pose_change_thresholds(detectorID, translationThreshold,
+                        rotationThreshold);
+            }
+        }
+
+        /// <summary>
+        /// Gets whether the reference marker set with SetReferenceMarker(...) was found in the
+        /// last processed image.
+        /// </summary>
+        public bool ReferenceMarkerFound
+        {
+            get { return referenceFound; }
+        }
+
+        /// <summary>
+        /// Gets the pose of the camera in the coordinate frame of the reference marker set with
+        /// SetReferenceMarker(...). Only valid if ReferenceMarkerFound is true.
+        /// </summary>
+        public Matrix CameraTransform
+        {
+            get { return referenceCameraMatrix; }
+        }
+
+        /// <summary>
+        /// Gets whether marker detection was skipped for the last processed image because it was
+        /// too blurred or badly exposed. The markers then keep the poses found in the last image
+        /// that was detected. Always false unless SetFrameQualityGate(...) was called.
+        /// </summary>
+        public bool FrameSkipped
+        {
+            get { return frameSkipped; }
+        }
+
+        /// <summary>
+        /// Gets the sharpness estimate of the last processed image, which is the mean absolute
+        /// difference between neighboring pixels of the subsampled gray image. Only updated
+        /// if SetFrameQualityGate(...) was called.
+        /// </summary>
+        public double FrameSharpness
+        {
+            get { return frameSharpness; }
+        }
+
+        /// <summary>
+        /// Gets the mean brightness, from 0 to 255, of the last processed image. Only updated
+        /// if SetFrameQualityGate(...) was called.
+        /// </summary>
+        public double FrameBrightness
+        {
+            get { return frameBrightness; }
+        }
+
+        /// <summary>
+        /// Gets whether the camera pose in the marker field set up with SetMarkerField(...) was
+        /// found in the last processed image.
+        /// </summary>
+        public bool FieldCameraFound
+        {
+            get { return fieldCameraFound; }
+        }
+
+        /// <summary>
+        /// Gets the pose of the camera in the world frame of the marker field set up with
+        /// SetMarkerField(...). Only valid if FieldCameraFound is true.
+        /// </summary>
+        public Matrix FieldCameraTransform
+        {
+            get { return fieldCameraMatrix; }
+        }
+
         public bool Initialized
         {
             get { return initialized; }
@@ -367,7 +553,12 @@ namespace GoblinXNA.Device.Vision.Marker
                 (float)projMat[8], (float)projMat[9], (float)projMat[10], (float)projMat[11],
                 (float)projMat[12], (float)projMat[13], (float)projMat[14], (float)projMat[15]);
 
-            detectorID = ALVARDllBridge.alvar_add_marker_detector(markerSize, markerRes, margin);
+            if (patternMatchThreshold > 0)
+                detectorID = ALVARDllBridge.alvar_add_pattern_detector(markerSize, patternMatchThreshold,
+                    patternHashDistance);
+            else
+                detectorID = ALVARDllBridge.alvar_add_marker_detector(markerSize, markerRes, margin);
+            ALVARDllBridge.alvar_set_pose_change_thresholds(detectorID, translationThreshold, rotationThreshold);
 
             initialized = true;
         }
@@ -405,14 +596,6 @@ namespace GoblinXNA.Device.Vision.Marker
 
                     multiMarkerIDs.Add((String)id);
                     multiMarkerID++;
-
-                    multiIdPtr = Marshal.AllocHGlobal(multiMarkerIDs.Count * sizeof(int));
-                    multiPosePtr = Marshal.AllocHGlobal(multiMarkerIDs.Count * 16 * sizeof(double));
-                    multiErrorPtr = Marshal.AllocHGlobal(multiMarkerIDs.Count * sizeof(double));
-
-                    multiIDs = new int[multiMarkerIDs.Count];
-                    multiPoseMats = new double[multiMarkerIDs.Count * 16];
-                    multiErrors = new double[multiMarkerIDs.Count];
                 }
                 else if (markerConfigs[0] is int)
                 {
@@ -464,14 +647,6 @@ namespace GoblinXNA.Device.Vision.Marker
 
                         multiMarkerIDs.Add((String)id);
                         multiMarkerID++;
-
-                        multiIdPtr = Marshal.AllocHGlobal(multiMarkerIDs.Count * sizeof(int));
-                        multiPosePtr = Marshal.AllocHGlobal(multiMarkerIDs.Count * 16 * sizeof(double));
-                        multiErrorPtr = Marshal.AllocHGlobal(multiMarkerIDs.Count * sizeof(double));
-
-                        multiIDs = new int[multiMarkerIDs.Count];
-                        multiPoseMats = new double[multiMarkerIDs.Count * 16];
-                        multiErrors = new double[multiMarkerIDs.Count];
                     }
                 }
                 catch (Exception)
@@ -483,6 +658,204 @@ namespace GoblinXNA.Device.Vision.Marker
             return id;
         }
 
+        /// <summary>
+        /// Loads an ARToolKit pattern file (.patt) to be detected. The returned marker ID is then
+        /// passed to AssociateMarker like an ALVAR marker ID. Only available if PatternMatchThreshold
+        /// was set above 0 before calling InitTracker.
+        /// </summary>
+        /// <param name="patternFile">The ARToolKit pattern file</param>
+        /// <returns>The marker ID that the pattern is detected with</returns>
+        public int AddPattern(String patternFile)
+        {
+            if (!initialized)
+                throw new MarkerException("ALVARMarkerTracker is not initialized. Call InitTracker(...)");
+
+            if (patternMatchThreshold <= 0)
+                throw new MarkerException("Set PatternMatchThreshold before calling InitTracker(...) to " +
+                    "detect pattern markers");
+
+            int markerID = ALVARDllBridge.alvar_add_pattern(detectorID, patternFile);
+            if (markerID < 0)
+                throw new MarkerException("Pattern file " + patternFile + " is either not found or invalid");
+
+            return markerID;
+        }
+
+        /// <summary>
+        /// Splits each image into horizontal bands that are processed in parallel on separate cores,
+        /// which reduces the detection latency of high resolution cameras. The bands overlap by
+        /// 'overlap' pixels, which should be at least the height of the largest marker in the image.
+        /// Not supported when detecting ARToolKit pattern markers.
+        /// </summary>
+        /// <param name="numBands">The number of bands. Pass 1 to turn off parallel detection.</param>
+        /// <param name="overlap">The number of pixel rows shared by adjacent bands.</param>
+        public void SetParallelDetection(int numBands, int overlap)
+        {
+            if (!initialized)
+                throw new MarkerException("ALVARMarkerTracker is not initialized. Call InitTracker(...)");
+
+            ALVARDllBridge.alvar_set_detect_bands(detectorID, numBands, overlap);
+        }
+
+        /// <summary>
+        /// Skips marker detection for images that are too blurred, such as during fast camera motion,
+        /// or too dark or bright to give good poses. Skipped images keep the poses found in the last
+        /// detected image, and set FrameSkipped. The estimates are computed on the gray image
+        /// subsampled by 'step' in both directions, which is much cheaper than detection.
+        /// </summary>
+        /// <param name="step">The subsampling step in pixels. Pass 0 to turn the gate off.</param>
+        /// <param name="minSharpnessRatio">The lowest sharpness, relative to the average of recently
+        /// detected images, at which an image is still detected (e.g., 0.6).</param>
+        /// <param name="minBrightness">The lowest mean brightness, from 0 to 255, of a detected image.</param>
+        /// <param name="maxBrightness">The highest mean brightness, from 0 to 255, of a detected image.</param>
+        /// <param name="maxSkippedFrames">The most images skipped in a row before one is detected
+        /// anyway, or 0 for no limit.</param>
+        public void SetFrameQualityGate(int step, double minSharpnessRatio, double minBrightness,
+            double maxBrightness, int maxSkippedFrames)
+        {
+            if (!initialized)
+                throw new MarkerException("ALVARMarkerTracker is not initialized. Call InitTracker(...)");
+
+            ALVARDllBridge.alvar_set_frame_quality_gate(detectorID, step, minSharpnessRatio, minBrightness,
+                maxBrightness, maxSkippedFrames);
+            frameQualityGated = (step > 0);
+            frameSkipped = false;
+        }
+
+        /// <summary>
+        /// Refines the marker corners found by ALVAR to sub-pixel accuracy from the image gradient
+        /// across the marker edges, and fits the marker poses to the refined corners. This reduces
+        /// pose jitter, and the edges of all markers in an image are processed together with SIMD
+        /// instructions, so the cost stays low with many visible markers.
+        /// </summary>
+        /// <param name="enable">Whether to refine the marker corners.</param>
+        /// <param name="samplesPerEdge">The number of points sampled along each marker edge, rounded
+        /// up to a multiple of 4 (e.g., 8).</param>
+        /// <param name="searchRadius">How far from ALVAR's edge, in pixels, the edge is searched
+        /// for (e.g., 2).</param>
+        /// <param name="maxShift">The farthest, in pixels, a corner may be moved from where ALVAR
+        /// found it (e.g., 1.5).</param>
+        public void SetCornerRefinement(bool enable, int samplesPerEdge, int searchRadius, double maxShift)
+        {
+            if (!initialized)
+                throw new MarkerException("ALVARMarkerTracker is not initialized. Call InitTracker(...)");
+
+            ALVARDllBridge.alvar_set_corner_refinement(detectorID, enable, samplesPerEdge, searchRadius, 
+                maxShift);
+        }
+
+        /// <summary>
+        /// Detects the markers on the image reduced by 'factor' with a box filter, which is faster
+        /// and less sensitive to noise, but misses markers that are too small in the reduced image.
+        /// The marker poses are still fitted at full resolution, after corner refinement if it is
+        /// enabled, so there is no need to reduce the image passed to the tracker.
+        /// </summary>
+        /// <param name="factor">The reduction factor: 1 (off), 2, or 4.</param>
+        public void SetDetectScale(int factor)
+        {
+            if (!initialized)
+                throw new MarkerException("ALVARMarkerTracker is not initialized. Call InitTracker(...)");
+
+            ALVARDllBridge.alvar_set_detect_scale(detectorID, factor);
+        }
+
+        /// <summary>
+        /// Treats the markers as a static field, such as markers fixed to the walls of a room. A
+        /// single camera pose is solved per image from all visible field markers, which is cheaper
+        /// and more stable than fitting a pose to each marker, and the marker poses are derived
+        /// from it. Only markers in the field are found. Markers are added to the field with
+        /// AddFieldMarker(...), or learned if 'learnFrames' is above 0.
+        /// </summary>
+        /// <param name="enable">Whether to track the markers as a field.</param>
+        /// <param name="learnFrames">The number of images over which the world pose of a marker
+        /// that is not in the field yet is averaged before it joins the field, or 0 to turn
+        /// learning off. Learned markers keep being refined while they are seen, but markers
+        /// added with AddFieldMarker(...) are not. If the field is empty, the first marker seen
+        /// becomes the world origin.</param>
+        public void SetMarkerField(bool enable, int learnFrames)
+        {
+            if (!initialized)
+                throw new MarkerException("ALVARMarkerTracker is not initialized. Call InitTracker(...)");
+
+            ALVARDllBridge.alvar_set_marker_field(detectorID, enable, learnFrames);
+            markerField = enable;
+            fieldCameraFound = false;
+        }
+
+        /// <summary>
+        /// Adds a marker with a known, fixed pose in the world frame to the marker field.
+        /// </summary>
+        /// <param name="markerID">An ID returned from AssociateMarker(...) method for a single 
+        /// marker.</param>
+        /// <param name="worldPose">The pose of the marker in the world frame.</param>
+        public void AddFieldMarker(int markerID, Matrix worldPose)
+        {
+            if (!initialized)
+                throw new MarkerException("ALVARMarkerTracker is not initialized. Call InitTracker(...)");
+
+            double[] pose = new double[] {
+                worldPose.M11, worldPose.M12, worldPose.M13, worldPose.M14,
+                worldPose.M21, worldPose.M22, worldPose.M23, worldPose.M24,
+                worldPose.M31, worldPose.M32, worldPose.M33, worldPose.M34,
+                worldPose.M41, worldPose.M42, worldPose.M43, worldPose.M44 };
+            ALVARDllBridge.alvar_add_field_marker(detectorID, markerID, pose);
+        }
+
+        /// <summary>
+        /// Gets the pose of a marker in the world frame of the marker field, such as a marker whose
+        /// pose was learned, so that it can be added with AddFieldMarker(...) next time.
+        /// </summary>
+        /// <param name="markerID">An ID returned from AssociateMarker(...) method for a single 
+        /// marker.</param>
+        /// <param name="worldPose">The pose of the marker in the world frame.</param>
+        /// <returns>False if the marker is not in the field or is still being learned</returns>
+        public bool GetFieldMarkerPose(int markerID, out Matrix worldPose)
+        {
+            worldPose = Matrix.Identity;
+            if (!initialized)
+                return false;
+
+            double[] pose = new double[16];
+            if (!ALVARDllBridge.alvar_get_field_marker_pose(detectorID, markerID, pose))
+                return false;
+
+            worldPose = new Matrix(
+                (float)pose[0], (float)pose[1], (float)pose[2], (float)pose[3],
+                (float)pose[4], (float)pose[5], (float)pose[6], (float)pose[7],
+                (float)pose[8], (float)pose[9], (float)pose[10], (float)pose[11],
+                (float)pose[12], (float)pose[13], (float)pose[14], (float)pose[15]);
+            return true;
+        }
+
+        /// <summary>
+        /// Makes the tracker return the poses of all markers in the coordinate frame of the given
+        /// marker, such as a ground marker, instead of the camera's. The composition is done in the
+        /// native wrapper, and the camera pose in that frame is available from CameraTransform.
+        /// While the reference marker is not found, no other marker is found either.
+        /// </summary>
+        /// <param name="markerID">An ID returned from AssociateMarker(...) method, or null to
+        /// return the poses in the camera frame.</param>
+        public void SetReferenceMarker(Object markerID)
+        {
+            if (!initialized)
+                throw new MarkerException("ALVARMarkerTracker is not initialized. Call InitTracker(...)");
+
+            int id = -1;
+            int multiMarkerIndex = -1;
+            if (markerID is int)
+                id = (int)markerID;
+            else if (markerID != null)
+            {
+                multiMarkerIndex = multiMarkerIDs.IndexOf((String)markerID);
+                if (multiMarkerIndex < 0)
+                    throw new MarkerException(markerID + " is not associated with this tracker");
+            }
+
+            referenceMarkerID = markerID;
+            referenceFound = false;
+            ALVARDllBridge.alvar_set_reference_frame(detectorID, cameraID, id, multiMarkerIndex);
+        }
+
         /// <summary>
         /// Processes the video image captured from an initialized video capture device. 
         /// </summary>
@@ -519,11 +892,31 @@ namespace GoblinXNA.Device.Vision.Marker
             int interestedMarkerNums = singleMarkerIDs.Count;
             int foundMarkerNums = 0;
 
+            int allocations = checkFrameAllocations ? ALVARDllBridge.alvar_get_allocation_count() : 0;
+
             ALVARDllBridge.alvar_detect_marker(detectorID, cameraID, nChannles, channelSeq, channelSeq, 
                 imagePtr, singleMarkerIDsPtr, ref foundMarkerNums, ref interestedMarkerNums,
                 max_marker_error, max_track_error);
 
+            if (frameQualityGated)
+                frameSkipped = ALVARDllBridge.alvar_get_frame_quality(detectorID, ref frameSharpness,
+                    ref frameBrightness);
+
             Process(interestedMarkerNums, foundMarkerNums);
+
+            if (checkFrameAllocations)
+            {
+                int frameAllocations = ALVARDllBridge.alvar_get_allocation_count() - allocations;
+                bool steady = (foundMarkerNums <= maxFoundMarkerNums);
+                if (!steady)
+                    maxFoundMarkerNums = foundMarkerNums;
+
+                if (checkedFrames < ALLOCATION_WARMUP_FRAMES)
+                    checkedFrames++;
+                else if (steady && frameAllocations > 0)
+                    throw new MarkerException("ALVARWrapper made " + frameAllocations + " allocations " +
+                        "while processing a frame after warming up");
+            }
         }
 
         /// <summary>
@@ -602,82 +995,109 @@ namespace GoblinXNA.Device.Vision.Marker
                 "double markerSize) or AssociateMarker(String multiMarkerConfig)";
         }
 
+        /// <summary>
+        /// Updates the found markers with the changes since the previous image. Markers whose poses
+        /// did not change are left untouched, so the work here only depends on how much the scene
+        /// changed.
+        /// </summary>
         private void Process(int interestedMarkerNums, int foundMarkerNums)
         {
-            detectedMarkers.Clear();
-            detectedMultiMarkers.Clear();
-
-            if (foundMarkerNums <= 0)
-                return;
+            EnsureChangeCapacity(Math.Max(singleMarkerIDs.Count, multiMarkerIDs.Count));
 
-            int id = 0;
-            if (interestedMarkerNums > 0)
+            if (singleMarkerIDs.Count > 0)
             {
-                if (prevMarkerNum != interestedMarkerNums)
+                int numChanges = ALVARDllBridge.alvar_get_pose_changes(detectorID, changeIdPtr, 
+                    changeTypePtr, changePosePtr);
+                CopyChanges(numChanges);
+
+                for (int i = 0; i < numChanges; i++)
                 {
-                    ids = new int[interestedMarkerNums];
-                    poseMats = new double[interestedMarkerNums * 16];
-                    idPtr = Marshal.AllocHGlobal(interestedMarkerNums * sizeof(int));
-                    posePtr = Marshal.AllocHGlobal(interestedMarkerNums * 16 * sizeof(double));
+                    if (changeTypes[i] == (int)ALVARDllBridge.PoseChange.Lost)
+                        detectedMarkers.Remove(changeIDs[i]);
+                    else
+                        detectedMarkers[changeIDs[i]] = GetChangedPose(i);
                 }
+            }
 
-                ALVARDllBridge.alvar_get_poses(detectorID, idPtr, posePtr);
-
-                prevMarkerNum = interestedMarkerNums;
-
-                Marshal.Copy(idPtr, ids, 0, interestedMarkerNums);
-                Marshal.Copy(posePtr, poseMats, 0, interestedMarkerNums * 16);
+            if (multiMarkerIDs.Count > 0)
+            {
+                int numChanges = ALVARDllBridge.alvar_get_multi_marker_pose_changes(detectorID, cameraID, 
+                    detectAdditional, changeIdPtr, changeTypePtr, changePosePtr);
+                CopyChanges(numChanges);
 
-                for (int i = 0; i < interestedMarkerNums; i++)
+                for (int i = 0; i < numChanges; i++)
                 {
-                    id = ids[i];
-
-                    // If same marker ID exists, then we ignore the 2nd one
-                    if (detectedMarkers.ContainsKey(id))
-                    {
-                        // do nothing
-                    }
+                    String id = multiMarkerIDs[changeIDs[i]];
+                    if (changeTypes[i] == (int)ALVARDllBridge.PoseChange.Lost)
+                        detectedMultiMarkers.Remove(id);
                     else
-                    {
-                        int index = i * 16;
-                        Matrix mat = new Matrix(
-                            (float)poseMats[index], (float)poseMats[index + 1], (float)poseMats[index + 2], (float)poseMats[index + 3],
-                            (float)poseMats[index + 4], (float)poseMats[index + 5], (float)poseMats[index + 6], (float)poseMats[index + 7],
-                            (float)poseMats[index + 8], (float)poseMats[index + 9], (float)poseMats[index + 10], (float)poseMats[index + 11],
-                            (float)poseMats[index + 12], (float)poseMats[index + 13], (float)poseMats[index + 14], (float)poseMats[index + 15]);
-                        detectedMarkers.Add(id, mat);
-                    }
+                        detectedMultiMarkers[id] = GetChangedPose(i);
                 }
             }
 
-            if (multiMarkerIDs.Count == 0)
-                return;
-
-            double error = -1;
+            if (markerField)
+            {
+                fieldCameraFound = ALVARDllBridge.alvar_get_field_camera_pose(detectorID, referencePoseMat);
+                if (fieldCameraFound)
+                    fieldCameraMatrix = new Matrix(
+                        (float)referencePoseMat[0], (float)referencePoseMat[1], (float)referencePoseMat[2], (float)referencePoseMat[3],
+                        (float)referencePoseMat[4], (float)referencePoseMat[5], (float)referencePoseMat[6], (float)referencePoseMat[7],
+                        (float)referencePoseMat[8], (float)referencePoseMat[9], (float)referencePoseMat[10], (float)referencePoseMat[11],
+                        (float)referencePoseMat[12], (float)referencePoseMat[13], (float)referencePoseMat[14], (float)referencePoseMat[15]);
+            }
 
-            ALVARDllBridge.alvar_get_multi_marker_poses(detectorID, cameraID, detectAdditional, 
-                multiIdPtr, multiPosePtr, multiErrorPtr);
+            if (referenceMarkerID != null)
+            {
+                referenceFound = ALVARDllBridge.alvar_get_reference_camera_pose(detectorID, referencePoseMat);
+                if (referenceFound)
+                    referenceCameraMatrix = new Matrix(
+                        (float)referencePoseMat[0], (float)referencePoseMat[1], (float)referencePoseMat[2], (float)referencePoseMat[3],
+                        (float)referencePoseMat[4], (float)referencePoseMat[5], (float)referencePoseMat[6], (float)referencePoseMat[7],
+                        (float)referencePoseMat[8], (float)referencePoseMat[9], (float)referencePoseMat[10], (float)referencePoseMat[11],
+                        (float)referencePoseMat[12], (float)referencePoseMat[13], (float)referencePoseMat[14], (float)referencePoseMat[15]);
+            }
+        }
 
-            Marshal.Copy(multiIdPtr, multiIDs, 0, multiMarkerIDs.Count);
-            Marshal.Copy(multiPosePtr, multiPoseMats, 0, multiMarkerIDs.Count * 16);
-            Marshal.Copy(multiErrorPtr, multiErrors, 0, multiMarkerIDs.Count);
+        private void EnsureChangeCapacity(int capacity)
+        {
+            if (capacity <= changeCapacity)
+                return;
 
-            for (int i = 0; i < multiMarkerIDs.Count; i++)
+            if (changeIdPtr != IntPtr.Zero)
             {
-                id = multiIDs[i];
-                error = multiErrors[i];
-
-                if (error == -1)
-                    continue;
-
-                int index = i * 16;
-                Matrix mat = new Matrix(
-                    (float)multiPoseMats[index], (float)multiPoseMats[index + 1], (float)multiPoseMats[index + 2], (float)multiPoseMats[index + 3],
-                    (float)multiPoseMats[index + 4], (float)multiPoseMats[index + 5], (float)multiPoseMats[index + 6], (float)multiPoseMats[index + 7],
-                    (float)multiPoseMats[index + 8], (float)multiPoseMats[index + 9], (float)multiPoseMats[index + 10], (float)multiPoseMats[index + 11],
-                    (float)multiPoseMats[index + 12], (float)multiPoseMats[index + 13], (float)multiPoseMats[index + 14], (float)multiPoseMats[index + 15]);
-                detectedMultiMarkers.Add(multiMarkerIDs[i], mat);
+                Marshal.FreeHGlobal(changeIdPtr);
+                Marshal.FreeHGlobal(changeTypePtr);
+                Marshal.FreeHGlobal(changePosePtr);
             }
+
+            changeIdPtr = Marshal.AllocHGlobal(capacity * sizeof(int));
+            changeTypePtr = Marshal.AllocHGlobal(capacity * sizeof(int));
+            changePosePtr = Marshal.AllocHGlobal(capacity * 16 * sizeof(double));
+
+            changeIDs = new int[capacity];
+            changeTypes = new int[capacity];
+            changePoseMats = new double[capacity * 16];
+            changeCapacity = capacity;
+        }
+
+        private void CopyChanges(int numChanges)
+        {
+            if (numChanges <= 0)
+                return;
+
+            Marshal.Copy(changeIdPtr, changeIDs, 0, numChanges);
+            Marshal.Copy(changeTypePtr, changeTypes, 0, numChanges);
+            Marshal.Copy(changePosePtr, changePoseMats, 0, numChanges * 16);
+        }
+
+        private Matrix GetChangedPose(int i)
+        {
+            int index = i * 16;
+            return new Matrix(
+                (float)changePoseMats[index], (float)changePoseMats[index + 1], (float)changePoseMats[index + 2], (float)changePoseMats[index + 3],
+                (float)changePoseMats[index + 4], (float)changePoseMats[index + 5], (float)changePoseMats[index + 6], (float)changePoseMats[index + 7],
+                (float)changePoseMats[index + 8], (float)changePoseMats[index + 9], (float)changePoseMats[index + 10], (float)changePoseMats[index + 11],
+                (float)changePoseMats[index + 12], (float)changePoseMats[index + 13], (float)changePoseMats[index + 14], (float)changePoseMats[index + 15]);
         }
 
         #endregion
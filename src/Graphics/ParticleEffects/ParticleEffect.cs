@@ -168,6 +168,11 @@ namespace GoblinXNA.Graphics.ParticleEffects
         /// </summary>
         protected int drawCounter;
 
+        /// <summary>
+        /// Random control values of the particles being added, reused across calls to AddParticles.
+        /// </summary>
+        protected byte[] randomValues = new byte[0];
+
 
         /// <summary>
         /// Shared random number generator.
@@ -788,52 +793,89 @@ namespace GoblinXNA.Graphics.ParticleEffects
         /// </summary>
         public virtual void AddParticle(Vector3 position, Vector3 velocity)
         {
-            // Figure out where in the circular queue to allocate the new particle.
-            int nextFreeParticle = firstFreeParticle + 1;
+            AddParticles(position, Vector3.Zero, velocity, 1);
+        }
 
-            if (nextFreeParticle >= maxParticles)
-                nextFreeParticle = 0;
+        /// <summary>
+        /// Adds a number of new particles to the system at once, placed at evenly spaced positions
+        /// along a line. This is much cheaper than calling AddParticle for each of them.
+        /// </summary>
+        /// <param name="firstPosition">The position of the first particle</param>
+        /// <param name="positionStep">The offset from each particle to the next one</param>
+        /// <param name="velocity">The velocity shared by all of the particles before the random
+        /// velocities are added</param>
+        /// <param name="count">The number of particles to add</param>
+        /// <returns>The number of particles added, which is less than count if the system
+        /// runs out of free particles</returns>
+        public virtual int AddParticles(Vector3 firstPosition, Vector3 positionStep, Vector3 velocity, int count)
+        {
+            // Find how many free particles are left in the circular queue. One slot is always
+            // kept empty so that a full queue can be told apart from an empty one.
+            int freeParticles = firstRetiredParticle - firstFreeParticle - 1;
+
+            if (freeParticles < 0)
+                freeParticles += maxParticles;
 
             // If there are no free particles, we just have to give up.
-            if (nextFreeParticle == firstRetiredParticle)
-                return;
+            if (count > freeParticles)
+                count = freeParticles;
+
+            if (count <= 0)
+                return 0;
 
             // Adjust the input velocity based on how much
             // this particle system wants to be affected by it.
             velocity *= emitterVelocitySensitivity;
 
-            // Add in some random amount of horizontal velocity.
-            float horizontalVelocity = MathHelper.Lerp(minHorizontalVelocity,
-                                                       maxHorizontalVelocity,
-                                                       (float)random.NextDouble());
+            // Choose four random control values for each particle. These will be used by the vertex
+            // shader to give each particle a different size, rotation, and color.
+            if (randomValues.Length < count * 4)
+                randomValues = new byte[count * 4];
+
+            random.NextBytes(randomValues);
 
-            double horizontalAngle = random.NextDouble() * MathHelper.TwoPi;
+            ParticleVertex vertex = new ParticleVertex();
+            vertex.Position = firstPosition;
+            vertex.Time = currentTime;
 
-            velocity += right * horizontalVelocity * (float)Math.Cos(horizontalAngle);
-            velocity += forward * horizontalVelocity * (float)Math.Sin(horizontalAngle);
+            for (int n = 0; n < count; n++)
+            {
+                // Add in some random amount of horizontal velocity.
+                float horizontalVelocity = MathHelper.Lerp(minHorizontalVelocity,
+                                                           maxHorizontalVelocity,
+                                                           (float)random.NextDouble());
 
-            // Add in some random amount of vertical velocity.
-            velocity += up * MathHelper.Lerp(minVerticalVelocity,
-                                          maxVerticalVelocity,
-                                          (float)random.NextDouble());
+                double horizontalAngle = random.NextDouble() * MathHelper.TwoPi;
 
-            // Choose four random control values. These will be used by the vertex
-            // shader to give each particle a different size, rotation, and color.
-            Color randomValues = new Color((byte)random.Next(255),
-                                           (byte)random.Next(255),
-                                           (byte)random.Next(255),
-                                           (byte)random.Next(255));
+                vertex.Velocity = velocity;
+                vertex.Velocity += right * (horizontalVelocity * (float)Math.Cos(horizontalAngle));
+                vertex.Velocity += forward * (horizontalVelocity * (float)Math.Sin(horizontalAngle));
 
-            // Fill in the particle vertex structure.
-            for (int i = 0; i < 4; i++)
-            {
-                particles[firstFreeParticle * 4 + i].Position = position;
-                particles[firstFreeParticle * 4 + i].Velocity = velocity;
-                particles[firstFreeParticle * 4 + i].Random = randomValues;
-                particles[firstFreeParticle * 4 + i].Time = currentTime;
+                // Add in some random amount of vertical velocity.
+                vertex.Velocity += up * MathHelper.Lerp(minVerticalVelocity,
+                                                        maxVerticalVelocity,
+                                                        (float)random.NextDouble());
+
+                vertex.Random = new Color(randomValues[n * 4], randomValues[n * 4 + 1],
+                                          randomValues[n * 4 + 2], randomValues[n * 4 + 3]);
+
+                // Fill in the four vertices of the particle, keeping their corners.
+                int index = firstFreeParticle * 4;
+                for (int i = 0; i < 4; i++)
+                {
+                    vertex.Corner = particles[index + i].Corner;
+                    particles[index + i] = vertex;
+                }
+
+                firstFreeParticle++;
+
+                if (firstFreeParticle >= maxParticles)
+                    firstFreeParticle = 0;
+
+                Vector3.Add(ref vertex.Position, ref positionStep, out vertex.Position);
             }
 
-            firstFreeParticle = nextFreeParticle;
+            return count;
         }
 
         /// <summary>
@@ -86,24 +86,26 @@ namespace GoblinXNA.Graphics.ParticleEffects
                 // previous update, add that to the current elapsed time.
                 float timeToSpend = timeLeftOver + elapsedTime;
 
-                // Counter for looping over the time interval.
-                float currentTime = -timeLeftOver;
+                // Count how many particles fit in the time interval.
+                int count = (int)(timeToSpend / timeBetweenParticles);
 
-                // Create particles as long as we have a big enough time interval.
-                while (timeToSpend > timeBetweenParticles)
-                {
-                    currentTime += timeBetweenParticles;
-                    timeToSpend -= timeBetweenParticles;
+                if (count > 0 && count * timeBetweenParticles >= timeToSpend)
+                    count--;
 
-                    // Work out the optimal position for this particle. This will produce
+                if (count > 0)
+                {
+                    // Work out the optimal positions for these particles. This will produce
                     // evenly spaced particles regardless of the object speed, particle
                     // creation frequency, or game update rate.
-                    float mu = currentTime / elapsedTime;
+                    float mu = (timeBetweenParticles - timeLeftOver) / elapsedTime;
+                    float muStep = timeBetweenParticles / elapsedTime;
+
+                    Vector3 position = previousPosition + tmp * mu;
 
-                    Vector3 position = Vector3.Lerp(previousPosition, newPosition, mu);
+                    // Create all of the particles at once.
+                    particleSystem.AddParticles(position, tmp * muStep, velocity, count);
 
-                    // Create the particle.
-                    particleSystem.AddParticle(position, velocity);
+                    timeToSpend -= count * timeBetweenParticles;
                 }
 
                 // Store any time we didn't use, so it can be part of the next update.
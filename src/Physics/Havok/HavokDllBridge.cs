@@ -63,6 +63,9 @@ namespace GoblinXNA.Physics.Havok
         [UnmanagedFunctionPointer(CallingConvention.Cdecl)]
         public delegate void PhantomLeaveCallback(IntPtr body);
 
+        [UnmanagedFunctionPointer(CallingConvention.Cdecl)]
+        public delegate void DestructibleBreakCallback(IntPtr body);
+
         #endregion
 
         private const String HAVOK_DLL = "HavokWrapper.dll";
@@ -135,6 +138,52 @@ namespace GoblinXNA.Physics.Havok
             [MarshalAs(UnmanagedType.LPArray)] int[] indices,
             float convexRadius);
 
+        [DllImport(HAVOK_DLL, EntryPoint = "create_strided_mesh_shape", CallingConvention = CallingConvention.Cdecl)]
+        public static extern IntPtr create_strided_mesh_shape(
+            int numVertices,
+            IntPtr vertices,
+            int vertexStride,
+            int numTriangles,
+            IntPtr indices,
+            int indexSize,
+            [MarshalAs(UnmanagedType.LPArray, SizeConst = 3)] float[] scale,
+            bool copyData,
+            bool weldEdges,
+            bool weldVertices,
+            float convexRadius);
+
+        [DllImport(HAVOK_DLL, EntryPoint = "create_convex_shape_async", CallingConvention = CallingConvention.Cdecl)]
+        public static extern IntPtr create_convex_shape_async(
+            int numVertices,
+            [MarshalAs(UnmanagedType.LPArray)] float[] vertices,
+            int stride,
+            float convexRadius);
+
+        [DllImport(HAVOK_DLL, EntryPoint = "create_strided_mesh_shape_async", CallingConvention = CallingConvention.Cdecl)]
+        public static extern IntPtr create_strided_mesh_shape_async(
+            int numVertices,
+            IntPtr vertices,
+            int vertexStride,
+            int numTriangles,
+            IntPtr indices,
+            int indexSize,
+            [MarshalAs(UnmanagedType.LPArray, SizeConst = 3)] float[] scale,
+            bool weldEdges,
+            bool weldVertices,
+            float convexRadius);
+
+        [DllImport(HAVOK_DLL, EntryPoint = "is_shape_ready", CallingConvention = CallingConvention.Cdecl)]
+        public static extern bool is_shape_ready(
+            IntPtr pendingShape);
+
+        [DllImport(HAVOK_DLL, EntryPoint = "wait_for_shape", CallingConvention = CallingConvention.Cdecl)]
+        public static extern IntPtr wait_for_shape(
+            IntPtr pendingShape);
+
+        [DllImport(HAVOK_DLL, EntryPoint = "release_pending_shape", CallingConvention = CallingConvention.Cdecl)]
+        public static extern void release_pending_shape(
+            IntPtr pendingShape);
+
         [DllImport(HAVOK_DLL, EntryPoint = "add_rigid_body", CallingConvention = CallingConvention.Cdecl)]
         public static extern IntPtr add_rigid_body(
             IntPtr shape,
@@ -155,10 +204,95 @@ namespace GoblinXNA.Physics.Havok
             bool neverDeactivate,
             float gravityFactor);
 
+        [DllImport(HAVOK_DLL, EntryPoint = "add_pending_rigid_body", CallingConvention = CallingConvention.Cdecl)]
+        public static extern IntPtr add_pending_rigid_body(
+            IntPtr pendingShape,
+            float mass,
+            HavokPhysics.MotionType motionType,
+            HavokPhysics.CollidableQualityType qualityType,
+            [MarshalAs(UnmanagedType.LPArray, SizeConst = 3)] float[] pos,
+            [MarshalAs(UnmanagedType.LPArray, SizeConst = 4)] float[] rot,
+            [MarshalAs(UnmanagedType.LPArray, SizeConst = 3)] float[] linearVelocity,
+            float linearDamping,
+            float maxLinearVelocity,
+            [MarshalAs(UnmanagedType.LPArray, SizeConst = 3)] float[] angularVelocity,
+            float angularDamping,
+            float maxAngularVelocity,
+            float friction,
+            float restitution,
+            float allowedPenetrationDepth,
+            bool neverDeactivate,
+            float gravityFactor);
+
+        [DllImport(HAVOK_DLL, EntryPoint = "is_body_pending", CallingConvention = CallingConvention.Cdecl)]
+        public static extern bool is_body_pending(
+            IntPtr body);
+
         [DllImport(HAVOK_DLL, EntryPoint = "remove_rigid_body", CallingConvention = CallingConvention.Cdecl)]
         public static extern void remove_rigid_body(
             IntPtr body);
 
+        [DllImport(HAVOK_DLL, EntryPoint = "add_destructible", CallingConvention = CallingConvention.Cdecl)]
+        public static extern IntPtr add_destructible(
+            int numFragments,
+            [MarshalAs(UnmanagedType.LPArray)] IntPtr[] shapes,
+            [MarshalAs(UnmanagedType.LPArray)] float[] localPos,
+            [MarshalAs(UnmanagedType.LPArray)] float[] localRot,
+            [MarshalAs(UnmanagedType.LPArray)] float[] masses,
+            [MarshalAs(UnmanagedType.LPArray, SizeConst = 3)] float[] pos,
+            [MarshalAs(UnmanagedType.LPArray, SizeConst = 4)] float[] rot,
+            float friction,
+            float restitution,
+            float breakThreshold,
+            DestructibleBreakCallback callback,
+            [Out, MarshalAs(UnmanagedType.LPArray)] IntPtr[] fragmentBodies);
+
+        [DllImport(HAVOK_DLL, EntryPoint = "remove_destructible", CallingConvention = CallingConvention.Cdecl)]
+        public static extern void remove_destructible(
+            IntPtr intact);
+
+        [DllImport(HAVOK_DLL, EntryPoint = "add_vehicle", CallingConvention = CallingConvention.Cdecl)]
+        public static extern IntPtr add_vehicle(
+            IntPtr chassis,
+            int numWheels,
+            [MarshalAs(UnmanagedType.LPArray)] float[] wheelParams);
+
+        [DllImport(HAVOK_DLL, EntryPoint = "remove_vehicle", CallingConvention = CallingConvention.Cdecl)]
+        public static extern void remove_vehicle(
+            IntPtr vehicle);
+
+        [DllImport(HAVOK_DLL, EntryPoint = "set_vehicle_inputs", CallingConvention = CallingConvention.Cdecl)]
+        public static extern void set_vehicle_inputs(
+            [MarshalAs(UnmanagedType.LPArray)] float[] inputs);
+
+        [DllImport(HAVOK_DLL, EntryPoint = "get_wheel_transforms", CallingConvention = CallingConvention.Cdecl)]
+        public static extern void get_wheel_transforms(
+            [Out, MarshalAs(UnmanagedType.LPArray)] float[] transforms);
+
+        [DllImport(HAVOK_DLL, EntryPoint = "add_depth_field", CallingConvention = CallingConvention.Cdecl)]
+        public static extern IntPtr add_depth_field(
+            int width,
+            int height,
+            int tileSize,
+            [MarshalAs(UnmanagedType.LPArray)] float[] intrinsics,
+            float depthScale,
+            int depthShift,
+            float nearDepth,
+            float farDepth,
+            float thickness,
+            float threshold,
+            int maxUpdates);
+
+        [DllImport(HAVOK_DLL, EntryPoint = "update_depth_field", CallingConvention = CallingConvention.Cdecl)]
+        public static extern void update_depth_field(
+            IntPtr field,
+            [MarshalAs(UnmanagedType.LPArray)] short[] depth,
+            [MarshalAs(UnmanagedType.LPArray)] float[] cameraTransform);
+
+        [DllImport(HAVOK_DLL, EntryPoint = "remove_depth_field", CallingConvention = CallingConvention.Cdecl)]
+        public static extern void remove_depth_field(
+            IntPtr field);
+
         [DllImport(HAVOK_DLL, EntryPoint = "add_contact_listener", CallingConvention = CallingConvention.Cdecl)]
         public static extern void add_contact_listener(
             IntPtr body,
@@ -225,6 +359,16 @@ namespace GoblinXNA.Physics.Havok
             [Out, MarshalAs(UnmanagedType.LPArray, SizeConst = 3)] float[] min,
             [Out, MarshalAs(UnmanagedType.LPArray, SizeConst = 3)] float[] max);
 
+        [DllImport(HAVOK_DLL, EntryPoint = "set_step_budget", CallingConvention = CallingConvention.Cdecl)]
+        public static extern void set_step_budget(
+            float budgetSeconds,
+            bool deferAdds);
+
+        [DllImport(HAVOK_DLL, EntryPoint = "get_step_stats", CallingConvention = CallingConvention.Cdecl)]
+        public static extern int get_step_stats(
+            ref float stepSeconds,
+            ref float updateSeconds);
+
         [DllImport(HAVOK_DLL, EntryPoint = "update", CallingConvention = CallingConvention.Cdecl)]
         public static extern void update(float elapsedSeconds);
 
@@ -249,6 +393,47 @@ namespace GoblinXNA.Physics.Havok
             [Out] IntPtr transformPtr, 
             ref int totalSize);
 
+        [DllImport(HAVOK_DLL, EntryPoint = "get_contacts", CallingConvention = CallingConvention.Cdecl)]
+        public static extern int get_contacts(
+            int numBodies,
+            [MarshalAs(UnmanagedType.LPArray)] IntPtr[] bodies,
+            int maxContacts,
+            [Out, MarshalAs(UnmanagedType.LPArray)] int[] contactCounts,
+            [Out, MarshalAs(UnmanagedType.LPArray)] IntPtr[] partners,
+            [Out, MarshalAs(UnmanagedType.LPArray)] float[] normals,
+            [Out, MarshalAs(UnmanagedType.LPArray)] float[] depths);
+
+        [DllImport(HAVOK_DLL, EntryPoint = "cull_bodies", CallingConvention = CallingConvention.Cdecl)]
+        public static extern int cull_bodies(
+            int numFrusta,
+            [MarshalAs(UnmanagedType.LPArray)] float[] planes,
+            [MarshalAs(UnmanagedType.LPArray)] float[] corners,
+            int maxBodies,
+            [Out, MarshalAs(UnmanagedType.LPArray)] IntPtr[] bodies,
+            [Out, MarshalAs(UnmanagedType.LPArray)] int[] masks);
+
+        [DllImport(HAVOK_DLL, EntryPoint = "snapshot_cast_ray", CallingConvention = CallingConvention.Cdecl)]
+        public static extern bool snapshot_cast_ray(
+            [MarshalAs(UnmanagedType.LPArray, SizeConst = 3)] float[] from,
+            [MarshalAs(UnmanagedType.LPArray, SizeConst = 3)] float[] to,
+            ref IntPtr body,
+            ref float hitFraction,
+            [Out, MarshalAs(UnmanagedType.LPArray, SizeConst = 3)] float[] normal);
+
+        [DllImport(HAVOK_DLL, EntryPoint = "snapshot_overlap_aabb", CallingConvention = CallingConvention.Cdecl)]
+        public static extern int snapshot_overlap_aabb(
+            [MarshalAs(UnmanagedType.LPArray, SizeConst = 3)] float[] min,
+            [MarshalAs(UnmanagedType.LPArray, SizeConst = 3)] float[] max,
+            int maxBodies,
+            [Out, MarshalAs(UnmanagedType.LPArray)] IntPtr[] bodies);
+
+        [DllImport(HAVOK_DLL, EntryPoint = "snapshot_nearest_body", CallingConvention = CallingConvention.Cdecl)]
+        public static extern bool snapshot_nearest_body(
+            [MarshalAs(UnmanagedType.LPArray, SizeConst = 3)] float[] point,
+            float maxDistance,
+            ref IntPtr body,
+            ref float distance);
+
         [DllImport(HAVOK_DLL, EntryPoint = "dispose")]
         public static extern void dispose();
     }
@@ -61,6 +61,9 @@ namespace GoblinXNA.Physics.Havok
         private float convexRadius;
         private float gravityFactor;
         private bool isPhantom;
+        private bool weldMeshEdges;
+        private bool weldMeshVertices;
+        private bool cookShapeInBackground;
 
         private HavokDllBridge.ContactCallback contactCallback;
         private HavokDllBridge.CollisionStarted collisionStartCallback;
@@ -91,6 +94,9 @@ namespace GoblinXNA.Physics.Havok
             gravityFactor = 1;
 
             isPhantom = false;
+            weldMeshEdges = false;
+            weldMeshVertices = false;
+            cookShapeInBackground = false;
         }
 
         public HavokObject() : this(null) { }
@@ -229,6 +235,53 @@ namespace GoblinXNA.Physics.Havok
             set { isPhantom = value; }
         }
 
+        /// <summary>
+        /// Gets or sets whether the contact normals of a TriangleMesh shape are welded across 
+        /// neighboring triangles, so that objects sliding over the mesh do not bump on its inner
+        /// edges. Default value is false.
+        /// </summary>
+        public bool WeldMeshEdges
+        {
+            get { return weldMeshEdges; }
+            set 
+            { 
+                weldMeshEdges = value;
+                modified = true;
+            }
+        }
+
+        /// <summary>
+        /// Gets or sets whether the vertices of a TriangleMesh shape that have the same position are
+        /// merged, such as the copies an interleaved vertex buffer makes of a corner for each of its
+        /// normals or texture coordinates. Default value is false.
+        /// </summary>
+        public bool WeldMeshVertices
+        {
+            get { return weldMeshVertices; }
+            set 
+            { 
+                weldMeshVertices = value;
+                modified = true;
+            }
+        }
+
+        /// <summary>
+        /// Gets or sets whether a ConvexHull or TriangleMesh shape is built on a worker thread of the
+        /// physics wrapper, so that adding a complex object does not stall the frame. The object is
+        /// added to the simulation by the first update after its shape is ready, which can be
+        /// checked with HavokPhysics.IsPhysicsObjectReady. Ignored for phantoms and vehicles. 
+        /// Default value is false.
+        /// </summary>
+        public bool CookShapeInBackground
+        {
+            get { return cookShapeInBackground; }
+            set 
+            { 
+                cookShapeInBackground = value;
+                modified = true;
+            }
+        }
+
         /// <summary>
         /// Gets or sets the callback function when there is a contact with other physics objects.
         /// </summary>
@@ -328,6 +381,9 @@ namespace GoblinXNA.Physics.Havok
             xmlNode.SetAttribute("ConvexRadius", convexRadius.ToString());
             xmlNode.SetAttribute("GravityFactor", gravityFactor.ToString());
             xmlNode.SetAttribute("IsPhantom", isPhantom.ToString());
+            xmlNode.SetAttribute("WeldMeshEdges", weldMeshEdges.ToString());
+            xmlNode.SetAttribute("WeldMeshVertices", weldMeshVertices.ToString());
+            xmlNode.SetAttribute("CookShapeInBackground", cookShapeInBackground.ToString());
 
             if (contactCallback != null)
                 xmlNode.SetAttribute("ContactCallback", contactCallback.Method.Name);
@@ -369,6 +425,12 @@ namespace GoblinXNA.Physics.Havok
                 gravityFactor = float.Parse(xmlNode.GetAttribute("GravityFactor"));
             if (xmlNode.HasAttribute("IsPhantom"))
                 isPhantom = bool.Parse(xmlNode.GetAttribute("IsPhantom"));
+            if (xmlNode.HasAttribute("WeldMeshEdges"))
+                weldMeshEdges = bool.Parse(xmlNode.GetAttribute("WeldMeshEdges"));
+            if (xmlNode.HasAttribute("WeldMeshVertices"))
+                weldMeshVertices = bool.Parse(xmlNode.GetAttribute("WeldMeshVertices"));
+            if (xmlNode.HasAttribute("CookShapeInBackground"))
+                cookShapeInBackground = bool.Parse(xmlNode.GetAttribute("CookShapeInBackground"));
         }
 
         #endregion
@@ -34,6 +34,7 @@ using System;
 using System.Collections.Generic;
 using System.Linq;
 using System.Text;
+using System.IO;
 using System.Runtime.InteropServices;
 
 using Microsoft.Xna.Framework;
@@ -281,6 +282,41 @@ namespace GoblinXNA.Physics.Havok
             }
         }
 
+        /// <summary>
+        /// A body touching a queried body, returned by GetContacts(...).
+        /// </summary>
+        public struct Contact
+        {
+            /// <summary>
+            /// The queried body.
+            /// </summary>
+            public IPhysicsObject Body;
+            /// <summary>
+            /// The body touching it.
+            /// </summary>
+            public IPhysicsObject Partner;
+            /// <summary>
+            /// The normal of the deepest contact point, pointing from Partner toward Body.
+            /// </summary>
+            public Vector3 Normal;
+            /// <summary>
+            /// The penetration depth of the deepest contact point. Negative if the bodies are apart
+            /// but within the collision tolerance.
+            /// </summary>
+            public float Depth;
+        }
+
+        /// <summary>
+        /// What a destructible object was added with, so that it can be added again when the
+        /// simulation restarts. It also keeps the break callback alive for the native side.
+        /// </summary>
+        protected class DestructibleObject
+        {
+            public List<IPhysicsObject> Fragments;
+            public float BreakSpeed;
+            public HavokDllBridge.DestructibleBreakCallback Callback;
+        }
+
         #endregion
 
         #region Member Fields
@@ -297,6 +333,33 @@ namespace GoblinXNA.Physics.Havok
 
         protected float simulationSpeed;
 
+        protected float stepBudget;
+        protected bool deferBodyAdds;
+        protected float lastStepTime;
+        protected float lastUpdateTime;
+        protected int deferredWorkCount;
+
+        protected Dictionary<IPhysicsObject, DestructibleObject> destructibles;
+
+        protected List<HavokVehicle> vehicles;
+        protected Dictionary<HavokVehicle, IntPtr> vehicleIDs;
+        protected float[] vehicleInputs;
+        protected float[] wheelTransforms;
+
+        protected List<IntPtr> depthFields;
+
+        protected float[] cullPlanes;
+        protected float[] cullCorners;
+        protected Vector3[] frustumCorners;
+        protected IntPtr[] cullBodies;
+        protected int[] cullMasks;
+
+        protected IntPtr[] contactBodies;
+        protected int[] contactCounts;
+        protected IntPtr[] contactPartners;
+        protected float[] contactNormals;
+        protected float[] contactDepths;
+
         #region Temporary Variables For Calculation
 
         protected Matrix tmpMat1 = Matrix.Identity;
@@ -319,9 +382,36 @@ namespace GoblinXNA.Physics.Havok
             pauseSimulation = false;
             simulationSpeed = 1;
 
+            stepBudget = 0;
+            deferBodyAdds = false;
+            lastStepTime = 0;
+            lastUpdateTime = 0;
+            deferredWorkCount = 0;
+
             objectIDs = new Dictionary<IPhysicsObject, IntPtr>();
             reverseIDs = new Dictionary<IntPtr, IPhysicsObject>();
             scaleTable = new Dictionary<IntPtr, Vector3>();
+
+            destructibles = new Dictionary<IPhysicsObject, DestructibleObject>();
+
+            vehicles = new List<HavokVehicle>();
+            vehicleIDs = new Dictionary<HavokVehicle, IntPtr>();
+            vehicleInputs = new float[0];
+            wheelTransforms = new float[0];
+
+            depthFields = new List<IntPtr>();
+
+            cullPlanes = new float[0];
+            cullCorners = new float[0];
+            frustumCorners = new Vector3[8];
+            cullBodies = new IntPtr[0];
+            cullMasks = new int[0];
+
+            contactBodies = new IntPtr[0];
+            contactCounts = new int[0];
+            contactPartners = new IntPtr[0];
+            contactNormals = new float[0];
+            contactDepths = new float[0];
         }
 
         #endregion
@@ -385,6 +475,65 @@ namespace GoblinXNA.Physics.Havok
             get { return info; }
         }
 
+        /// <summary>
+        /// Gets or sets the time in seconds one call to the physics engine's update may take before
+        /// it defers the work that can wait to later updates: adding objects whose shapes were built
+        /// in the background, breaking destructible objects, and refreshing the snapshot used by 
+        /// the snapshot queries. The simulation step itself always runs. Default value is 0, which
+        /// turns the budget off.
+        /// </summary>
+        public float StepBudget
+        {
+            get { return stepBudget; }
+            set
+            {
+                stepBudget = value;
+                HavokDllBridge.set_step_budget(stepBudget, deferBodyAdds);
+            }
+        }
+
+        /// <summary>
+        /// Gets or sets whether AddPhysicsObject only queues objects, which are then added to the
+        /// simulation by Update while StepBudget allows, so that spawning many objects at once is
+        /// spread over several frames. Has no effect unless StepBudget is above 0. Default value
+        /// is false.
+        /// </summary>
+        /// <see cref="IsPhysicsObjectReady"/>
+        public bool DeferBodyAdds
+        {
+            get { return deferBodyAdds; }
+            set
+            {
+                deferBodyAdds = value;
+                HavokDllBridge.set_step_budget(stepBudget, deferBodyAdds);
+            }
+        }
+
+        /// <summary>
+        /// Gets the time in seconds the simulation steps of the last Update took.
+        /// </summary>
+        public float LastStepTime
+        {
+            get { return lastStepTime; }
+        }
+
+        /// <summary>
+        /// Gets the time in seconds the physics engine spent in the last Update, including the
+        /// simulation steps and the deferred work done within StepBudget.
+        /// </summary>
+        public float LastUpdateTime
+        {
+            get { return lastUpdateTime; }
+        }
+
+        /// <summary>
+        /// Gets the number of work items still deferred after the last Update because of StepBudget.
+        /// </summary>
+        public int DeferredWorkCount
+        {
+            get { return deferredWorkCount; }
+        }
+
         #endregion
 
         #region Public Methods
@@ -404,14 +553,27 @@ namespace GoblinXNA.Physics.Havok
 
             InitializePhysics();
 
-            List<IPhysicsObject> physObjs = new List<IPhysicsObject>(objectIDs.Keys);
+            // Destructible objects are added again intact, with the fragments they still have
+            Dictionary<IPhysicsObject, DestructibleObject> oldDestructibles =
+                new Dictionary<IPhysicsObject, DestructibleObject>(destructibles);
+            List<IPhysicsObject> physObjs = new List<IPhysicsObject>();
+            foreach (IPhysicsObject physObj in objectIDs.Keys)
+                if (!IsDestructiblePart(physObj))
+                    physObjs.Add(physObj);
 
             objectIDs.Clear();
             reverseIDs.Clear();
             scaleTable.Clear();
+            vehicles.Clear();
+            vehicleIDs.Clear();
+            depthFields.Clear();
+            destructibles.Clear();
 
             foreach (IPhysicsObject physObj in physObjs)
                 AddPhysicsObject(physObj);
+
+            foreach (KeyValuePair<IPhysicsObject, DestructibleObject> pair in oldDestructibles)
+                AddDestructibleObject(pair.Key, pair.Value.Fragments, pair.Value.BreakSpeed, pair.Value.Callback);
         }
 
         public void AddPhysicsObject(IPhysicsObject physObj)
@@ -457,16 +619,25 @@ namespace GoblinXNA.Physics.Havok
             Vector3 scale;
             physObj.CompoundInitialWorldTransform.Decompose(out scale, out rotation, out trans);
 
-            IntPtr shape = GetCollisionShape(physObj, scale);
+            bool cookInBackground = CooksShapeInBackground(physObj);
+            IntPtr shape = GetCollisionShape(physObj, scale, cookInBackground);
 
             float[] pos = Vector3Helper.ToFloats(ref trans);
             float[] rot = { rotation.X, rotation.Y, rotation.Z, rotation.W };
 
-            IntPtr body = HavokDllBridge.add_rigid_body(shape, physObj.Mass, motionType, qualityType,
-                pos, rot, Vector3Helper.ToFloats(physObj.InitialLinearVelocity), physObj.LinearDamping,
-                maxLinearVelocity, Vector3Helper.ToFloats(physObj.InitialAngularVelocity), 
-                physObj.AngularDamping.X, maxAngularVelocity, friction, restitution, 
-                allowedPenetrationDepth, physObj.NeverDeactivate, gravityFactor);
+            IntPtr body;
+            if (cookInBackground)
+                body = HavokDllBridge.add_pending_rigid_body(shape, physObj.Mass, motionType, qualityType,
+                    pos, rot, Vector3Helper.ToFloats(physObj.InitialLinearVelocity), physObj.LinearDamping,
+                    maxLinearVelocity, Vector3Helper.ToFloats(physObj.InitialAngularVelocity), 
+                    physObj.AngularDamping.X, maxAngularVelocity, friction, restitution, 
+                    allowedPenetrationDepth, physObj.NeverDeactivate, gravityFactor);
+            else
+                body = HavokDllBridge.add_rigid_body(shape, physObj.Mass, motionType, qualityType,
+                    pos, rot, Vector3Helper.ToFloats(physObj.InitialLinearVelocity), physObj.LinearDamping,
+                    maxLinearVelocity, Vector3Helper.ToFloats(physObj.InitialAngularVelocity), 
+                    physObj.AngularDamping.X, maxAngularVelocity, friction, restitution, 
+                    allowedPenetrationDepth, physObj.NeverDeactivate, gravityFactor);
 
             objectIDs.Add(physObj, body);
             reverseIDs.Add(body, physObj);
@@ -481,6 +652,121 @@ namespace GoblinXNA.Physics.Havok
                         ((HavokObject)physObj).CollisionStartCallback,
                         ((HavokObject)physObj).CollisionEndCallback);
             }
+
+            if ((physObj is HavokVehicle) && ((HavokVehicle)physObj).Wheels.Count > 0)
+            {
+                HavokVehicle vehicle = (HavokVehicle)physObj;
+                IntPtr vehicleID = HavokDllBridge.add_vehicle(body, vehicle.Wheels.Count, 
+                    vehicle.GetWheelParams());
+
+                vehicles.Add(vehicle);
+                vehicleIDs.Add(vehicle, vehicleID);
+                ResizeVehicleBuffers();
+            }
+        }
+
+        /// <summary>
+        /// Adds a pre-fractured object that is simulated as a single compound body until something
+        /// hits it faster than 'breakSpeed', at which point the wrapper replaces it with its fragments
+        /// within the same update. The fragment bodies are created here and pooled, so breaking the
+        /// object does not allocate. 
+        /// </summary>
+        /// <remarks>
+        /// The fragments should be positioned by their CompoundInitialWorldTransform the way they
+        /// fit together in the intact object, and are not part of the simulation until it breaks.
+        /// </remarks>
+        /// <param name="intactObj">The physics object of the intact piece. Its own shape is not used.</param>
+        /// <param name="fragments">The physics objects of the fragments</param>
+        /// <param name="breakSpeed">The contact speed that breaks the object</param>
+        /// <param name="callback">Called with the body of the intact object when it breaks. Can be null.</param>
+        public void AddDestructibleObject(IPhysicsObject intactObj, IList<IPhysicsObject> fragments, 
+            float breakSpeed, HavokDllBridge.DestructibleBreakCallback callback)
+        {
+            if (objectIDs.ContainsKey(intactObj) || fragments.Count == 0)
+                return;
+
+            intactObj.PhysicsWorldTransform = intactObj.CompoundInitialWorldTransform;
+
+            Quaternion rotation;
+            Vector3 trans;
+            Vector3 scale;
+            intactObj.CompoundInitialWorldTransform.Decompose(out scale, out rotation, out trans);
+            Quaternion invRotation = Quaternion.Inverse(rotation);
+
+            IntPtr[] shapes = new IntPtr[fragments.Count];
+            float[] localPos = new float[fragments.Count * 3];
+            float[] localRot = new float[fragments.Count * 4];
+            float[] masses = new float[fragments.Count];
+            Vector3[] fragmentScales = new Vector3[fragments.Count];
+            for (int i = 0; i < fragments.Count; i++)
+            {
+                Quaternion fragRotation;
+                Vector3 fragTrans;
+                fragments[i].CompoundInitialWorldTransform.Decompose(out fragmentScales[i], out fragRotation, 
+                    out fragTrans);
+                fragments[i].PhysicsWorldTransform = fragments[i].CompoundInitialWorldTransform;
+
+                shapes[i] = GetCollisionShape(fragments[i], fragmentScales[i]);
+                masses[i] = fragments[i].Mass;
+
+                Vector3 fragLocalTrans = Vector3.Transform(fragTrans - trans, invRotation);
+                Quaternion fragLocalRotation = invRotation * fragRotation;
+                localPos[i * 3] = fragLocalTrans.X;
+                localPos[i * 3 + 1] = fragLocalTrans.Y;
+                localPos[i * 3 + 2] = fragLocalTrans.Z;
+                localRot[i * 4] = fragLocalRotation.X;
+                localRot[i * 4 + 1] = fragLocalRotation.Y;
+                localRot[i * 4 + 2] = fragLocalRotation.Z;
+                localRot[i * 4 + 3] = fragLocalRotation.W;
+            }
+
+            float friction = -1;
+            float restitution = -1;
+            if (intactObj is HavokObject)
+            {
+                friction = ((HavokObject)intactObj).Friction;
+                restitution = ((HavokObject)intactObj).Restitution;
+            }
+
+            float[] rot = { rotation.X, rotation.Y, rotation.Z, rotation.W };
+            IntPtr[] fragmentBodies = new IntPtr[fragments.Count];
+            IntPtr body = HavokDllBridge.add_destructible(fragments.Count, shapes, localPos, localRot, masses,
+                Vector3Helper.ToFloats(ref trans), rot, friction, restitution, breakSpeed, callback, 
+                fragmentBodies);
+            if (body == IntPtr.Zero)
+                throw new GoblinException("Failed to add the destructible object");
+
+            objectIDs.Add(intactObj, body);
+            reverseIDs.Add(body, intactObj);
+            scaleTable.Add(body, scale);
+
+            for (int i = 0; i < fragments.Count; i++)
+            {
+                objectIDs.Add(fragments[i], fragmentBodies[i]);
+                reverseIDs.Add(fragmentBodies[i], fragments[i]);
+                scaleTable.Add(fragmentBodies[i], fragmentScales[i]);
+            }
+
+            DestructibleObject destructible = new DestructibleObject();
+            destructible.Fragments = new List<IPhysicsObject>(fragments);
+            destructible.BreakSpeed = breakSpeed;
+            destructible.Callback = callback;
+            destructibles.Add(intactObj, destructible);
+        }
+
+        /// <summary>
+        /// Gets whether a physics object is part of the simulation. This is only false for an object
+        /// whose HavokObject.CookShapeInBackground is set and whose shape is still being built, or
+        /// that was queued because of DeferBodyAdds and not added yet.
+        /// </summary>
+        /// <param name="physObj">A physics object added with AddPhysicsObject</param>
+        /// <returns></returns>
+        public bool IsPhysicsObjectReady(IPhysicsObject physObj)
+        {
+            if (!objectIDs.ContainsKey(physObj))
+                throw new GoblinException("This physics object is not added to the physics engine");
+
+            return !HavokDllBridge.is_body_pending(objectIDs[physObj]);
         }
 
         public BoundingBox GetAxisAlignedBoundingBox(IPhysicsObject physObj)
@@ -514,9 +800,28 @@ namespace GoblinXNA.Physics.Havok
 
         public void RemovePhysicsObject(IPhysicsObject physObj)
         {
+            if (destructibles.ContainsKey(physObj))
+            {
+                RemoveDestructibleObject(physObj);
+                return;
+            }
+
             if (objectIDs.ContainsKey(physObj))
             {
+                if ((physObj is HavokVehicle) && vehicleIDs.ContainsKey((HavokVehicle)physObj))
+                {
+                    HavokDllBridge.remove_vehicle(vehicleIDs[(HavokVehicle)physObj]);
+                    vehicles.Remove((HavokVehicle)physObj);
+                    vehicleIDs.Remove((HavokVehicle)physObj);
+                    ResizeVehicleBuffers();
+                }
+
+                // A fragment of a destructible object is also dropped from the object, so it is not
+                // added when the object breaks
                 HavokDllBridge.remove_rigid_body(objectIDs[physObj]);
+                foreach (DestructibleObject destructible in destructibles.Values)
+                    if (destructible.Fragments.Remove(physObj))
+                        break;
 
                 reverseIDs.Remove(objectIDs[physObj]);
                 scaleTable.Remove(objectIDs[physObj]);
@@ -524,6 +829,31 @@ namespace GoblinXNA.Physics.Havok
             }
         }
 
+        /// <summary>
+        /// Removes a destructible object added with AddDestructibleObject(...), together with all
+        /// of its fragments, whether it broke or not.
+        /// </summary>
+        /// <param name="intactObj">The physics object of the intact piece</param>
+        public void RemoveDestructibleObject(IPhysicsObject intactObj)
+        {
+            if (!destructibles.ContainsKey(intactObj))
+                return;
+
+            HavokDllBridge.remove_destructible(objectIDs[intactObj]);
+
+            foreach (IPhysicsObject fragment in destructibles[intactObj].Fragments)
+            {
+                reverseIDs.Remove(objectIDs[fragment]);
+                scaleTable.Remove(objectIDs[fragment]);
+                objectIDs.Remove(fragment);
+            }
+
+            reverseIDs.Remove(objectIDs[intactObj]);
+            scaleTable.Remove(objectIDs[intactObj]);
+            objectIDs.Remove(intactObj);
+            destructibles.Remove(intactObj);
+        }
+
         public virtual void Update(float elapsedTime)
         {
             if (pauseSimulation)
@@ -531,15 +861,37 @@ namespace GoblinXNA.Physics.Havok
 
             elapsedTime *= simulationSpeed;
 
+            if (vehicles.Count > 0)
+            {
+                for (int i = 0; i < vehicles.Count; i++)
+                {
+                    vehicleInputs[i * 3] = vehicles[i].Steering;
+                    vehicleInputs[i * 3 + 1] = vehicles[i].DriveForce;
+                    vehicleInputs[i * 3 + 2] = vehicles[i].BrakeForce;
+                }
+                HavokDllBridge.set_vehicle_inputs(vehicleInputs);
+            }
+
+            float stepSeconds = 0, updateSeconds = 0;
+            lastStepTime = 0;
+            lastUpdateTime = 0;
             if (numSubSteps > 1)
             {
                 int updateTime = Math.Max((int)(Math.Round(elapsedTime / simulationTimeStep)), 1);
                 updateTime = Math.Min(numSubSteps, updateTime);
                 for (int i = 0; i < updateTime; i++)
+                {
                     HavokDllBridge.update(simulationTimeStep);
+                    deferredWorkCount = HavokDllBridge.get_step_stats(ref stepSeconds, ref updateSeconds);
+                    lastStepTime += stepSeconds;
+                    lastUpdateTime += updateSeconds;
+                }
             }
             else
+            {
                 HavokDllBridge.update(elapsedTime);
+                deferredWorkCount = HavokDllBridge.get_step_stats(ref lastStepTime, ref lastUpdateTime);
+            }
 
             IntPtr bodyPtr = Marshal.AllocHGlobal(objectIDs.Count * sizeof(int));
             IntPtr transformPtr = Marshal.AllocHGlobal(objectIDs.Count * sizeof(float) * 16);
@@ -576,6 +928,25 @@ namespace GoblinXNA.Physics.Havok
 
             Marshal.FreeHGlobal(bodyPtr);
             Marshal.FreeHGlobal(transformPtr);
+
+            if (vehicles.Count > 0)
+            {
+                HavokDllBridge.get_wheel_transforms(wheelTransforms);
+
+                int index = 0;
+                foreach (HavokVehicle vehicle in vehicles)
+                {
+                    foreach (HavokVehicle.Wheel wheel in vehicle.Wheels)
+                    {
+                        wheel.Transform = new Matrix(
+                            wheelTransforms[index], wheelTransforms[index + 1], wheelTransforms[index + 2], wheelTransforms[index + 3],
+                            wheelTransforms[index + 4], wheelTransforms[index + 5], wheelTransforms[index + 6], wheelTransforms[index + 7],
+                            wheelTransforms[index + 8], wheelTransforms[index + 9], wheelTransforms[index + 10], wheelTransforms[index + 11],
+                            wheelTransforms[index + 12], wheelTransforms[index + 13], wheelTransforms[index + 14], wheelTransforms[index + 15]);
+                        index += 16;
+                    }
+                }
+            }
         }
 
         public void Dispose()
@@ -584,6 +955,10 @@ namespace GoblinXNA.Physics.Havok
             objectIDs.Clear();
             reverseIDs.Clear();
             scaleTable.Clear();
+            vehicles.Clear();
+            vehicleIDs.Clear();
+            depthFields.Clear();
+            destructibles.Clear();
         }
 
         #endregion
@@ -736,11 +1111,351 @@ namespace GoblinXNA.Physics.Havok
             HavokDllBridge.add_world_leave_callback(callback);
         }
 
+        /// <summary>
+        /// Casts a ray against the state of the physics objects at the end of the last completed 
+        /// Update(...). Unlike the other queries, this can be called from any thread, and never waits
+        /// for a simulation step that is running on the physics thread.
+        /// </summary>
+        /// <param name="from">The start of the ray</param>
+        /// <param name="to">The end of the ray</param>
+        /// <param name="hitObj">The closest physics object hit by the ray</param>
+        /// <param name="hitFraction">The fraction of the ray from 'from' to the hit point</param>
+        /// <param name="normal">The surface normal at the hit point</param>
+        /// <returns>Whether the ray hit any physics object</returns>
+        public bool SnapshotRayCast(Vector3 from, Vector3 to, out IPhysicsObject hitObj, out float hitFraction,
+            out Vector3 normal)
+        {
+            IntPtr body = IntPtr.Zero;
+            float[] hitNormal = new float[3];
+            hitFraction = 1;
+
+            bool hit = HavokDllBridge.snapshot_cast_ray(Vector3Helper.ToFloats(ref from), 
+                Vector3Helper.ToFloats(ref to), ref body, ref hitFraction, hitNormal);
+
+            normal = Vector3Helper.FromFloats(hitNormal);
+            hitObj = hit ? GetPhysicsObject(body) : null;
+            return hitObj != null;
+        }
+
+        /// <summary>
+        /// Finds the physics objects whose bounding boxes overlap 'box' at the end of the last 
+        /// completed Update(...). Can be called from any thread.
+        /// </summary>
+        /// <param name="box">The box to test</param>
+        /// <param name="physObjs">Cleared and filled with the overlapping physics objects</param>
+        /// <returns>The number of overlapping physics objects</returns>
+        public int SnapshotOverlap(BoundingBox box, List<IPhysicsObject> physObjs)
+        {
+            physObjs.Clear();
+
+            IntPtr[] bodies = new IntPtr[objectIDs.Count];
+            int count = HavokDllBridge.snapshot_overlap_aabb(Vector3Helper.ToFloats(ref box.Min), 
+                Vector3Helper.ToFloats(ref box.Max), bodies.Length, bodies);
+
+            for (int i = 0; i < count; i++)
+            {
+                IPhysicsObject physObj = GetPhysicsObject(bodies[i]);
+                if (physObj != null)
+                    physObjs.Add(physObj);
+            }
+
+            return physObjs.Count;
+        }
+
+        /// <summary>
+        /// Finds the physics object whose bounding box is closest to 'point' at the end of the last
+        /// completed Update(...). Can be called from any thread.
+        /// </summary>
+        /// <param name="point">The point to measure from</param>
+        /// <param name="maxDistance">The maximum distance to search</param>
+        /// <param name="distance">The distance from 'point' to the bounding box of the found object</param>
+        /// <returns>The closest physics object, or null if none is within 'maxDistance'</returns>
+        public IPhysicsObject SnapshotNearestObject(Vector3 point, float maxDistance, out float distance)
+        {
+            IntPtr body = IntPtr.Zero;
+            distance = 0;
+
+            if (!HavokDllBridge.snapshot_nearest_body(Vector3Helper.ToFloats(ref point), maxDistance, 
+                ref body, ref distance))
+                return null;
+
+            return GetPhysicsObject(body);
+        }
+
+        /// <summary>
+        /// Finds the physics objects whose bounding boxes in the Havok broadphase intersect any of 
+        /// the given view frusta, such as the left and right eye frusta of a stereo camera. This reuses
+        /// the bounding boxes the physics engine already maintains for culling.
+        /// </summary>
+        /// <param name="frusta">Up to 32 view frusta</param>
+        /// <param name="physObjs">Cleared and filled with the physics objects in any of the frusta</param>
+        /// <param name="frustumMasks">Cleared and filled with a bit mask for each found physics object,
+        /// in which bit i is set if the object is in frusta[i]</param>
+        /// <returns>The number of physics objects found</returns>
+        public int GetObjectsInFrusta(IList<BoundingFrustum> frusta, List<IPhysicsObject> physObjs,
+            List<int> frustumMasks)
+        {
+            physObjs.Clear();
+            frustumMasks.Clear();
+
+            int numFrusta = Math.Min(frusta.Count, 32);
+            if (numFrusta == 0 || objectIDs.Count == 0)
+                return 0;
+
+            if (cullPlanes.Length < numFrusta * 24)
+            {
+                cullPlanes = new float[numFrusta * 24];
+                cullCorners = new float[numFrusta * 24];
+            }
+
+            if (cullBodies.Length < objectIDs.Count)
+            {
+                cullBodies = new IntPtr[objectIDs.Count];
+                cullMasks = new int[objectIDs.Count];
+            }
+
+            for (int i = 0; i < numFrusta; i++)
+            {
+                BoundingFrustum frustum = frusta[i];
+                SetCullPlane(i * 6, frustum.Near);
+                SetCullPlane(i * 6 + 1, frustum.Far);
+                SetCullPlane(i * 6 + 2, frustum.Left);
+                SetCullPlane(i * 6 + 3, frustum.Right);
+                SetCullPlane(i * 6 + 4, frustum.Top);
+                SetCullPlane(i * 6 + 5, frustum.Bottom);
+
+                frustum.GetCorners(frustumCorners);
+                for (int j = 0; j < 8; j++)
+                {
+                    int index = (i * 8 + j) * 3;
+                    cullCorners[index] = frustumCorners[j].X;
+                    cullCorners[index + 1] = frustumCorners[j].Y;
+                    cullCorners[index + 2] = frustumCorners[j].Z;
+                }
+            }
+
+            // The broadphase also returns bodies that have no physics object, such as the tiles of a
+            // depth field, so the buffers may fill up before all of the objects are found
+            int count = 0;
+            while (true)
+            {
+                count = HavokDllBridge.cull_bodies(numFrusta, cullPlanes, cullCorners, cullBodies.Length,
+                    cullBodies, cullMasks);
+                if (count < cullBodies.Length)
+                    break;
+
+                cullBodies = new IntPtr[cullBodies.Length * 2];
+                cullMasks = new int[cullBodies.Length];
+            }
+
+            for (int i = 0; i < count; i++)
+            {
+                if (!reverseIDs.ContainsKey(cullBodies[i]))
+                    continue;
+
+                physObjs.Add(reverseIDs[cullBodies[i]]);
+                frustumMasks.Add(cullMasks[i]);
+            }
+
+            return physObjs.Count;
+        }
+
+        /// <summary>
+        /// Finds the bodies currently touching each of the given physics objects in one call, which
+        /// is much cheaper than accumulating contact callbacks for ground checks and the like.
+        /// </summary>
+        /// <param name="physObjs">The physics objects to query</param>
+        /// <param name="contacts">Cleared and filled with the touching bodies of every queried 
+        /// object, grouped by the queried object in the order given</param>
+        /// <returns>The number of contacts found</returns>
+        public int GetContacts(IList<IPhysicsObject> physObjs, List<Contact> contacts)
+        {
+            contacts.Clear();
+
+            if (contactBodies.Length < physObjs.Count)
+            {
+                contactBodies = new IntPtr[physObjs.Count];
+                contactCounts = new int[physObjs.Count];
+            }
+
+            int numBodies = 0;
+            for (int i = 0; i < physObjs.Count; i++)
+            {
+                if (objectIDs.ContainsKey(physObjs[i]))
+                    contactBodies[numBodies++] = objectIDs[physObjs[i]];
+            }
+
+            if (numBodies == 0)
+                return 0;
+
+            int total = 0;
+            while (true)
+            {
+                if (contactPartners.Length < numBodies * 4)
+                    ResizeContactBuffers(numBodies * 4);
+
+                total = HavokDllBridge.get_contacts(numBodies, contactBodies, contactPartners.Length, 
+                    contactCounts, contactPartners, contactNormals, contactDepths);
+                if (total < contactPartners.Length)
+                    break;
+
+                // The buffers may have been too small to hold all of the contacts
+                ResizeContactBuffers(contactPartners.Length * 2);
+            }
+
+            int index = 0;
+            for (int i = 0; i < numBodies; i++)
+            {
+                IPhysicsObject body = reverseIDs[contactBodies[i]];
+                for (int j = 0; j < contactCounts[i]; j++, index++)
+                {
+                    if (!reverseIDs.ContainsKey(contactPartners[index]))
+                        continue;
+
+                    Contact contact;
+                    contact.Body = body;
+                    contact.Partner = reverseIDs[contactPartners[index]];
+                    contact.Normal = new Vector3(contactNormals[index * 3], contactNormals[index * 3 + 1],
+                        contactNormals[index * 3 + 2]);
+                    contact.Depth = contactDepths[index];
+                    contacts.Add(contact);
+                }
+            }
+
+            return contacts.Count;
+        }
+
+        /// <summary>
+        /// Adds static collision geometry built from the frames of a depth camera, so that physics
+        /// objects collide with the real scene. The image is split into square tiles, and each tile
+        /// becomes a box whose front face is at the nearest depth in the tile. Call UpdateDepthField 
+        /// with every new depth frame.
+        /// </summary>
+        /// <param name="width">The width of the depth image in pixels</param>
+        /// <param name="height">The height of the depth image in pixels</param>
+        /// <param name="tileSize">The width and height of a tile in pixels</param>
+        /// <param name="focalLength">The focal lengths of the depth camera in pixels</param>
+        /// <param name="principalPoint">The principal point of the depth camera in pixels</param>
+        /// <param name="depthScale">The scale from a shifted depth value to meters</param>
+        /// <param name="depthShift">The number of low bits of a depth value that are not depth. For
+        /// the Kinect, this is 3 since the low bits hold the player index.</param>
+        /// <param name="nearDepth">The nearest depth in meters that is used</param>
+        /// <param name="farDepth">The farthest depth in meters that is used</param>
+        /// <param name="thickness">The thickness of each box</param>
+        /// <param name="threshold">How much the depth of a tile needs to change before its box
+        /// is moved</param>
+        /// <param name="maxUpdates">The maximum number of boxes moved in each update, which bounds
+        /// the cost of an update</param>
+        /// <returns>The handle of the depth field</returns>
+        public IntPtr AddDepthField(int width, int height, int tileSize, Vector2 focalLength, 
+            Vector2 principalPoint, float depthScale, int depthShift, float nearDepth, float farDepth,
+            float thickness, float threshold, int maxUpdates)
+        {
+            float[] intrinsics = { focalLength.X, focalLength.Y, principalPoint.X, principalPoint.Y };
+            IntPtr field = HavokDllBridge.add_depth_field(width, height, tileSize, intrinsics, depthScale,
+                depthShift, nearDepth, farDepth, thickness, threshold, maxUpdates);
+            depthFields.Add(field);
+
+            return field;
+        }
+
+        /// <summary>
+        /// Updates the collision geometry of a depth field from a depth frame.
+        /// </summary>
+        /// <param name="field">The handle returned by AddDepthField</param>
+        /// <param name="depth">The depth frame, such as the one passed to the depth callback of
+        /// KinectMSCapture or one loaded with LoadDepthFrame</param>
+        /// <param name="cameraTransform">The transform of the depth camera in the world, which looks
+        /// down -Z with +Y up</param>
+        public void UpdateDepthField(IntPtr field, short[] depth, Matrix cameraTransform)
+        {
+            HavokDllBridge.update_depth_field(field, depth, MatrixHelper.ToFloats(cameraTransform));
+        }
+
+        public void RemoveDepthField(IntPtr field)
+        {
+            if (depthFields.Remove(field))
+                HavokDllBridge.remove_depth_field(field);
+        }
+
+        /// <summary>
+        /// Loads a recorded depth frame stored as raw 16 bit little endian pixels, so that a depth
+        /// field can be driven without a camera.
+        /// </summary>
+        /// <param name="filename">The file of the recorded frame</param>
+        /// <param name="depth">The array to fill with the frame</param>
+        public static void LoadDepthFrame(String filename, short[] depth)
+        {
+            byte[] raw = File.ReadAllBytes(filename);
+            if (raw.Length != depth.Length * sizeof(short))
+                throw new GoblinException(filename + " does not hold a depth frame of " + depth.Length +
+                    " pixels");
+
+            Buffer.BlockCopy(raw, 0, depth, 0, raw.Length);
+        }
+
         #endregion
 
         #region Helper Functions
 
+        private bool IsDestructiblePart(IPhysicsObject physObj)
+        {
+            if (destructibles.ContainsKey(physObj))
+                return true;
+
+            foreach (DestructibleObject destructible in destructibles.Values)
+                if (destructible.Fragments.Contains(physObj))
+                    return true;
+
+            return false;
+        }
+
+        private void SetCullPlane(int index, Plane plane)
+        {
+            cullPlanes[index * 4] = plane.Normal.X;
+            cullPlanes[index * 4 + 1] = plane.Normal.Y;
+            cullPlanes[index * 4 + 2] = plane.Normal.Z;
+            cullPlanes[index * 4 + 3] = plane.D;
+        }
+
+        private void ResizeVehicleBuffers()
+        {
+            int numWheels = 0;
+            foreach (HavokVehicle vehicle in vehicles)
+                numWheels += vehicle.Wheels.Count;
+
+            vehicleInputs = new float[vehicles.Count * 3];
+            wheelTransforms = new float[numWheels * 16];
+        }
+
+        private void ResizeContactBuffers(int capacity)
+        {
+            contactPartners = new IntPtr[capacity];
+            contactNormals = new float[capacity * 3];
+            contactDepths = new float[capacity];
+        }
+
+        private bool CooksShapeInBackground(IPhysicsObject physObj)
+        {
+            if (!(physObj is HavokObject) || (physObj is HavokVehicle))
+                return false;
+
+            HavokObject havokObj = (HavokObject)physObj;
+            return havokObj.CookShapeInBackground && !havokObj.IsPhantom &&
+                (physObj.Shape == ShapeType.ConvexHull || physObj.Shape == ShapeType.TriangleMesh);
+        }
+
         private IntPtr GetCollisionShape(IPhysicsObject physObj, Vector3 scale)
+        {
+            return GetCollisionShape(physObj, scale, false);
+        }
+
+        /// <summary>
+        /// Creates the collision shape of a physics object. If 'inBackground' is true, a ConvexHull or
+        /// TriangleMesh shape is queued on the wrapper's worker thread, and the returned handle
+        /// has to be passed to add_pending_rigid_body instead of add_rigid_body.
+        /// </summary>
+        private IntPtr GetCollisionShape(IPhysicsObject physObj, Vector3 scale, bool inBackground)
         {
             IntPtr collisionShape = IntPtr.Zero;
 
@@ -825,27 +1540,44 @@ namespace GoblinXNA.Physics.Havok
                         vertexCloud[i * 3 + 2] = vertices[i].Z * scale.Z;
                     }
 
-                    collisionShape = HavokDllBridge.create_convex_shape(vertices.Count, vertexCloud,
-                        sizeof(float) * 3, convexRadius);
+                    if (inBackground)
+                        collisionShape = HavokDllBridge.create_convex_shape_async(vertices.Count, vertexCloud,
+                            sizeof(float) * 3, convexRadius);
+                    else
+                        collisionShape = HavokDllBridge.create_convex_shape(vertices.Count, vertexCloud,
+                            sizeof(float) * 3, convexRadius);
 
                     break;
                 case ShapeType.TriangleMesh:
                     if(physObj.MeshProvider == null)
                         throw new GoblinException("MeshProvider cannot be null to construct TriangleMesh shape");
 
-                    List<int> indices = physObj.MeshProvider.Indices;
-                    vertices = physObj.MeshProvider.Vertices;
+                    bool weldEdges = (physObj is HavokObject) && ((HavokObject)physObj).WeldMeshEdges;
+                    bool weldVertices = (physObj is HavokObject) && ((HavokObject)physObj).WeldMeshVertices;
+                    Vector3[] meshVertices = physObj.MeshProvider.Vertices.ToArray();
+                    int[] meshIndices = physObj.MeshProvider.Indices.ToArray();
 
-                    vertexCloud = new float[vertices.Count * 3];
-                    for (int i = 0; i < vertices.Count; i++)
+                    // The wrapper scales the vertices while making its own copy of the buffers
+                    GCHandle vertexHandle = GCHandle.Alloc(meshVertices, GCHandleType.Pinned);
+                    GCHandle indexHandle = GCHandle.Alloc(meshIndices, GCHandleType.Pinned);
+                    try
                     {
-                        vertexCloud[i * 3] = vertices[i].X * scale.X;
-                        vertexCloud[i * 3 + 1] = vertices[i].Y * scale.Y;
-                        vertexCloud[i * 3 + 2] = vertices[i].Z * scale.Z;
+                        if (inBackground)
+                            collisionShape = HavokDllBridge.create_strided_mesh_shape_async(meshVertices.Length,
+                                vertexHandle.AddrOfPinnedObject(), sizeof(float) * 3, meshIndices.Length / 3,
+                                indexHandle.AddrOfPinnedObject(), sizeof(int), Vector3Helper.ToFloats(ref scale),
+                                weldEdges, weldVertices, convexRadius);
+                        else
+                            collisionShape = HavokDllBridge.create_strided_mesh_shape(meshVertices.Length,
+                                vertexHandle.AddrOfPinnedObject(), sizeof(float) * 3, meshIndices.Length / 3,
+                                indexHandle.AddrOfPinnedObject(), sizeof(int), Vector3Helper.ToFloats(ref scale),
+                                true, weldEdges, weldVertices, convexRadius);
+                    }
+                    finally
+                    {
+                        vertexHandle.Free();
+                        indexHandle.Free();
                     }
-
-                    collisionShape = HavokDllBridge.create_mesh_shape(vertices.Count, vertexCloud,
-                        sizeof(float) * 3, indices.Count / 3, indices.ToArray(), convexRadius);
                         
                     break;
                 case ShapeType.Compound:
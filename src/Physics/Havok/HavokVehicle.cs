@@ -0,0 +1,193 @@
+﻿/************************************************************************************ 
+ * Copyright (c) 2008-2012, Columbia University
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the Columbia University nor the
+ *       names of its contributors may be used to endorse or promote products
+ *       derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY COLUMBIA UNIVERSITY ''AS IS'' AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL <copyright holder> BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * 
+ * 
+ * ===================================================================================
+ * Author: Ohan Oda (ohan@cs.columbia.edu)
+ * 
+ *************************************************************************************/ 
+
+using System;
+using System.Collections.Generic;
+using System.Linq;
+using System.Text;
+
+using Microsoft.Xna.Framework;
+
+namespace GoblinXNA.Physics.Havok
+{
+    /// <summary>
+    /// A Havok physics object that drives like a car. Each wheel is a ray cast down from a hard
+    /// point on the chassis, and the suspension and tire forces are computed natively inside the
+    /// simulation step. The chassis should face -Z with +Y up in its local space.
+    /// </summary>
+    public class HavokVehicle : HavokObject
+    {
+        #region Structs
+
+        public class Wheel
+        {
+            /// <summary>
+            /// The point on the chassis, in its local space, where the suspension is attached.
+            /// </summary>
+            public Vector3 HardPoint;
+            /// <summary>
+            /// The length of the suspension when it is not loaded.
+            /// </summary>
+            public float SuspensionLength;
+            /// <summary>
+            /// The spring constant of the suspension per unit of chassis mass.
+            /// </summary>
+            public float SuspensionStiffness;
+            /// <summary>
+            /// The damping constant of the suspension per unit of chassis mass.
+            /// </summary>
+            public float SuspensionDamping;
+            public float Radius;
+            /// <summary>
+            /// The ratio of the tire force to the suspension load at which the tire starts to slide.
+            /// </summary>
+            public float Friction;
+            /// <summary>
+            /// Multiplied to the steering angle of the vehicle. Typically 1 for front wheels and 0 
+            /// for rear wheels.
+            /// </summary>
+            public float SteeringFactor;
+            /// <summary>
+            /// The share of the drive force applied by this wheel.
+            /// </summary>
+            public float DriveFactor;
+            /// <summary>
+            /// The world transform of the wheel after the last physics update.
+            /// </summary>
+            public Matrix Transform;
+
+            public Wheel()
+            {
+                SuspensionLength = 0.3f;
+                SuspensionStiffness = 50;
+                SuspensionDamping = 3;
+                Radius = 0.4f;
+                Friction = 1.5f;
+                SteeringFactor = 0;
+                DriveFactor = 0;
+                Transform = Matrix.Identity;
+            }
+        }
+
+        #endregion
+
+        #region Member Fields
+
+        private List<Wheel> wheels;
+
+        private float steering;
+        private float driveForce;
+        private float brakeForce;
+
+        #endregion
+
+        #region Constructor
+
+        public HavokVehicle(object container)
+            : base(container)
+        {
+            wheels = new List<Wheel>();
+
+            NeverDeactivate = true;
+        }
+
+        public HavokVehicle() : this(null) { }
+
+        #endregion
+
+        #region Properties
+
+        /// <summary>
+        /// Gets the wheels of this vehicle. Wheels need to be added before the vehicle is added to
+        /// the physics engine.
+        /// </summary>
+        public List<Wheel> Wheels
+        {
+            get { return wheels; }
+        }
+
+        /// <summary>
+        /// Gets or sets the steering angle in radians.
+        /// </summary>
+        public float Steering
+        {
+            get { return steering; }
+            set { steering = value; }
+        }
+
+        /// <summary>
+        /// Gets or sets the total force that drives the vehicle forward, shared by the wheels 
+        /// according to their DriveFactor.
+        /// </summary>
+        public float DriveForce
+        {
+            get { return driveForce; }
+            set { driveForce = value; }
+        }
+
+        /// <summary>
+        /// Gets or sets the force each wheel applies against its rolling direction.
+        /// </summary>
+        public float BrakeForce
+        {
+            get { return brakeForce; }
+            set { brakeForce = value; }
+        }
+
+        #endregion
+
+        #region Internal Methods
+
+        internal float[] GetWheelParams()
+        {
+            float[] wheelParams = new float[wheels.Count * 10];
+            for (int i = 0; i < wheels.Count; i++)
+            {
+                int index = i * 10;
+                wheelParams[index] = wheels[i].HardPoint.X;
+                wheelParams[index + 1] = wheels[i].HardPoint.Y;
+                wheelParams[index + 2] = wheels[i].HardPoint.Z;
+                wheelParams[index + 3] = wheels[i].SuspensionLength;
+                wheelParams[index + 4] = wheels[i].SuspensionStiffness * Mass;
+                wheelParams[index + 5] = wheels[i].SuspensionDamping * Mass;
+                wheelParams[index + 6] = wheels[i].Radius;
+                wheelParams[index + 7] = wheels[i].Friction;
+                wheelParams[index + 8] = wheels[i].SteeringFactor;
+                wheelParams[index + 9] = wheels[i].DriveFactor;
+            }
+
+            return wheelParams;
+        }
+
+        #endregion
+    }
+}
@@ -77,7 +77,11 @@ namespace GoblinXNA.SceneGraph
         #endregion
 
         #region Member Fields
-        protected const int VIDEO_BUFFER_SIZE = 1;
+        /// <summary>
+        /// Number of video image slots. The tracker writes into the back slot, publishes it as the
+        /// newest slot, and the renderer swaps the newest slot into the front slot without locking.
+        /// </summary>
+        protected const int VIDEO_BUFFER_SIZE = 3;
         /// <summary>
         /// The root node of this scene graph
         /// </summary>
@@ -234,12 +238,17 @@ namespace GoblinXNA.SceneGraph
 
         #region For Video Image Buffering
 
+        // Back slot written by the tracker, newest published slot, and front slot read by the renderer
         protected int curVideoBufferIndex;
-        protected int prevVideoBufferIndex;
-        protected int prevMarkerProcessedIndex;
-        protected bool renderingVideoTexture;
-        protected bool copyingVideoImage;
+        protected int newestVideoBufferIndex;
+        protected int frontVideoBufferIndex;
+        // 1 when newestVideoBufferIndex holds a frame the renderer has not finished taking yet
+        protected int newVideoFrameReady;
         protected int[][][] bufferedVideoImages;
+        // Whether the image of each eye was captured into the given slot
+        protected bool[][] bufferedVideoImageSet;
+        // Time at which the frame in each slot finished tracking
+        protected float[] bufferedTrackerTimes;
 #if WINDOWS
         protected IntPtr[] bufferedVideoPointers;
         protected IntPtr nullPtr = IntPtr.Zero;
@@ -248,6 +257,9 @@ namespace GoblinXNA.SceneGraph
 #endif
         protected int prevPointerSize;  
         protected bool readyToUpdateTracker;
+        // Signaled by the render loop whenever it has taken a frame, or the tracker thread became
+        // able to run, so the tracker thread can process the next frame without polling
+        protected AutoResetEvent trackerSignal;
 
         #endregion
 
@@ -260,13 +272,13 @@ namespace GoblinXNA.SceneGraph
         protected int trackerVideoID;
         protected bool freezeVideo;
 
-        // These variables are used to avoid updating the tracker while changing the video overlay
-        // ID or tracker ID, or visa versa
-        protected bool waitForVideoIDChange;
-        protected bool waitForTrackerUpdate;
+        // Held by the tracker update and by the video overlay ID or tracker ID setters, so that
+        // the tracker is not updated while an ID changes, or visa versa. It starts signaled and 
+        // each side waits on it to take it and sets it to release it.
+        protected AutoResetEvent videoIDSignal;
 
-        // These variables are used for synchronizing the threaded (if State.MultiCore is true)
-        // tracker update with the actual frame update
+        // These variables count the threaded (if State.MultiCore is true) tracker updates and the
+        // actual frame updates; the two are synchronized through trackerSignal
         protected uint trackerUpdateCount;
         protected uint frameUpdateCount;
 
@@ -361,8 +373,7 @@ namespace GoblinXNA.SceneGraph
             trackerVideoID = 0;
 
             freezeVideo = false;
-            waitForVideoIDChange = false;
-            waitForTrackerUpdate = false;
+            videoIDSignal = new AutoResetEvent(true);
 
             shadowOccluderGeometries = new List<GeometryNode>();
             shadowBackgroundGeometries = new List<GeometryNode>();
@@ -379,6 +390,7 @@ namespace GoblinXNA.SceneGraph
             trackerUpdateCount = 0;
             frameUpdateCount = 0;
             readyToUpdateTracker = false;
+            trackerSignal = new AutoResetEvent(false);
 
             physicsElapsedTime = 0;
 
@@ -391,9 +403,12 @@ namespace GoblinXNA.SceneGraph
 
             // two per index for image buffers for stereo handling (even if stereo AR is not used)
             curVideoBufferIndex = 0;
-            prevVideoBufferIndex = 0;
-            prevMarkerProcessedIndex = 0;
+            newestVideoBufferIndex = 1;
+            frontVideoBufferIndex = 2;
+            newVideoFrameReady = 0;
             bufferedVideoImages = new int[2][][];
+            bufferedVideoImageSet = new bool[2][];
+            bufferedTrackerTimes = new float[VIDEO_BUFFER_SIZE];
             videoTextures = new Texture2D[2];
             backgroundBound = new Rectangle(0, 0, State.Width, State.Height);
 #if WINDOWS
@@ -404,7 +419,10 @@ namespace GoblinXNA.SceneGraph
             backgroundEffects = SpriteEffects.None;
 
             for (int i = 0; i < 2; i++)
+            {
                 bufferedVideoImages[i] = new int[VIDEO_BUFFER_SIZE][];
+                bufferedVideoImageSet[i] = new bool[VIDEO_BUFFER_SIZE];
+            }
 
             if (isMarkerTrackingThreaded)
             {
@@ -831,17 +849,17 @@ namespace GoblinXNA.SceneGraph
             get { return trackerVideoID; }
             set
             {
-                // Wait for the tracker update to end before modifying the ID
-                while (waitForTrackerUpdate) { }
-                waitForVideoIDChange = true;
                 if (videoCaptures.Count < value)
                     throw new GoblinException("VideoCaptures[" + value + "] do not exist. Make sure " +
                         "to add the desired IVideoCapture instance through AddVideoCaptureDevice method");
 
+                // Wait for the tracker update to end before modifying the ID
+                videoIDSignal.WaitOne();
+
                 trackerVideoID = value;
                 InitializeVideoPointerSize(videoCaptures[trackerVideoID]);
 
-                waitForVideoIDChange = false;
+                videoIDSignal.Set();
             }
         }
 
@@ -871,15 +889,14 @@ namespace GoblinXNA.SceneGraph
                 //        "camera node does not contain stereo information");
 
                 // Wait for the tracker update to end before modifying the ID
-                while (waitForTrackerUpdate) { }
-                waitForVideoIDChange = true;
+                videoIDSignal.WaitOne();
 
                 leftEyeVideoID = value;
                 InitializeVideoImageSize(0, videoCaptures[leftEyeVideoID]);
 
                 singleVideoStereo = (leftEyeVideoID == rightEyeVideoID);
 
-                waitForVideoIDChange = false;
+                videoIDSignal.Set();
             }
         }
 
@@ -909,15 +926,14 @@ namespace GoblinXNA.SceneGraph
                         "camera node does not contain stereo information");
 
                 // Wait for the tracker update to end before modifying the ID
-                while (waitForTrackerUpdate) { }
-                waitForVideoIDChange = true;
+                videoIDSignal.WaitOne();
 
                 rightEyeVideoID = value;
                 InitializeVideoImageSize(1, videoCaptures[rightEyeVideoID]);
 
                 singleVideoStereo = (leftEyeVideoID == rightEyeVideoID);
 
-                waitForVideoIDChange = false;
+                videoIDSignal.Set();
             }
         }
 
@@ -930,7 +946,12 @@ namespace GoblinXNA.SceneGraph
         public bool FreezeVideo
         {
             get { return freezeVideo; }
-            set { freezeVideo = value; }
+            set 
+            { 
+                freezeVideo = value;
+                if (!freezeVideo)
+                    trackerSignal.Set();
+            }
         }
 
         /// <summary>
@@ -1861,8 +1882,6 @@ namespace GoblinXNA.SceneGraph
                             }
                         }
 
-                        while (copyingVideoImage) { }
-                        renderingVideoTexture = true;
                         State.SharedSpriteBatch.Begin(SpriteSortMode.Immediate, BlendState.Opaque);
                         if (secondImage)
                         {
@@ -1880,7 +1899,6 @@ namespace GoblinXNA.SceneGraph
                         }
 
                         State.SharedSpriteBatch.End();
-                        renderingVideoTexture = false;
                     }
                     else if (backgroundTexture != null)
                     {
@@ -2158,16 +2176,18 @@ namespace GoblinXNA.SceneGraph
             {
                 while (isMarkerTrackingThreaded)
                 {
-                    if (readyToUpdateTracker && (videoCaptures.Count > 0))
+                    // Synchronize the frame update with tracker update. The render loop signals
+                    // once it has taken the newest frame together with its poses, so the tracker
+                    // state is never overwritten before the renderer has read it
+                    if (!readyToUpdateTracker || freezeVideo || (videoCaptures.Count == 0) ||
+                        (newVideoFrameReady != 0))
                     {
-                        // Synchronize the frame update with tracker update
-                        while (trackerUpdateCount > frameUpdateCount && isMarkerTrackingThreaded)
-                        {
-                            Thread.Sleep(10);
-                        }
-                        UpdateTrackerAndImage();
-                        trackerUpdateCount++;
+                        trackerSignal.WaitOne();
+                        continue;
                     }
+
+                    UpdateTrackerAndImage();
+                    trackerUpdateCount++;
                 }
             }
             else if(videoCaptures.Count > 0)
@@ -2183,8 +2203,7 @@ namespace GoblinXNA.SceneGraph
                 return;
 
             // Wait for video ID to change before updating the tracker and image
-            while (waitForVideoIDChange) { }
-            waitForTrackerUpdate = true;
+            videoIDSignal.WaitOne();
 
             // If a static image is used and the image is already processed, then we don't
             // need to process it again
@@ -2273,8 +2292,7 @@ namespace GoblinXNA.SceneGraph
                             null);
 #endif
 
-                    if (processLeftImageData)
-                        SetTextureData(0);
+                    bufferedVideoImageSet[0][curVideoBufferIndex] = processLeftImageData;
                 }
 
                 if (processRightImageData || processRightImagePtr)
@@ -2300,8 +2318,7 @@ namespace GoblinXNA.SceneGraph
                             null);
 #endif
 
-                    if (processRightImageData)
-                        SetTextureData(1);
+                    bufferedVideoImageSet[1][curVideoBufferIndex] = processRightImageData;
                 }
 
                 if (processSeparateImagePtr)
@@ -2321,11 +2338,41 @@ namespace GoblinXNA.SceneGraph
                     ((NullCapture)videoCaptures[trackerVideoID]).IsImageAlreadyProcessed = true;
             //}
 
-            prevVideoBufferIndex = curVideoBufferIndex;
-            curVideoBufferIndex = (curVideoBufferIndex + 1) % VIDEO_BUFFER_SIZE;
+            bufferedTrackerTimes[curVideoBufferIndex] = (float)DateTime.Now.TimeOfDay.TotalMilliseconds;
 
+            // Publish the back slot as the newest frame and take over the slot the renderer
+            // handed back when it took the previous frame
+            curVideoBufferIndex = Interlocked.Exchange(ref newestVideoBufferIndex, curVideoBufferIndex);
+            Interlocked.Exchange(ref newVideoFrameReady, 1);
+
+            videoIDSignal.Set();
+        }
+
+        /// <summary>
+        /// Takes the newest tracked frame, if there is one, uploads its video images, and updates the
+        /// marker nodes with the poses found in that same frame. Must be called from the render thread.
+        /// </summary>
+        /// <returns>Whether a frame was taken</returns>
+        protected bool AcquireNewestVideoFrame()
+        {
+            if (Interlocked.CompareExchange(ref newVideoFrameReady, 0, 0) == 0)
+                return false;
+
+            frontVideoBufferIndex = Interlocked.Exchange(ref newestVideoBufferIndex, frontVideoBufferIndex);
+
+            for (int id = 0; id < 2; id++)
+            {
+                if (bufferedVideoImageSet[id][frontVideoBufferIndex])
+                {
+                    SetTextureData(id);
+                    bufferedVideoImageSet[id][frontVideoBufferIndex] = false;
+                }
+            }
+
+            // The tracker does not process another frame until newVideoFrameReady is cleared, so the 
+            // tracker still holds the poses of the frame we just took
             float elapsedTime = 0;
-            float curTime = (float)DateTime.Now.TimeOfDay.TotalMilliseconds;
+            float curTime = bufferedTrackerTimes[frontVideoBufferIndex];
             if (prevTrackerTime != 0)
                 elapsedTime = curTime - prevTrackerTime;
             prevTrackerTime = curTime;
@@ -2336,11 +2383,13 @@ namespace GoblinXNA.SceneGraph
             }
             catch (Exception) { }
 
-            waitForTrackerUpdate = false;
+            // Only now that the marker nodes have read the tracker may it process the next frame
+            Interlocked.Exchange(ref newVideoFrameReady, 0);
+            return true;
         }
 
         /// <summary>
-        /// Sets the video texture data.
+        /// Sets the video texture data from the front video slot.
         /// </summary>
         /// <param name="id"></param>
         protected void SetTextureData(int id)
@@ -2349,12 +2398,8 @@ namespace GoblinXNA.SceneGraph
                 videoTextures[id] = new Texture2D(State.Device, videoTextures[id].Width, videoTextures[id].Height,
                     false, SurfaceFormat.Color);
 
-            while (renderingVideoTexture) { }
-            copyingVideoImage = true;
-
             State.Device.Textures[0] = null;
-            videoTextures[id].SetData<int>(bufferedVideoImages[id][curVideoBufferIndex]);
-            copyingVideoImage = false;
+            videoTextures[id].SetData<int>(bufferedVideoImages[id][frontVideoBufferIndex]);
         }
 
         /// <summary>
@@ -2580,6 +2625,9 @@ namespace GoblinXNA.SceneGraph
 
             LeftEyeVideoID = videoCaptures.Count - 1;
             TrackerVideoID = videoCaptures.Count - 1;
+
+            // The tracker thread waits while there is no video capture device
+            trackerSignal.Set();
         }
         
         /// <summary>
@@ -2934,10 +2982,19 @@ namespace GoblinXNA.SceneGraph
             uiElapsedTime = (float)elapsedTime.TotalMilliseconds;
 
             if (isMarkerTrackingThreaded)
-                readyToUpdateTracker = true;
+            {
+                if (!readyToUpdateTracker)
+                {
+                    readyToUpdateTracker = true;
+                    trackerSignal.Set();
+                }
+            }
             else
                 UpdateTracker();
 
+            if (AcquireNewestVideoFrame() && isMarkerTrackingThreaded)
+                trackerSignal.Set();
+
             bool updatePhysicsEngine = (physicsEngine != null);
 
             if (State.EnableNetworking && (networkHandler != null))
@@ -3019,6 +3076,7 @@ namespace GoblinXNA.SceneGraph
             if (markerTrackingThread != null)
             {
                 isMarkerTrackingThreaded = false;
+                trackerSignal.Set();
                 markerTrackingThread.Join();
             }
             if (physicsThread != null)
@@ -0,0 +1,123 @@
+/************************************************************************************ 
+ * Copyright (c) 2008-2012, Columbia University
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the Columbia University nor the
+ *       names of its contributors may be used to endorse or promote products
+ *       derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY COLUMBIA UNIVERSITY ''AS IS'' AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL <copyright holder> BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * 
+ * 
+ * ===================================================================================
+ * Authors: Ohan Oda (ohan@cs.columbia.edu) 
+ * 
+ *************************************************************************************/
+
+#include <stdlib.h>
+#include <new>
+#include "Tracepoints.cpp"
+
+// Counts the heap allocations made by the wrapper, so that tests can check that processing a
+// frame does not allocate once the wrapper has warmed up. Built only with GOBLIN_COUNT_ALLOCATIONS,
+// since it replaces the global operator new and delete of the DLL.
+//
+// Only allocations made by code compiled into this DLL are seen, which includes the ALVAR
+// templates instantiated here, such as PatternDetector::new_M. ALVAR and OpenCV are separate
+// DLLs with their own heaps, so what they allocate inside their own functions is not counted,
+// and OpenCV 2.x does not support cvSetMemoryManager, which would have let it be.
+//
+// Unlike the other helpers, this file is compiled on its own instead of being included by
+// MarkerDetectorWrapper.cpp, because the replacement operators must be defined exactly once. Its
+// exports still carry probes, through the provider that MarkerDetectorWrapper.cpp defines.
+
+#ifdef GOBLIN_COUNT_ALLOCATIONS
+
+#include <intrin.h>
+
+static volatile long allocationCount = 0;
+
+static void* countedAlloc(size_t size)
+{
+	_InterlockedIncrement(&allocationCount);
+
+	void* p = malloc(size == 0 ? 1 : size);
+	if(p == NULL)
+		throw std::bad_alloc();
+	return p;
+}
+
+void* operator new(size_t size)
+{
+	return countedAlloc(size);
+}
+
+void* operator new[](size_t size)
+{
+	return countedAlloc(size);
+}
+
+void operator delete(void* p)
+{
+	free(p);
+}
+
+void operator delete[](void* p)
+{
+	free(p);
+}
+
+#endif
+
+// Returns the number of allocations counted so far, or -1 if they are not counted
+static int getAllocationCount()
+{
+#ifdef GOBLIN_COUNT_ALLOCATIONS
+	return allocationCount;
+#else
+	return -1;
+#endif
+}
+
+extern "C"
+{
+	// Returns the number of allocations made by the wrapper since it was loaded, or -1 if it was
+	// built without GOBLIN_COUNT_ALLOCATIONS
+	__declspec(dllexport) int alvar_get_allocation_count()
+	{
+		TRACE_EXPORT(alvar_get_allocation_count);
+
+		return getAllocationCount();
+	}
+
+	// Makes one allocation and returns whether alvar_get_allocation_count counted it, so that a
+	// count that does not change can be told apart from a counter that does not work
+	__declspec(dllexport) bool alvar_check_allocation_count()
+	{
+		TRACE_EXPORT(alvar_check_allocation_count);
+
+		int before = getAllocationCount();
+		if(before < 0)
+			return false;
+
+		int* volatile probe = new int(0);
+		delete probe;
+		return getAllocationCount() > before;
+	}
+}
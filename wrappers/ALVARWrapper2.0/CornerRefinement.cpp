@@ -0,0 +1,380 @@
+/************************************************************************************ 
+ * Copyright (c) 2008-2012, Columbia University
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the Columbia University nor the
+ *       names of its contributors may be used to endorse or promote products
+ *       derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY COLUMBIA UNIVERSITY ''AS IS'' AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL <copyright holder> BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * 
+ * 
+ * ===================================================================================
+ * Authors: Ohan Oda (ohan@cs.columbia.edu) 
+ * 
+ *************************************************************************************/
+
+#include <math.h>
+#include <vector>
+#include <emmintrin.h>
+#include "MarkerDetector.h"
+#include "FrameQuality.cpp"
+
+// Refines the image corners of detected markers to sub-pixel accuracy from the image gradient
+// across their edges. Each edge is sampled at 'samplesPerEdge' points away from its corners. At
+// each point the gray profile along the edge normal is read with bilinear interpolation over
+// 'searchRadius' pixels plus one to either side, and the edge is placed at the centroid of its
+// differences. A line is fitted to those positions, weighted by the step contrast, and every
+// corner becomes the intersection of its two edge lines. The samples of all markers are collected
+// first and processed together, four at a time with SSE2 and in single precision. A corner that
+// would move more than 'maxShift' pixels, or that has an edge with too few usable samples, keeps
+// the position found by ALVAR. Gray is read with grayValue, the same way FrameQualityGate reads it.
+class CornerRefiner
+{
+public:
+
+	CornerRefiner()
+	{
+		enabled = false;
+		samplesPerEdge = 8;
+		searchRadius = 2;
+		maxShift = 1.5f;
+	}
+
+	// The number of samples per edge is rounded up to a multiple of 4
+	void configure(bool _enabled, int _samplesPerEdge, int _searchRadius, double _maxShift)
+	{
+		enabled = _enabled;
+		samplesPerEdge = (_samplesPerEdge < 4) ? 4 : (_samplesPerEdge + 3) & ~3;
+		searchRadius = (_searchRadius < 1) ? 1 : (_searchRadius > MAX_RADIUS) ? MAX_RADIUS : _searchRadius;
+		maxShift = (float)_maxShift;
+	}
+
+	// Refines the corners of all detected markers in place. If 'updatePose' is true, the pose of
+	// every marker is then fitted to its refined corners. Returns the number of corners moved.
+	int refine(std::vector<alvar::MarkerData>* markers, const IplImage* image, alvar::Camera* cam, 
+		bool updatePose)
+	{
+		if(image->width < 3 || image->height < 3)
+			return 0;
+
+		int edgeCount = collectSamples(markers);
+		if(edgeCount == 0)
+			return 0;
+
+		searchEdges(image, edgeCount * samplesPerEdge);
+		fitLines(edgeCount);
+
+		int moved = 0;
+		for(size_t i = 0; i < markerIndices.size(); ++i)
+		{
+			alvar::MarkerData& marker = (*markers)[markerIndices[i]];
+			moved += moveCorners(marker, &lines[i * 4]);
+			if(updatePose)
+				fitPose(marker, cam);
+		}
+		return moved;
+	}
+
+	bool enabled;
+
+private:
+
+	enum { MAX_RADIUS = 8 };
+
+	// A line n.x * x + n.y * y = c with unit normal n. Edges without a usable fit are not valid.
+	struct EdgeLine
+	{
+		float nx;
+		float ny;
+		float c;
+		bool valid;
+	};
+
+	// Lays out the sample points and edge normals of every four-cornered marker one after the
+	// other, edge by edge, and returns the number of edges. The buffers only grow.
+	int collectSamples(std::vector<alvar::MarkerData>* markers)
+	{
+		markerIndices.clear();
+		for(size_t i = 0; i < markers->size(); ++i)
+			if((*markers)[i].marker_corners_img.size() == 4)
+				markerIndices.push_back(i);
+
+		int edgeCount = markerIndices.size() * 4;
+		int sampleCount = edgeCount * samplesPerEdge;
+		if((int)sampleX.size() < sampleCount)
+		{
+			sampleX.resize(sampleCount);
+			sampleY.resize(sampleCount);
+			normalX.resize(sampleCount);
+			normalY.resize(sampleCount);
+			edgeX.resize(sampleCount);
+			edgeY.resize(sampleCount);
+			edgeWeight.resize(sampleCount);
+		}
+		if((int)lines.size() < edgeCount)
+			lines.resize(edgeCount);
+
+		int s = 0;
+		for(size_t i = 0; i < markerIndices.size(); ++i)
+		{
+			const std::vector<alvar::PointDouble>& corners = (*markers)[markerIndices[i]].marker_corners_img;
+			for(int e = 0; e < 4; ++e)
+			{
+				const alvar::PointDouble& a = corners[e];
+				const alvar::PointDouble& b = corners[(e + 1) & 3];
+				float dx = (float)(b.x - a.x);
+				float dy = (float)(b.y - a.y);
+				float length = sqrtf(dx * dx + dy * dy);
+				float nx = (length > 0) ? -dy / length : 0;
+				float ny = (length > 0) ? dx / length : 0;
+
+				// The outer 15% of each end are left out, where the neighboring edge interferes
+				for(int k = 0; k < samplesPerEdge; ++k, ++s)
+				{
+					float t = 0.15f + 0.7f * (k + 0.5f) / samplesPerEdge;
+					sampleX[s] = (float)a.x + t * dx;
+					sampleY[s] = (float)a.y + t * dy;
+					normalX[s] = nx;
+					normalY[s] = ny;
+				}
+			}
+		}
+		return edgeCount;
+	}
+
+	// Finds the gray step along the normal of every sample, four samples at a time, and stores its
+	// position and contrast. Samples whose profile leaves the image, is not close to monotonic, or
+	// has less contrast than MIN_STEP get a weight of 0.
+	void searchEdges(const IplImage* image, int sampleCount)
+	{
+		const float MIN_STEP = 16.0f;
+		const float MIN_MONOTONICITY = 0.8f;
+		const int profileLength = 2 * searchRadius + 3;
+
+		const unsigned char* data = (const unsigned char*)image->imageData;
+		const __m128 maxX = _mm_set1_ps((float)(image->width - 2));
+		const __m128 maxY = _mm_set1_ps((float)(image->height - 2));
+		const __m128 zero = _mm_setzero_ps();
+		const __m128 absMask = _mm_castsi128_ps(_mm_set1_epi32(0x7fffffff));
+		const __m128 reach = _mm_set1_ps((float)(searchRadius + 1));
+
+		__m128 profile[2 * MAX_RADIUS + 3];
+
+		for(int i = 0; i < sampleCount; i += 4)
+		{
+			__m128 px = _mm_loadu_ps(&sampleX[i]);
+			__m128 py = _mm_loadu_ps(&sampleY[i]);
+			__m128 nx = _mm_loadu_ps(&normalX[i]);
+			__m128 ny = _mm_loadu_ps(&normalY[i]);
+
+			// Both ends of the profile have to be inside the image
+			__m128 x0 = _mm_sub_ps(px, _mm_mul_ps(reach, nx)), x1 = _mm_add_ps(px, _mm_mul_ps(reach, nx));
+			__m128 y0 = _mm_sub_ps(py, _mm_mul_ps(reach, ny)), y1 = _mm_add_ps(py, _mm_mul_ps(reach, ny));
+			__m128 valid = _mm_and_ps(
+				_mm_and_ps(insideMask(x0, zero, maxX), insideMask(x1, zero, maxX)),
+				_mm_and_ps(insideMask(y0, zero, maxY), insideMask(y1, zero, maxY)));
+
+			for(int j = 0; j < profileLength; ++j)
+			{
+				__m128 d = _mm_set1_ps((float)(j - searchRadius - 1));
+				__m128 x = _mm_min_ps(_mm_max_ps(_mm_add_ps(px, _mm_mul_ps(d, nx)), zero), maxX);
+				__m128 y = _mm_min_ps(_mm_max_ps(_mm_add_ps(py, _mm_mul_ps(d, ny)), zero), maxY);
+				profile[j] = sampleBilinear(data, image->widthStep, image->nChannels, x, y);
+			}
+
+			// Difference k lies halfway between profile values k and k + 1, that is k - searchRadius - 0.5
+			// pixels along the normal. The centroid of the signed differences is where the step is. Since
+			// the bilinear profile is piecewise linear, it does not depend on where the samples fall
+			// between pixels, unlike a peak fit.
+			__m128 moment = zero;
+			__m128 total = zero;
+			for(int k = 0; k < profileLength - 1; ++k)
+			{
+				__m128 step = _mm_sub_ps(profile[k + 1], profile[k]);
+				moment = _mm_add_ps(moment, _mm_mul_ps(step, _mm_set1_ps(k - searchRadius - 0.5f)));
+				total = _mm_add_ps(total, _mm_and_ps(step, absMask));
+			}
+
+			// Profiles that are not a single step, such as a corner or a nearby edge, are rejected
+			__m128 contrast = _mm_sub_ps(profile[profileLength - 1], profile[0]);
+			__m128 strength = _mm_and_ps(contrast, absMask);
+			__m128 offset = _mm_div_ps(moment, select(_mm_cmpgt_ps(strength, zero), contrast, _mm_set1_ps(1)));
+
+			valid = _mm_and_ps(valid, _mm_cmpge_ps(strength, _mm_set1_ps(MIN_STEP)));
+			valid = _mm_and_ps(valid, _mm_cmpge_ps(strength, _mm_mul_ps(_mm_set1_ps(MIN_MONOTONICITY), total)));
+			valid = _mm_and_ps(valid, _mm_cmple_ps(_mm_and_ps(offset, absMask), _mm_set1_ps((float)searchRadius)));
+
+			_mm_storeu_ps(&edgeX[i], _mm_add_ps(px, _mm_mul_ps(offset, nx)));
+			_mm_storeu_ps(&edgeY[i], _mm_add_ps(py, _mm_mul_ps(offset, ny)));
+			_mm_storeu_ps(&edgeWeight[i], _mm_and_ps(valid, strength));
+		}
+	}
+
+	// Fits a line to the edge points of every edge by weighted total least squares
+	void fitLines(int edgeCount)
+	{
+		int minSamples = (samplesPerEdge / 2 < 3) ? 3 : samplesPerEdge / 2;
+		for(int e = 0; e < edgeCount; ++e)
+		{
+			const float* x = &edgeX[e * samplesPerEdge];
+			const float* y = &edgeY[e * samplesPerEdge];
+			const float* w = &edgeWeight[e * samplesPerEdge];
+
+			float sw = 0, mx = 0, my = 0;
+			int used = 0;
+			for(int k = 0; k < samplesPerEdge; ++k)
+			{
+				sw += w[k];
+				mx += w[k] * x[k];
+				my += w[k] * y[k];
+				used += (w[k] > 0) ? 1 : 0;
+			}
+
+			EdgeLine& line = lines[e];
+			line.valid = (used >= minSamples);
+			if(!line.valid)
+				continue;
+
+			mx /= sw;
+			my /= sw;
+			float sxx = 0, sxy = 0, syy = 0;
+			for(int k = 0; k < samplesPerEdge; ++k)
+			{
+				float dx = x[k] - mx, dy = y[k] - my;
+				sxx += w[k] * dx * dx;
+				sxy += w[k] * dx * dy;
+				syy += w[k] * dy * dy;
+			}
+
+			// The normal is the eigenvector of the smaller eigenvalue of the scatter matrix
+			float angle = 0.5f * atan2f(2 * sxy, sxx - syy);
+			line.nx = -sinf(angle);
+			line.ny = cosf(angle);
+			line.c = line.nx * mx + line.ny * my;
+		}
+	}
+
+	// Moves each corner to the intersection of the lines of the edges that meet there
+	int moveCorners(alvar::MarkerData& marker, const EdgeLine* edges)
+	{
+		int moved = 0;
+		for(int k = 0; k < 4; ++k)
+		{
+			const EdgeLine& a = edges[(k + 3) & 3];
+			const EdgeLine& b = edges[k];
+			if(!a.valid || !b.valid)
+				continue;
+
+			float det = a.nx * b.ny - a.ny * b.nx;
+			if(fabsf(det) < 1e-3f)
+				continue;
+
+			float x = (a.c * b.ny - b.c * a.ny) / det;
+			float y = (a.nx * b.c - b.nx * a.c) / det;
+
+			alvar::PointDouble& corner = marker.marker_corners_img[k];
+			float dx = x - (float)corner.x, dy = y - (float)corner.y;
+			if(dx * dx + dy * dy > maxShift * maxShift)
+				continue;
+
+			corner.x = x;
+			corner.y = y;
+			moved++;
+		}
+		return moved;
+	}
+
+	void fitPose(alvar::MarkerData& marker, alvar::Camera* cam)
+	{
+		modelPoints.clear();
+		imagePoints.clear();
+		for(size_t k = 0; k < marker.marker_corners.size() && k < marker.marker_corners_img.size(); ++k)
+		{
+			CvPoint3D64f w;
+			w.x = marker.marker_corners[k].x;
+			w.y = marker.marker_corners[k].y;
+			w.z = 0;
+			modelPoints.push_back(w);
+
+			CvPoint2D64f p;
+			p.x = marker.marker_corners_img[k].x;
+			p.y = marker.marker_corners_img[k].y;
+			imagePoints.push_back(p);
+		}
+		cam->CalcExteriorOrientation(modelPoints, imagePoints, &marker.pose);
+	}
+
+	static __m128 insideMask(__m128 v, __m128 low, __m128 high)
+	{
+		return _mm_and_ps(_mm_cmpge_ps(v, low), _mm_cmple_ps(v, high));
+	}
+
+	static __m128 select(__m128 mask, __m128 a, __m128 b)
+	{
+		return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b));
+	}
+
+	// Reads the gray value at four positions that are at least one pixel inside the right and
+	// bottom borders. SSE2 has no gather, so only the four pixel reads per lane are scalar.
+	static __m128 sampleBilinear(const unsigned char* data, int widthStep, int channels, __m128 x, __m128 y)
+	{
+		__m128i xi = _mm_cvttps_epi32(x);
+		__m128i yi = _mm_cvttps_epi32(y);
+		__m128 fx = _mm_sub_ps(x, _mm_cvtepi32_ps(xi));
+		__m128 fy = _mm_sub_ps(y, _mm_cvtepi32_ps(yi));
+
+		int col[4], row[4];
+		_mm_storeu_si128((__m128i*)col, xi);
+		_mm_storeu_si128((__m128i*)row, yi);
+
+		float p00[4], p10[4], p01[4], p11[4];
+		for(int l = 0; l < 4; ++l)
+		{
+			const unsigned char* p = data + row[l] * widthStep + col[l] * channels;
+			p00[l] = grayValue(p, channels);
+			p10[l] = grayValue(p + channels, channels);
+			p01[l] = grayValue(p + widthStep, channels);
+			p11[l] = grayValue(p + widthStep + channels, channels);
+		}
+
+		__m128 top = _mm_loadu_ps(p00);
+		top = _mm_add_ps(top, _mm_mul_ps(fx, _mm_sub_ps(_mm_loadu_ps(p10), top)));
+		__m128 bottom = _mm_loadu_ps(p01);
+		bottom = _mm_add_ps(bottom, _mm_mul_ps(fx, _mm_sub_ps(_mm_loadu_ps(p11), bottom)));
+		return _mm_add_ps(top, _mm_mul_ps(fy, _mm_sub_ps(bottom, top)));
+	}
+
+	int samplesPerEdge;
+	int searchRadius;
+	float maxShift;
+
+	// Scratch buffers reused across frames, with one entry per sample or per edge
+	std::vector<size_t> markerIndices;
+	std::vector<float> sampleX;
+	std::vector<float> sampleY;
+	std::vector<float> normalX;
+	std::vector<float> normalY;
+	std::vector<float> edgeX;
+	std::vector<float> edgeY;
+	std::vector<float> edgeWeight;
+	std::vector<EdgeLine> lines;
+	std::vector<CvPoint3D64f> modelPoints;
+	std::vector<CvPoint2D64f> imagePoints;
+};
@@ -0,0 +1,174 @@
+/************************************************************************************ 
+ * Copyright (c) 2008-2012, Columbia University
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the Columbia University nor the
+ *       names of its contributors may be used to endorse or promote products
+ *       derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY COLUMBIA UNIVERSITY ''AS IS'' AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL <copyright holder> BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * 
+ * 
+ * ===================================================================================
+ * Authors: Ohan Oda (ohan@cs.columbia.edu) 
+ * 
+ *************************************************************************************/
+
+#include <string>
+#include <vector>
+#include "MarkerDetector.h"
+#include "ImageResize.cpp"
+
+// Runs marker detection on the frame reduced by 2 or 4 with the box filter of ImageResize.cpp,
+// which is cheaper than detecting on the full frame and averages out sensor noise. The image
+// coordinates of the found markers are mapped back to the full frame before anything else reads
+// them, so corner refinement and pose fitting still work on the full frame. Detection itself uses
+// a Camera set up for the reduced resolution.
+class DetectionScaler
+{
+public:
+
+	DetectionScaler()
+	{
+		factor = 1;
+		camera = NULL;
+		camWidth = 0;
+		camHeight = 0;
+	}
+
+	~DetectionScaler()
+	{
+		delete camera;
+	}
+
+	bool isEnabled()
+	{
+		return factor > 1;
+	}
+
+	// Factors other than 2 and 4 are rounded down to one of 1, 2 or 4
+	void configure(int _factor)
+	{
+		factor = (_factor >= 4) ? 4 : (_factor >= 2) ? 2 : 1;
+	}
+
+	// Reduces 'image' into the scratch image and returns it. The markers of the last frame, which
+	// the detector tracks into this one, are moved to the reduced coordinates.
+	IplImage* reduce(const IplImage* image, std::vector<alvar::MarkerData>* lastMarkers)
+	{
+		reduced = *image;
+		reduced.width = image->width / factor;
+		reduced.height = image->height / factor;
+		reduced.widthStep = reduced.width * image->nChannels;
+		reduced.imageSize = reduced.height * reduced.widthStep;
+		if((int)pixels.size() < reduced.imageSize)
+			pixels.resize(reduced.imageSize);
+		reduced.imageData = (char*)&pixels[0];
+
+		resizeImage((const unsigned char*)image->imageData, image->width, image->height, image->widthStep,
+			image->nChannels, &pixels[0], reduced.width, reduced.height, reduced.widthStep, buffers);
+
+		double offset = 0.5 * (factor - 1);
+		for(size_t i = 0; i < lastMarkers->size(); ++i)
+			moveMarker((*lastMarkers)[i], 1.0 / factor, -offset / factor);
+
+		return &reduced;
+	}
+
+	// Returns the camera for the reduced frame, which is rebuilt if the calibration changed
+	alvar::Camera* reducedCamera(const std::string& calibFile)
+	{
+		if(camera == NULL || reduced.width != camWidth || reduced.height != camHeight || calibFile != camCalibFile)
+		{
+			delete camera;
+			camera = new alvar::Camera();
+			if(calibFile.empty() || !camera->SetCalib(calibFile.c_str(), reduced.width, reduced.height))
+				camera->SetRes(reduced.width, reduced.height);
+			camWidth = reduced.width;
+			camHeight = reduced.height;
+			camCalibFile = calibFile;
+		}
+		return camera;
+	}
+
+	// Moves the markers found in the reduced frame back to the full frame. If 'updatePose' is
+	// true, their poses are fitted to the moved corners with the full frame camera 'cam'.
+	void expand(std::vector<alvar::MarkerData>* markers, alvar::Camera* cam, bool updatePose)
+	{
+		// The reduced pixel x covers the full frame pixels x * factor to x * factor + factor - 1
+		double offset = 0.5 * (factor - 1);
+		for(size_t i = 0; i < markers->size(); ++i)
+		{
+			alvar::MarkerData& marker = (*markers)[i];
+			moveMarker(marker, factor, offset);
+			if(updatePose)
+				fitPose(marker, cam);
+		}
+	}
+
+private:
+
+	static void moveMarker(alvar::MarkerData& marker, double scale, double offset)
+	{
+		for(size_t k = 0; k < marker.marker_corners_img.size(); ++k)
+		{
+			marker.marker_corners_img[k].x = marker.marker_corners_img[k].x * scale + offset;
+			marker.marker_corners_img[k].y = marker.marker_corners_img[k].y * scale + offset;
+		}
+		for(size_t k = 0; k < marker.marker_points_img.size(); ++k)
+		{
+			marker.marker_points_img[k].x = marker.marker_points_img[k].x * scale + offset;
+			marker.marker_points_img[k].y = marker.marker_points_img[k].y * scale + offset;
+		}
+	}
+
+	void fitPose(alvar::MarkerData& marker, alvar::Camera* cam)
+	{
+		modelPoints.clear();
+		imagePoints.clear();
+		for(size_t k = 0; k < marker.marker_corners.size() && k < marker.marker_corners_img.size(); ++k)
+		{
+			CvPoint3D64f w;
+			w.x = marker.marker_corners[k].x;
+			w.y = marker.marker_corners[k].y;
+			w.z = 0;
+			modelPoints.push_back(w);
+
+			CvPoint2D64f p;
+			p.x = marker.marker_corners_img[k].x;
+			p.y = marker.marker_corners_img[k].y;
+			imagePoints.push_back(p);
+		}
+		cam->CalcExteriorOrientation(modelPoints, imagePoints, &marker.pose);
+	}
+
+	int factor;
+
+	IplImage reduced;
+	std::vector<unsigned char> pixels;
+	ResizeBuffers buffers;
+
+	alvar::Camera* camera;
+	int camWidth;
+	int camHeight;
+	std::string camCalibFile;
+
+	std::vector<CvPoint3D64f> modelPoints;
+	std::vector<CvPoint2D64f> imagePoints;
+};
@@ -0,0 +1,232 @@
+/************************************************************************************ 
+ * Copyright (c) 2008-2012, Columbia University
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the Columbia University nor the
+ *       names of its contributors may be used to endorse or promote products
+ *       derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY COLUMBIA UNIVERSITY ''AS IS'' AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL <copyright holder> BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * 
+ * 
+ * ===================================================================================
+ * Authors: Ohan Oda (ohan@cs.columbia.edu) 
+ * 
+ *************************************************************************************/
+
+#include <math.h>
+#include <string.h>
+#include <vector>
+#include "FernPoseEstimator.h"
+
+// A PROSAC-style robust homography estimator for the correspondences found by FernImageDetector.
+// Samples are drawn from a progressively growing set of the best ranked correspondences, so a good
+// hypothesis is usually found within the first few iterations, and the search stops as soon as the
+// required inlier ratio has been reached with the requested confidence. ALVAR does not expose the
+// match scores, so the rank is the order in which the matches are returned, which follows the
+// keypoint detector response.
+class ProsacEstimator
+{
+public:
+
+	ProsacEstimator()
+	{
+		threshold = 4.0;
+		confidence = 0.99;
+		maxIterations = 500;
+		seed = 1;
+	}
+
+	// Returns the number of inliers of the best homography, and marks them in 'inliers'.
+	int estimate(const std::vector<CvPoint3D64f>& mpts, const std::vector<CvPoint2D64f>& ipts,
+		double minInlierRatio)
+	{
+		int count = (int)mpts.size();
+		inliers.assign(count, 0);
+		if(count < SAMPLE_SIZE || (int)ipts.size() != count)
+			return 0;
+
+		// Number of draws after which the sampling set is grown by one
+		double tn = maxIterations;
+		for(int i = 0; i < SAMPLE_SIZE; ++i)
+			tn *= (double)(SAMPLE_SIZE - i) / (count - i);
+		int tnPrime = 1;
+		int n = SAMPLE_SIZE;
+
+		int bestCount = 0;
+		double best[9];
+		int required = (int)ceil(minInlierRatio * count);
+		if(required < SAMPLE_SIZE)
+			required = SAMPLE_SIZE;
+
+		for(int t = 1; t <= maxIterations; ++t)
+		{
+			if(t > tnPrime && n < count)
+			{
+				double tn1 = tn * (n + 1) / (n + 1 - SAMPLE_SIZE);
+				tnPrime += (int)ceil(tn1 - tn);
+				tn = tn1;
+				n++;
+			}
+
+			int sample[SAMPLE_SIZE];
+			if(tnPrime < t)
+				drawSample(n, sample, 0);
+			else
+			{
+				// Always include the newest member of the sampling set
+				sample[0] = n - 1;
+				drawSample(n - 1, sample, 1);
+			}
+
+			double h[9];
+			if(!solveHomography(mpts, ipts, sample, h))
+				continue;
+
+			int inlierCount = countInliers(mpts, ipts, h, NULL);
+			if(inlierCount > bestCount)
+			{
+				bestCount = inlierCount;
+				memcpy(best, h, sizeof(best));
+			}
+
+			if(bestCount >= required)
+			{
+				double ratio = (double)bestCount / count;
+				double allInliers = pow(ratio, SAMPLE_SIZE);
+				if(allInliers >= 1.0 || t >= log(1.0 - confidence) / log(1.0 - allInliers))
+					break;
+			}
+		}
+
+		if(bestCount == 0)
+			return 0;
+
+		return countInliers(mpts, ipts, best, &inliers[0]);
+	}
+
+public:
+
+	// Maximum reprojection error in pixels for a correspondence to count as an inlier
+	double threshold;
+	double confidence;
+	int maxIterations;
+
+	std::vector<char> inliers;
+
+private:
+
+	enum { SAMPLE_SIZE = 4 };
+
+	unsigned int nextRandom()
+	{
+		seed = seed * 1664525u + 1013904223u;
+		return seed >> 8;
+	}
+
+	// Fills sample[first..SAMPLE_SIZE) with distinct indices in [0, range) not already in the sample
+	void drawSample(int range, int* sample, int first)
+	{
+		for(int i = first; i < SAMPLE_SIZE; ++i)
+		{
+			bool unique;
+			do
+			{
+				sample[i] = nextRandom() % range;
+				unique = true;
+				for(int j = 0; j < i; ++j)
+					if(sample[j] == sample[i])
+						unique = false;
+			} while(!unique);
+		}
+	}
+
+	// Solves the homography mapping the model plane onto the image from four correspondences,
+	// with h[8] fixed to 1. Returns false for degenerate samples.
+	bool solveHomography(const std::vector<CvPoint3D64f>& mpts, const std::vector<CvPoint2D64f>& ipts,
+		const int* sample, double* h)
+	{
+		double a[8][9];
+		for(int i = 0; i < SAMPLE_SIZE; ++i)
+		{
+			double x = mpts[sample[i]].x, y = mpts[sample[i]].y;
+			double u = ipts[sample[i]].x, v = ipts[sample[i]].y;
+			double r0[9] = {x, y, 1, 0, 0, 0, -u * x, -u * y, u};
+			double r1[9] = {0, 0, 0, x, y, 1, -v * x, -v * y, v};
+			memcpy(a[i * 2], r0, sizeof(r0));
+			memcpy(a[i * 2 + 1], r1, sizeof(r1));
+		}
+
+		for(int col = 0; col < 8; ++col)
+		{
+			int pivot = col;
+			for(int row = col + 1; row < 8; ++row)
+				if(fabs(a[row][col]) > fabs(a[pivot][col]))
+					pivot = row;
+			if(fabs(a[pivot][col]) < 1e-10)
+				return false;
+			if(pivot != col)
+				for(int k = 0; k < 9; ++k)
+				{
+					double tmp = a[col][k];
+					a[col][k] = a[pivot][k];
+					a[pivot][k] = tmp;
+				}
+
+			for(int row = 0; row < 8; ++row)
+			{
+				if(row == col)
+					continue;
+				double f = a[row][col] / a[col][col];
+				for(int k = col; k < 9; ++k)
+					a[row][k] -= f * a[col][k];
+			}
+		}
+
+		for(int i = 0; i < 8; ++i)
+			h[i] = a[i][8] / a[i][i];
+		h[8] = 1;
+		return true;
+	}
+
+	int countInliers(const std::vector<CvPoint3D64f>& mpts, const std::vector<CvPoint2D64f>& ipts,
+		const double* h, char* mask)
+	{
+		double threshold2 = threshold * threshold;
+		int count = 0;
+		for(size_t i = 0; i < mpts.size(); ++i)
+		{
+			double x = mpts[i].x, y = mpts[i].y;
+			double w = h[6] * x + h[7] * y + h[8];
+			if(fabs(w) < 1e-12)
+				continue;
+			double du = (h[0] * x + h[1] * y + h[2]) / w - ipts[i].x;
+			double dv = (h[3] * x + h[4] * y + h[5]) / w - ipts[i].y;
+			bool inlier = (du * du + dv * dv) <= threshold2;
+			if(mask != NULL)
+				mask[i] = inlier ? 1 : 0;
+			if(inlier)
+				count++;
+		}
+
+		return count;
+	}
+
+	unsigned int seed;
+};
@@ -0,0 +1,208 @@
+/************************************************************************************ 
+ * Copyright (c) 2008-2012, Columbia University
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the Columbia University nor the
+ *       names of its contributors may be used to endorse or promote products
+ *       derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY COLUMBIA UNIVERSITY ''AS IS'' AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL <copyright holder> BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * 
+ * 
+ * ===================================================================================
+ * Authors: Ohan Oda (ohan@cs.columbia.edu) 
+ * 
+ *************************************************************************************/
+
+#pragma once
+
+#include <vector>
+#include <emmintrin.h>
+
+// Returns the gray value of the pixel that starts at 'pixel'. The first channel of single-channel
+// images, the green bits of two-byte (R5G6B5) images, and the second (green) channel of other
+// color images is used as gray.
+static inline unsigned char grayValue(const unsigned char* pixel, int channels)
+{
+	if(channels == 2)
+	{
+		// The six green bits are split between the low bits of the first byte and the high
+		// bits of the second, and are scaled to eight bits
+		int g = ((pixel[0] & 0x07) << 3) | (pixel[1] >> 5);
+		return (unsigned char)((g << 2) | (g >> 4));
+	}
+	return pixel[(channels > 1) ? 1 : 0];
+}
+
+// Decides per frame whether marker detection is worth running, from a sharpness and a mean
+// brightness estimate computed on a gray image subsampled by 'step' in both directions. Sharpness
+// is the mean absolute difference between neighboring subsampled pixels. Since that depends on
+// the scene, a frame counts as blurred when its sharpness is below 'minSharpnessRatio' times the
+// running average of the frames that were detected. Frames whose mean brightness is outside
+// [minBrightness, maxBrightness] are under- or overexposed. After 'maxSkippedFrames' skipped
+// frames in a row the next frame is detected anyway, so that the average can follow the scene.
+class FrameQualityGate
+{
+public:
+
+	FrameQualityGate()
+	{
+		step = 0;
+		minSharpnessRatio = 0;
+		minBrightness = 0;
+		maxBrightness = 255;
+		maxSkippedFrames = 0;
+
+		averageSharpness = 0;
+		skippedFrames = 0;
+
+		sharpness = 0;
+		brightness = 0;
+		skipped = false;
+	}
+
+	bool isEnabled()
+	{
+		return step > 0;
+	}
+
+	// Passing a step of 0 turns the gate off
+	void configure(int _step, double _minSharpnessRatio, double _minBrightness, double _maxBrightness,
+		int _maxSkippedFrames)
+	{
+		step = (_step < 0) ? 0 : _step;
+		minSharpnessRatio = _minSharpnessRatio;
+		minBrightness = _minBrightness;
+		maxBrightness = _maxBrightness;
+		maxSkippedFrames = _maxSkippedFrames;
+
+		averageSharpness = 0;
+		skippedFrames = 0;
+		skipped = false;
+	}
+
+	// Returns true if the frame should go through full detection. Gray is read with grayValue.
+	bool evaluate(const char* imageData, int width, int height, int widthStep, int channels)
+	{
+		int w = width / step;
+		int h = height / step;
+		skipped = false;
+		if(w < 2 || h < 2)
+			return true;
+
+		subsample((const unsigned char*)imageData, widthStep, channels, w, h);
+
+		unsigned long long brightnessSum = 0;
+		unsigned long long gradientSum = 0;
+		for(int y = 0; y < h; ++y)
+		{
+			const unsigned char* row = &gray[y * w];
+			brightnessSum += sumRowSSE2(row, w);
+			gradientSum += sumAbsDiffSSE2(row, row + 1, w - 1);
+			if(y + 1 < h)
+				gradientSum += sumAbsDiffSSE2(row, row + w, w);
+		}
+
+		brightness = (double)brightnessSum / (w * h);
+		sharpness = (double)gradientSum / ((w - 1) * h + w * (h - 1));
+
+		bool exposed = (brightness >= minBrightness && brightness <= maxBrightness);
+		bool sharp = (averageSharpness <= 0 || sharpness >= minSharpnessRatio * averageSharpness);
+		bool forced = (maxSkippedFrames > 0 && skippedFrames >= maxSkippedFrames);
+
+		if((exposed && sharp) || forced)
+		{
+			if(exposed)
+				averageSharpness = (averageSharpness <= 0) ? sharpness : 
+					averageSharpness * 0.9 + sharpness * 0.1;
+			skippedFrames = 0;
+			return true;
+		}
+
+		skippedFrames++;
+		skipped = true;
+		return false;
+	}
+
+	// Results of the last evaluated frame
+	double sharpness;
+	double brightness;
+	bool skipped;
+
+private:
+
+	// Copies every step-th pixel of every step-th row into the gray buffer, which only grows
+	void subsample(const unsigned char* src, int widthStep, int channels, int w, int h)
+	{
+		if((int)gray.size() < w * h)
+			gray.resize(w * h);
+
+		int pixelStep = step * channels;
+		for(int y = 0; y < h; ++y)
+		{
+			const unsigned char* in = src + y * step * widthStep;
+			unsigned char* out = &gray[y * w];
+			for(int x = 0; x < w; ++x, in += pixelStep)
+				out[x] = grayValue(in, channels);
+		}
+	}
+
+	// Sums 'length' bytes, 16 at a time
+	static unsigned long long sumRowSSE2(const unsigned char* src, int length)
+	{
+		const __m128i zero = _mm_setzero_si128();
+		__m128i acc = zero;
+		int i = 0;
+		for(; i <= length - 16; i += 16)
+			acc = _mm_add_epi64(acc, _mm_sad_epu8(_mm_loadu_si128((const __m128i*)(src + i)), zero));
+
+		unsigned long long sum = (unsigned long long)_mm_cvtsi128_si32(acc) + 
+			(unsigned long long)_mm_cvtsi128_si32(_mm_srli_si128(acc, 8));
+		for(; i < length; ++i)
+			sum += src[i];
+		return sum;
+	}
+
+	// Sums |a[i] - b[i]| over 'length' bytes, 16 at a time
+	static unsigned long long sumAbsDiffSSE2(const unsigned char* a, const unsigned char* b, int length)
+	{
+		__m128i acc = _mm_setzero_si128();
+		int i = 0;
+		for(; i <= length - 16; i += 16)
+			acc = _mm_add_epi64(acc, _mm_sad_epu8(_mm_loadu_si128((const __m128i*)(a + i)),
+				_mm_loadu_si128((const __m128i*)(b + i))));
+
+		unsigned long long sum = (unsigned long long)_mm_cvtsi128_si32(acc) + 
+			(unsigned long long)_mm_cvtsi128_si32(_mm_srli_si128(acc, 8));
+		for(; i < length; ++i)
+			sum += (a[i] > b[i]) ? a[i] - b[i] : b[i] - a[i];
+		return sum;
+	}
+
+	int step;
+	double minSharpnessRatio;
+	double minBrightness;
+	double maxBrightness;
+	int maxSkippedFrames;
+
+	double averageSharpness;
+	int skippedFrames;
+
+	std::vector<unsigned char> gray;
+};
@@ -0,0 +1,336 @@
+/************************************************************************************ 
+ * Copyright (c) 2008-2012, Columbia University
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the Columbia University nor the
+ *       names of its contributors may be used to endorse or promote products
+ *       derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY COLUMBIA UNIVERSITY ''AS IS'' AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL <copyright holder> BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * 
+ * 
+ * ===================================================================================
+ * Authors: Ohan Oda (ohan@cs.columbia.edu) 
+ * 
+ *************************************************************************************/
+
+#include <string.h>
+#include <intrin.h>
+#include <emmintrin.h>
+#include <tmmintrin.h>
+
+// Pixel formats of the tracker image. The values must match the order of the managed
+// GoblinXNA.Device.Capture.ImageFormat enum.
+enum FrameFormat
+{
+	FRAME_GRAYSCALE_8,
+	FRAME_R5G6B5_16,
+	FRAME_R8G8B8_24,
+	FRAME_B8G8R8_24,
+	FRAME_A8B8G8R8_32,
+	FRAME_R8G8B8A8_32,
+	FRAME_B8G8R8A8_32
+};
+
+static int frameFormatChannels(int format)
+{
+	switch(format)
+	{
+	case FRAME_GRAYSCALE_8:
+		return 1;
+	case FRAME_R5G6B5_16:
+		return 2;
+	case FRAME_R8G8B8_24:
+	case FRAME_B8G8R8_24:
+		return 3;
+	case FRAME_A8B8G8R8_32:
+	case FRAME_R8G8B8A8_32:
+	case FRAME_B8G8R8A8_32:
+		return 4;
+	}
+
+	return 0;
+}
+
+static bool cpuHasSSSE3()
+{
+	static int supported = -1;
+	if(supported < 0)
+	{
+		int info[4];
+		__cpuid(info, 1);
+		supported = (info[2] & (1 << 9)) ? 1 : 0;
+	}
+
+	return supported == 1;
+}
+
+// Builds a shuffle mask that expands four source pixels of 'step' bytes (3 or 4) into four 4-byte
+// pixels. Each element of 'order' selects the source byte (0-2) written to that byte of the output
+// pixel, or -1 to write zero.
+static __m128i makeExpandMask(int step, int b0, int b1, int b2, int b3)
+{
+	int order[4] = {b0, b1, b2, b3};
+	char mask[16];
+	for(int p = 0; p < 4; ++p)
+		for(int i = 0; i < 4; ++i)
+			mask[p * 4 + i] = (order[i] < 0) ? (char)0x80 : (char)(p * step + order[i]);
+
+	return _mm_loadu_si128((const __m128i*)mask);
+}
+
+// Same as makeExpandMask, but packs the output pixels in 3 bytes.
+static __m128i makeSwizzleMask(int step, int b0, int b1, int b2)
+{
+	char mask[16];
+	for(int p = 0; p < 4; ++p)
+	{
+		mask[p * 3] = (char)(p * step + b0);
+		mask[p * 3 + 1] = (char)(p * step + b1);
+		mask[p * 3 + 2] = (char)(p * step + b2);
+	}
+	for(int i = 12; i < 16; ++i)
+		mask[i] = (char)0x80;
+
+	return _mm_loadu_si128((const __m128i*)mask);
+}
+
+// Describes how one BGR24 or BGRX32 source pixel maps to the tracker image and to the texture.
+struct FrameLayout
+{
+	int format;
+	int srcBytes;		// 3 for BGR24 sources, 4 for BGRX32 sources (the fourth byte is ignored)
+	int order[4];		// source byte for each byte of a 24 or 32-bit tracker pixel (-1 for alpha)
+	bool swapTexture;	// if true, the texture stores s0 << 16 | s1 << 8 | s2, otherwise s2 << 16 | s1 << 8 | s0
+};
+
+static void setupFrameLayout(FrameLayout& layout, int format, int srcBytes, bool hasTracker)
+{
+	layout.format = format;
+	layout.srcBytes = srcBytes;
+	layout.order[3] = -1;
+	switch(format)
+	{
+	case FRAME_R8G8B8_24:
+	case FRAME_R8G8B8A8_32:
+		layout.order[0] = 0; layout.order[1] = 1; layout.order[2] = 2;
+		break;
+	case FRAME_B8G8R8_24:
+	case FRAME_B8G8R8A8_32:
+		layout.order[0] = 2; layout.order[1] = 1; layout.order[2] = 0;
+		break;
+	case FRAME_A8B8G8R8_32:
+		layout.order[0] = -1; layout.order[1] = 2; layout.order[2] = 1; layout.order[3] = 0;
+		break;
+	default:
+		layout.order[0] = 0; layout.order[1] = 1; layout.order[2] = 2;
+		break;
+	}
+
+	// The texture byte order differs between the formats because the capture classes have always
+	// produced it this way, and the background rendering relies on it. DirectShowCapture (the only
+	// BGRX32 source) always stores the swapped order.
+	layout.swapTexture = !hasTracker || srcBytes == 4 || format == FRAME_R8G8B8_24 ||
+		format == FRAME_B8G8R8_24 || format == FRAME_GRAYSCALE_8;
+}
+
+static inline unsigned char grayValue(const unsigned char* s)
+{
+	return (unsigned char)((29 * s[0] + 150 * s[1] + 77 * s[2]) >> 8);
+}
+
+static void convertRowScalar(const FrameLayout& layout, const unsigned char* src, unsigned char* tracker,
+	int* texture, int start, int width)
+{
+	for(int x = start; x < width; ++x)
+	{
+		const unsigned char* s = src + x * layout.srcBytes;
+
+		if(texture != NULL)
+		{
+			if(layout.swapTexture)
+				texture[x] = (s[0] << 16) | (s[1] << 8) | s[2];
+			else
+				texture[x] = (s[2] << 16) | (s[1] << 8) | s[0];
+		}
+
+		if(tracker == NULL)
+			continue;
+
+		switch(layout.format)
+		{
+		case FRAME_GRAYSCALE_8:
+			tracker[x] = grayValue(s);
+			break;
+		case FRAME_R5G6B5_16:
+			tracker[x * 2] = (unsigned char)((s[0] & 0xF8) | (s[1] >> 5));
+			tracker[x * 2 + 1] = (unsigned char)(((s[1] & 0x1C) << 3) | ((s[2] & 0xF8) >> 3));
+			break;
+		case FRAME_R8G8B8_24:
+		case FRAME_B8G8R8_24:
+			tracker[x * 3] = s[layout.order[0]];
+			tracker[x * 3 + 1] = s[layout.order[1]];
+			tracker[x * 3 + 2] = s[layout.order[2]];
+			break;
+		default:
+			for(int i = 0; i < 4; ++i)
+				tracker[x * 4 + i] = (layout.order[i] < 0) ? 255 : s[layout.order[i]];
+			break;
+		}
+	}
+}
+
+// Converts 16 pixels at a time. Returns the index of the first pixel left for the scalar loop.
+static int convertRowSSSE3(const FrameLayout& layout, const unsigned char* src, unsigned char* tracker,
+	int* texture, int width)
+{
+	const int step = layout.srcBytes;
+	const __m128i textureMask = layout.swapTexture ? makeExpandMask(step, 2, 1, 0, -1) : makeExpandMask(step, 0, 1, 2, -1);
+	const __m128i bgrxMask = makeExpandMask(step, 0, 1, 2, -1);
+	const __m128i swizzleMask = makeSwizzleMask(step, layout.order[0], layout.order[1], layout.order[2]);
+	const __m128i expandMask = makeExpandMask(step, layout.order[0], layout.order[1], layout.order[2], layout.order[3]);
+
+	__m128i alpha = _mm_setzero_si128();
+	for(int i = 0; i < 4; ++i)
+		if(layout.order[i] < 0)
+			alpha = _mm_or_si128(alpha, _mm_set1_epi32(0xFF << (i * 8)));
+
+	const __m128i lowByte = _mm_set1_epi32(0xFF);
+	const __m128i mask565lo = _mm_set1_epi32(0xF8);
+	const __m128i mask565hi = _mm_set1_epi32(0x1C);
+	const __m128i grayWeights = _mm_setr_epi16(29, 150, 77, 0, 29, 150, 77, 0);
+
+	// The 24-bit tracker stores write 16 bytes per 4 pixels, so keep two pixels of slack
+	int end = width - 18;
+	int x = 0;
+	for(; x <= end; x += 16)
+	{
+		const unsigned char* s = src + x * step;
+
+		// Four groups of four pixels, each aligned to byte 0
+		__m128i group[4];
+		if(step == 4)
+		{
+			for(int g = 0; g < 4; ++g)
+				group[g] = _mm_loadu_si128((const __m128i*)(s + g * 16));
+		}
+		else
+		{
+			__m128i a = _mm_loadu_si128((const __m128i*)s);
+			__m128i b = _mm_loadu_si128((const __m128i*)(s + 16));
+			__m128i c = _mm_loadu_si128((const __m128i*)(s + 32));
+			group[0] = a;
+			group[1] = _mm_alignr_epi8(b, a, 12);
+			group[2] = _mm_alignr_epi8(c, b, 8);
+			group[3] = _mm_srli_si128(c, 4);
+		}
+
+		if(texture != NULL)
+		{
+			for(int g = 0; g < 4; ++g)
+				_mm_storeu_si128((__m128i*)(texture + x + g * 4), _mm_shuffle_epi8(group[g], textureMask));
+		}
+
+		if(tracker == NULL)
+			continue;
+
+		switch(layout.format)
+		{
+		case FRAME_GRAYSCALE_8:
+		{
+			__m128i gray[4];
+			for(int g = 0; g < 4; ++g)
+			{
+				__m128i px = _mm_shuffle_epi8(group[g], bgrxMask);
+				__m128i lo = _mm_unpacklo_epi8(px, _mm_setzero_si128());
+				__m128i hi = _mm_unpackhi_epi8(px, _mm_setzero_si128());
+				// B*29 + G*150 and R*77 per pixel, then fold the pairs
+				lo = _mm_madd_epi16(lo, grayWeights);
+				hi = _mm_madd_epi16(hi, grayWeights);
+				__m128i sums = _mm_add_epi32(
+					_mm_castps_si128(_mm_shuffle_ps(_mm_castsi128_ps(lo), _mm_castsi128_ps(hi), _MM_SHUFFLE(2, 0, 2, 0))),
+					_mm_castps_si128(_mm_shuffle_ps(_mm_castsi128_ps(lo), _mm_castsi128_ps(hi), _MM_SHUFFLE(3, 1, 3, 1))));
+				gray[g] = _mm_srli_epi32(sums, 8);
+			}
+			__m128i packed = _mm_packus_epi16(_mm_packs_epi32(gray[0], gray[1]), _mm_packs_epi32(gray[2], gray[3]));
+			_mm_storeu_si128((__m128i*)(tracker + x), packed);
+			break;
+		}
+		case FRAME_R5G6B5_16:
+		{
+			__m128i packed[4];
+			for(int g = 0; g < 4; ++g)
+			{
+				__m128i px = _mm_shuffle_epi8(group[g], bgrxMask);
+				__m128i s0 = _mm_and_si128(px, lowByte);
+				__m128i s1 = _mm_and_si128(_mm_srli_epi32(px, 8), lowByte);
+				__m128i s2 = _mm_srli_epi32(px, 16);
+				__m128i lo = _mm_or_si128(_mm_and_si128(s0, mask565lo), _mm_srli_epi32(s1, 5));
+				__m128i hi = _mm_or_si128(_mm_slli_epi32(_mm_and_si128(s1, mask565hi), 3),
+					_mm_srli_epi32(_mm_and_si128(s2, mask565lo), 3));
+				// Sign-extend the 16-bit result so that the signed pack below keeps all bits
+				packed[g] = _mm_srai_epi32(_mm_slli_epi32(_mm_or_si128(lo, _mm_slli_epi32(hi, 8)), 16), 16);
+			}
+			_mm_storeu_si128((__m128i*)(tracker + x * 2), _mm_packs_epi32(packed[0], packed[1]));
+			_mm_storeu_si128((__m128i*)(tracker + x * 2 + 16), _mm_packs_epi32(packed[2], packed[3]));
+			break;
+		}
+		case FRAME_R8G8B8_24:
+		case FRAME_B8G8R8_24:
+			for(int g = 0; g < 4; ++g)
+				_mm_storeu_si128((__m128i*)(tracker + (x + g * 4) * 3), _mm_shuffle_epi8(group[g], swizzleMask));
+			break;
+		default:
+			for(int g = 0; g < 4; ++g)
+				_mm_storeu_si128((__m128i*)(tracker + (x + g * 4) * 4),
+					_mm_or_si128(_mm_shuffle_epi8(group[g], expandMask), alpha));
+			break;
+		}
+	}
+
+	return x;
+}
+
+// Converts a BGR24 (srcBytes = 3) or BGRX32 (srcBytes = 4) frame into the tracker image in the
+// given format and/or the packed texture array in a single pass. The source rows are visited
+// starting at 'src' and advancing by 'srcStride' bytes (negative for bottom-up bitmaps), while
+// both outputs are written top to bottom.
+static bool convertFrame(const unsigned char* src, int srcStride, int srcBytes, int width, int height,
+	int format, unsigned char* tracker, int* texture)
+{
+	int channels = frameFormatChannels(format);
+	if(channels == 0 || src == NULL || width <= 0 || height <= 0 || (srcBytes != 3 && srcBytes != 4))
+		return false;
+
+	FrameLayout layout;
+	setupFrameLayout(layout, format, srcBytes, tracker != NULL);
+
+	bool simd = cpuHasSSSE3();
+	for(int y = 0; y < height; ++y)
+	{
+		const unsigned char* row = src + y * srcStride;
+		unsigned char* trackerRow = (tracker != NULL) ? tracker + y * width * channels : NULL;
+		int* textureRow = (texture != NULL) ? texture + y * width : NULL;
+
+		int start = simd ? convertRowSSSE3(layout, row, trackerRow, textureRow, width) : 0;
+		convertRowScalar(layout, row, trackerRow, textureRow, start, width);
+	}
+
+	return true;
+}
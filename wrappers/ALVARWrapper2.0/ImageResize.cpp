@@ -0,0 +1,265 @@
+/************************************************************************************ 
+ * Copyright (c) 2008-2012, Columbia University
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the Columbia University nor the
+ *       names of its contributors may be used to endorse or promote products
+ *       derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY COLUMBIA UNIVERSITY ''AS IS'' AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL <copyright holder> BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * 
+ * 
+ * ===================================================================================
+ * Authors: Ohan Oda (ohan@cs.columbia.edu) 
+ * 
+ *************************************************************************************/
+
+#pragma once
+
+#include <string.h>
+#include <vector>
+#include <emmintrin.h>
+
+// Scratch buffers used by the resize kernels. They only grow, so resizing frames of the same
+// size does not allocate after the first call. Callers on different threads need their own.
+struct ResizeBuffers
+{
+	std::vector<unsigned short> rowSum;
+	std::vector<float> rowAccum;
+	std::vector<int> rowStart;
+	std::vector<int> rowCount;
+	std::vector<float> rowWeights;
+	int rowStride;
+	std::vector<int> colStart;
+	std::vector<int> colCount;
+	std::vector<float> colWeights;
+	int colStride;
+};
+
+// Used by alvar_resize_image
+static ResizeBuffers resizeBuffers;
+
+// Sums 'factor' source rows into 16-bit accumulators, 16 bytes at a time.
+static void sumRowsSSE2(const unsigned char* src, int srcStride, int factor, int length, unsigned short* sum)
+{
+	const __m128i zero = _mm_setzero_si128();
+	int i = 0;
+	for(; i <= length - 16; i += 16)
+	{
+		__m128i lo = zero, hi = zero;
+		for(int r = 0; r < factor; ++r)
+		{
+			__m128i v = _mm_loadu_si128((const __m128i*)(src + r * srcStride + i));
+			lo = _mm_add_epi16(lo, _mm_unpacklo_epi8(v, zero));
+			hi = _mm_add_epi16(hi, _mm_unpackhi_epi8(v, zero));
+		}
+		_mm_storeu_si128((__m128i*)(sum + i), lo);
+		_mm_storeu_si128((__m128i*)(sum + i + 8), hi);
+	}
+
+	for(; i < length; ++i)
+	{
+		unsigned short s = 0;
+		for(int r = 0; r < factor; ++r)
+			s += src[r * srcStride + i];
+		sum[i] = s;
+	}
+}
+
+// Averages a factor x factor block (factor is 2 or 4) into each destination pixel.
+static void resizeBox(const unsigned char* src, int srcStride, int channels, unsigned char* dst,
+	int dstWidth, int dstHeight, int dstStride, int factor, ResizeBuffers& buf)
+{
+	int rowLength = dstWidth * factor * channels;
+	if((int)buf.rowSum.size() < rowLength)
+		buf.rowSum.resize(rowLength);
+	unsigned short* sum = &buf.rowSum[0];
+
+	int shift = (factor == 2) ? 2 : 4;
+	int bias = 1 << (shift - 1);
+	const __m128i round = _mm_set1_epi32(bias);
+	const __m128i lowWord = _mm_set1_epi32(0xFFFF);
+
+	for(int y = 0; y < dstHeight; ++y)
+	{
+		sumRowsSSE2(src + y * factor * srcStride, srcStride, factor, rowLength, sum);
+
+		unsigned char* out = dst + y * dstStride;
+		int x = 0;
+		if(factor == 2 && channels == 1)
+		{
+			// Adjacent 16-bit sums are added within each 32-bit lane
+			for(; x <= dstWidth - 8; x += 8)
+			{
+				__m128i v0 = _mm_loadu_si128((const __m128i*)(sum + x * 2));
+				__m128i v1 = _mm_loadu_si128((const __m128i*)(sum + x * 2 + 8));
+				__m128i s0 = _mm_add_epi32(_mm_and_si128(v0, lowWord), _mm_srli_epi32(v0, 16));
+				__m128i s1 = _mm_add_epi32(_mm_and_si128(v1, lowWord), _mm_srli_epi32(v1, 16));
+				s0 = _mm_srli_epi32(_mm_add_epi32(s0, round), shift);
+				s1 = _mm_srli_epi32(_mm_add_epi32(s1, round), shift);
+				__m128i packed = _mm_packus_epi16(_mm_packs_epi32(s0, s1), _mm_setzero_si128());
+				_mm_storel_epi64((__m128i*)(out + x), packed);
+			}
+		}
+		else if(factor == 2 && channels == 4)
+		{
+			// Each register holds two source pixels; add its halves to get one output pixel
+			for(; x <= dstWidth - 2; x += 2)
+			{
+				__m128i v0 = _mm_loadu_si128((const __m128i*)(sum + x * 8));
+				__m128i v1 = _mm_loadu_si128((const __m128i*)(sum + x * 8 + 8));
+				__m128i s0 = _mm_add_epi16(v0, _mm_srli_si128(v0, 8));
+				__m128i s1 = _mm_add_epi16(v1, _mm_srli_si128(v1, 8));
+				__m128i s = _mm_unpacklo_epi64(s0, s1);
+				s = _mm_srli_epi16(_mm_add_epi16(s, _mm_set1_epi16((short)bias)), shift);
+				_mm_storel_epi64((__m128i*)(out + x * 4), _mm_packus_epi16(s, s));
+			}
+		}
+
+		for(; x < dstWidth; ++x)
+		{
+			const unsigned short* block = sum + x * factor * channels;
+			for(int c = 0; c < channels; ++c)
+			{
+				int s = 0;
+				for(int k = 0; k < factor; ++k)
+					s += block[k * channels + c];
+				out[x * channels + c] = (unsigned char)((s + bias) >> shift);
+			}
+		}
+	}
+}
+
+// Computes, for each destination index, the range of source indices it covers and the fraction
+// of each source index that falls inside it. The weights of one span add up to one.
+static void computeAreaSpans(int srcSize, int dstSize, std::vector<int>& start, std::vector<int>& count,
+	std::vector<float>& weights, int& stride)
+{
+	double scale = (double)srcSize / dstSize;
+	stride = (int)scale + 2;
+
+	start.resize(dstSize);
+	count.resize(dstSize);
+	weights.resize(dstSize * stride);
+
+	for(int d = 0; d < dstSize; ++d)
+	{
+		double begin = d * scale;
+		double end = begin + scale;
+		int first = (int)begin;
+		int last = (int)end;
+		if(last >= srcSize)
+			last = srcSize - 1;
+
+		start[d] = first;
+		count[d] = 0;
+		for(int s = first; s <= last; ++s)
+		{
+			double lo = (s > begin) ? s : begin;
+			double hi = (s + 1 < end) ? s + 1 : end;
+			if(hi <= lo)
+				continue;
+			weights[d * stride + count[d]] = (float)((hi - lo) / scale);
+			count[d]++;
+		}
+	}
+}
+
+// Accumulates 'weight' times a source row into the float row buffer.
+static void accumulateRowSSE2(const unsigned char* src, int length, float weight, float* accum)
+{
+	const __m128i zero = _mm_setzero_si128();
+	const __m128 w = _mm_set1_ps(weight);
+	int i = 0;
+	for(; i <= length - 16; i += 16)
+	{
+		__m128i v = _mm_loadu_si128((const __m128i*)(src + i));
+		__m128i lo = _mm_unpacklo_epi8(v, zero);
+		__m128i hi = _mm_unpackhi_epi8(v, zero);
+		__m128i parts[4] = { _mm_unpacklo_epi16(lo, zero), _mm_unpackhi_epi16(lo, zero),
+			_mm_unpacklo_epi16(hi, zero), _mm_unpackhi_epi16(hi, zero) };
+		for(int k = 0; k < 4; ++k)
+		{
+			__m128 a = _mm_loadu_ps(accum + i + k * 4);
+			a = _mm_add_ps(a, _mm_mul_ps(_mm_cvtepi32_ps(parts[k]), w));
+			_mm_storeu_ps(accum + i + k * 4, a);
+		}
+	}
+
+	for(; i < length; ++i)
+		accum[i] += src[i] * weight;
+}
+
+// Area-averaging resize for arbitrary reduction ratios. Each destination pixel is the average
+// of the source area it covers, with partially covered source pixels weighted by coverage.
+static void resizeArea(const unsigned char* src, int srcWidth, int srcHeight, int srcStride, int channels,
+	unsigned char* dst, int dstWidth, int dstHeight, int dstStride, ResizeBuffers& buf)
+{
+
+	computeAreaSpans(srcHeight, dstHeight, buf.rowStart, buf.rowCount, buf.rowWeights, buf.rowStride);
+	computeAreaSpans(srcWidth, dstWidth, buf.colStart, buf.colCount, buf.colWeights, buf.colStride);
+
+	int rowLength = srcWidth * channels;
+	if((int)buf.rowAccum.size() < rowLength)
+		buf.rowAccum.resize(rowLength);
+	float* accum = &buf.rowAccum[0];
+
+	for(int y = 0; y < dstHeight; ++y)
+	{
+		memset(accum, 0, sizeof(float) * rowLength);
+		for(int k = 0; k < buf.rowCount[y]; ++k)
+			accumulateRowSSE2(src + (buf.rowStart[y] + k) * srcStride, rowLength,
+				buf.rowWeights[y * buf.rowStride + k], accum);
+
+		unsigned char* out = dst + y * dstStride;
+		for(int x = 0; x < dstWidth; ++x)
+		{
+			const float* weights = &buf.colWeights[x * buf.colStride];
+			const float* in = accum + buf.colStart[x] * channels;
+			for(int c = 0; c < channels; ++c)
+			{
+				float s = 0;
+				for(int k = 0; k < buf.colCount[x]; ++k)
+					s += in[k * channels + c] * weights[k];
+				int v = (int)(s + 0.5f);
+				out[x * channels + c] = (unsigned char)((v > 255) ? 255 : v);
+			}
+		}
+	}
+}
+
+// Downscales an 8-bit image with 1 to 4 interleaved channels. Exact 2x and 4x reductions use
+// a box filter, and any other ratio uses area averaging. Upscaling is not supported.
+static bool resizeImage(const unsigned char* src, int srcWidth, int srcHeight, int srcStride, int channels,
+	unsigned char* dst, int dstWidth, int dstHeight, int dstStride, ResizeBuffers& buf)
+{
+	if(src == NULL || dst == NULL || channels < 1 || channels > 4)
+		return false;
+	if(dstWidth <= 0 || dstHeight <= 0 || dstWidth > srcWidth || dstHeight > srcHeight)
+		return false;
+
+	if(srcWidth / 2 == dstWidth && srcHeight / 2 == dstHeight)
+		resizeBox(src, srcStride, channels, dst, dstWidth, dstHeight, dstStride, 2, buf);
+	else if(srcWidth / 4 == dstWidth && srcHeight / 4 == dstHeight)
+		resizeBox(src, srcStride, channels, dst, dstWidth, dstHeight, dstStride, 4, buf);
+	else
+		resizeArea(src, srcWidth, srcHeight, srcStride, channels, dst, dstWidth, dstHeight, dstStride, buf);
+
+	return true;
+}
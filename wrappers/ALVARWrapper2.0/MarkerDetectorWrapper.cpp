@@ -33,19 +33,36 @@
 #include <stdlib.h>
 #include <vector>
 #include <map>
+#include <algorithm>
 #include "MarkerDetector.h"
 #include "MultiMarker.h"
 #include "FernImageDetector.h"
 #include "FernPoseEstimator.h"
 
+#include "Tracepoints.cpp"
+#include "ImageConversion.cpp"
+#include "ImageResize.cpp"
+#include "TiledDetection.cpp"
+#include "FeaturePoseEstimation.cpp"
+#include "PoseChanges.cpp"
+#include "ReferenceFrame.cpp"
+#include "PatternMarker.cpp"
+#include "FrameQuality.cpp"
+#include "MarkerField.cpp"
+#include "CornerRefinement.cpp"
+#include "DetectionScale.cpp"
+
 using namespace std;
 using namespace alvar;
 
+TRACE_DEFINE_PROVIDER();
+
 struct ALVARCamera
 {
 	Camera* cam;
 	int width;
 	int height;
+	string calibFile;
 };
 
 // Shared parameters
@@ -55,39 +72,143 @@ IplImage *hide_texture;
 unsigned int hide_texture_size;
 unsigned int channels;
 double margin;
-map<int, int> idTable;
-map<int, int>::const_iterator foundPtr;
-vector<int> foundMarkers;
 double curMaxTrackError;
 
+// The per-frame scratch buffers of a detector. They are kept with the detector so that their
+// capacity carries over from frame to frame, and the results of one detector are not overwritten
+// by another.
+struct FrameArena
+{
+	vector<pair<int, int> > idTable;
+	vector<int> foundMarkers;
+	vector<int> frameIDs;
+	vector<double> framePoses;
+};
+
 // For single-marker & multi-marker tracking
 vector<MarkerDetector<MarkerData> *> markerDetectors;
+vector<TiledDetector *> tiledDetectors;
+vector<PoseChangeTracker *> markerChanges;
+vector<PoseChangeTracker *> multiMarkerChanges;
+vector<ReferenceFrame *> referenceFrames;
+vector<FrameQualityGate *> qualityGates;
+vector<MarkerField *> markerFields;
+vector<CornerRefiner *> cornerRefiners;
+vector<DetectionScaler *> detectionScalers;
+vector<FrameArena *> frameArenas;
 vector<MultiMarker> multiMarkers;
 
 // For feature tracking
 FernPoseEstimator fernEstimator;
 FernImageDetector fernDetector(false);
+ProsacEstimator prosacEstimator;
+vector<CvPoint2D64f> featureIpts;
+vector<CvPoint3D64f> featureMpts;
+vector<CvPoint2D64f> inlierIpts;
+vector<CvPoint3D64f> inlierMpts;
 cv::Mat gray;
 
 // Used for camera calibration
 ProjPoints pp;
 bool calibration_started;
 
+// Computes the pose of the multi-marker at 'index' from the markers found by the detector, and
+// returns its error, which is -1 if none of its markers were found
+static double getMultiMarkerPose(int detectorID, int camID, bool detectAdditional, int index, double* mat)
+{
+	Pose pose;
+	double error;
+
+	if(detectAdditional)
+	{
+		error = multiMarkers.at(index).Update(markerDetectors[detectorID]->markers, 
+			cams[camID].cam, pose);
+		multiMarkers.at(index).SetTrackMarkers(*markerDetectors[detectorID], cams[camID].cam, pose);
+		markerDetectors[detectorID]->DetectAdditional(&image, cams[camID].cam, false, curMaxTrackError);
+	}
+
+	error = multiMarkers.at(index).Update(markerDetectors[detectorID]->markers, cams[camID].cam, pose);
+	pose.GetMatrixGL(mat);
+	return error;
+}
+
+// Writes the camera space pose of a detected marker. If the detector tracks a marker field, the
+// pose comes from the field's camera pose instead of a fit to the marker alone.
+static void getMarkerPose(int detectorID, MarkerData& marker, double* mat)
+{
+	if(markerFields[detectorID]->enabled)
+		markerFields[detectorID]->getMarkerPose(marker.GetId(), mat);
+	else
+		marker.pose.GetMatrixGL(mat);
+}
+
+// Looks up the camera space pose of the detector's reference marker or multi-marker in the
+// current frame, and returns false if it was not found
+static bool findReferencePose(int detectorID, double* mat)
+{
+	ReferenceFrame* ref = referenceFrames[detectorID];
+	if(ref->markerID >= 0)
+	{
+		std::vector<MarkerData>* markers = markerDetectors[detectorID]->markers;
+		for(size_t i = 0; i < markers->size(); ++i)
+		{
+			if((*markers)[i].GetId() == ref->markerID)
+			{
+				if(markerFields[detectorID]->enabled && !markerFields[detectorID]->isEstablished(ref->markerID))
+					return false;
+				getMarkerPose(detectorID, (*markers)[i], mat);
+				return true;
+			}
+		}
+		return false;
+	}
+
+	return ref->multiMarkerIndex < multiMarkers.size() && 
+		getMultiMarkerPose(detectorID, ref->camID, false, ref->multiMarkerIndex, mat) != -1;
+}
+
+// Re-expresses the poses gathered in the detector's FrameArena in its reference frame if one is set.
+// Returns false if the reference is set but was not found, in which case none of the poses
+// can be placed.
+static bool applyReferenceFrame(int detectorID, const double* referencePose)
+{
+	ReferenceFrame* ref = referenceFrames[detectorID];
+	if(!ref->isSet())
+		return true;
+
+	ref->found = false;
+	if(referencePose == NULL)
+		return false;
+
+	FrameArena* arena = frameArenas[detectorID];
+	ref->setReferencePose(referencePose);
+	if(arena->frameIDs.size() > 0)
+		ref->transform(&arena->framePoses[0], arena->frameIDs.size());
+	return true;
+}
+
 extern "C"
 {
 	__declspec(dllexport) void alvar_init()
 	{
+		TRACE_EXPORT(alvar_init);
+
 		calibration_started = false;
 	}
 
 	// returns the ID of the added camera if succeeds, otherwise, returns -1
 	__declspec(dllexport) int alvar_add_camera(char* calibFile, int width, int height)
 	{
+		TRACE_EXPORT(alvar_add_camera);
+
 		int ret = -1;
 		ALVARCamera camera;
 		camera.cam = new Camera();
 		if((calibFile != NULL) && camera.cam->SetCalib(calibFile, width, height))
+		{
 			ret = cams.size();
+			camera.calibFile = calibFile;
+		}
 		else
 			camera.cam->SetRes(width, height);
 
@@ -100,6 +221,8 @@ extern "C"
 
 	__declspec(dllexport) void alvar_add_fern_estimator(char* calibFile, int width, int height)
 	{
+		TRACE_EXPORT(alvar_add_fern_estimator);
+
 		if(!((calibFile != NULL) && fernEstimator.setCalibration(calibFile, width, height)))
 			fernEstimator.setResolution(width, height);
 	}
@@ -107,6 +230,8 @@ extern "C"
 	__declspec(dllexport) void alvar_get_camera_projection(char* calibFile, int width, int height, 
 		float farClip, float nearClip, double* projMat)
 	{
+		TRACE_EXPORT(alvar_get_camera_projection);
+
 		Camera cam;
 		if(calibFile != NULL)
 			cam.SetCalib(calibFile, width, height);
@@ -116,6 +241,8 @@ extern "C"
 
 	__declspec(dllexport) int alvar_get_camera_params(int camID, double* projMat, double* fovX, double* fovY, float farClip, float nearClip)
 	{
+		TRACE_EXPORT(alvar_get_camera_params);
+
 		if(camID >= cams.size())
 			return -1;
 
@@ -129,15 +256,210 @@ extern "C"
 	// returns the ID of the added marker detector
 	__declspec(dllexport) int alvar_add_marker_detector(double markerSize, int markerRes = 5, double margin = 2)
 	{
+		TRACE_EXPORT(alvar_add_marker_detector);
+
 		MarkerDetector<MarkerData>* markerDetector = new MarkerDetector<MarkerData>();
 		markerDetector->SetMarkerSize(markerSize, markerRes, margin);
 		
 		markerDetectors.push_back(markerDetector);
+		tiledDetectors.push_back(new TiledDetector(markerSize, markerRes, margin));
+		markerChanges.push_back(new PoseChangeTracker());
+		multiMarkerChanges.push_back(new PoseChangeTracker());
+		referenceFrames.push_back(new ReferenceFrame());
+		qualityGates.push_back(new FrameQualityGate());
+		markerFields.push_back(new MarkerField());
+		cornerRefiners.push_back(new CornerRefiner());
+		detectionScalers.push_back(new DetectionScaler());
+		frameArenas.push_back(new FrameArena());
+		return markerDetectors.size() - 1;
+	}
+
+	// Adds a detector for ARToolKit pattern markers and returns its ID. Patterns are added with
+	// alvar_add_pattern, and a candidate is taken as the pattern it correlates best with if the
+	// normalized cross-correlation is at least 'minScore'. A pattern is only correlated with
+	// candidates whose coarse 64 bit hashes differ from its own in at most 'maxHashDistance' bits,
+	// or with every candidate if 'maxHashDistance' is negative.
+	__declspec(dllexport) int alvar_add_pattern_detector(double markerSize, double minScore, int maxHashDistance)
+	{
+		TRACE_EXPORT(alvar_add_pattern_detector);
+
+		// The pattern covers the inner half of an ARToolKit marker
+		PatternDetector* markerDetector = new PatternDetector(minScore, maxHashDistance);
+		markerDetector->SetMarkerSize(markerSize, PATTERN_RES, PATTERN_RES / 2);
+
+		markerDetectors.push_back(markerDetector);
+		tiledDetectors.push_back(new TiledDetector(markerSize, PATTERN_RES, PATTERN_RES / 2));
+		markerChanges.push_back(new PoseChangeTracker());
+		multiMarkerChanges.push_back(new PoseChangeTracker());
+		referenceFrames.push_back(new ReferenceFrame());
+		qualityGates.push_back(new FrameQualityGate());
+		markerFields.push_back(new MarkerField());
+		cornerRefiners.push_back(new CornerRefiner());
+		detectionScalers.push_back(new DetectionScaler());
+		frameArenas.push_back(new FrameArena());
 		return markerDetectors.size() - 1;
 	}
 
+	// Loads an ARToolKit .patt file into a pattern detector, and returns the marker ID that the
+	// pattern is reported with, or -1 if the file could not be read
+	__declspec(dllexport) int alvar_add_pattern(int detectorID, char* patternFile)
+	{
+		TRACE_EXPORT(alvar_add_pattern);
+
+		if(detectorID >= markerDetectors.size())
+			return -1;
+
+		PatternDetector* detector = dynamic_cast<PatternDetector*>(markerDetectors[detectorID]);
+		if(detector == NULL)
+			return -1;
+
+		return detector->bank.load(patternFile);
+	}
+
+	// Splits each frame into 'numBands' overlapping horizontal bands that are detected in parallel.
+	// 'overlap' should be at least the height in pixels of the largest marker expected in the image.
+	// Passing 1 band turns parallel detection off. Not supported by pattern detectors.
+	__declspec(dllexport) int alvar_set_detect_bands(int detectorID, int numBands, int overlap)
+	{
+		TRACE_EXPORT(alvar_set_detect_bands);
+
+		if(detectorID >= markerDetectors.size())
+			return -1;
+
+		if(dynamic_cast<PatternDetector*>(markerDetectors[detectorID]) != NULL)
+			return -1;
+
+		tiledDetectors[detectorID]->configure(numBands, overlap);
+		return 0;
+	}
+
+	// Makes the detector skip frames that are too blurred or badly exposed to give good poses. The
+	// frame is subsampled by 'step' in both directions to estimate its sharpness and mean brightness.
+	// A frame is skipped if its sharpness is below 'minSharpnessRatio' times the average of recently
+	// detected frames, or its mean brightness (0 to 255) is outside [minBrightness, maxBrightness].
+	// Skipped frames keep the markers of the last detected frame. At most 'maxSkippedFrames' frames
+	// are skipped in a row, or any number if it is 0. Passing a step of 0 turns the gate off.
+	__declspec(dllexport) int alvar_set_frame_quality_gate(int detectorID, int step, double minSharpnessRatio,
+		double minBrightness, double maxBrightness, int maxSkippedFrames)
+	{
+		TRACE_EXPORT(alvar_set_frame_quality_gate);
+
+		if(detectorID >= markerDetectors.size())
+			return -1;
+
+		qualityGates[detectorID]->configure(step, minSharpnessRatio, minBrightness, maxBrightness, 
+			maxSkippedFrames);
+		return 0;
+	}
+
+	// Gets the sharpness and mean brightness of the last frame passed to alvar_detect_marker, and
+	// returns whether detection was skipped for it
+	__declspec(dllexport) bool alvar_get_frame_quality(int detectorID, double* sharpness, double* brightness)
+	{
+		TRACE_EXPORT(alvar_get_frame_quality);
+
+		if(detectorID >= markerDetectors.size())
+			return false;
+
+		*sharpness = qualityGates[detectorID]->sharpness;
+		*brightness = qualityGates[detectorID]->brightness;
+		return qualityGates[detectorID]->skipped;
+	}
+
+	// Makes the detector treat its markers as a static field. Each frame, a single camera pose is
+	// solved from the corners of all visible field markers, and the poses of the markers are
+	// derived from it instead of being fitted one by one. Only markers in the field are reported
+	// as found. If 'learnFrames' is above 0, markers that are not in the field yet have their world
+	// pose averaged over that many frames before they join it and refined afterwards, and the first
+	// marker seen becomes the origin of an empty field.
+	__declspec(dllexport) int alvar_set_marker_field(int detectorID, bool enable, int learnFrames)
+	{
+		TRACE_EXPORT(alvar_set_marker_field);
+
+		if(detectorID >= markerDetectors.size())
+			return -1;
+
+		markerFields[detectorID]->configure(enable, learnFrames);
+		return 0;
+	}
+
+	// Adds a marker to the detector's field with a known, fixed pose in the world frame
+	__declspec(dllexport) int alvar_add_field_marker(int detectorID, int markerID, double* worldPose)
+	{
+		TRACE_EXPORT(alvar_add_field_marker);
+
+		if(detectorID >= markerDetectors.size())
+			return -1;
+
+		markerFields[detectorID]->addMarker(markerID, worldPose);
+		return 0;
+	}
+
+	// Writes the world pose of a marker in the detector's field, and returns false if the marker
+	// is not in the field or is still being learned
+	__declspec(dllexport) bool alvar_get_field_marker_pose(int detectorID, int markerID, double* worldPose)
+	{
+		TRACE_EXPORT(alvar_get_field_marker_pose);
+
+		if(detectorID >= markerDetectors.size())
+			return false;
+
+		return markerFields[detectorID]->getMarkerWorldPose(markerID, worldPose);
+	}
+
+	// Writes the camera pose in the world frame of the detector's field solved by the last
+	// alvar_detect_marker call, and returns false if no field marker was visible
+	__declspec(dllexport) bool alvar_get_field_camera_pose(int detectorID, double* poseMat)
+	{
+		TRACE_EXPORT(alvar_get_field_camera_pose);
+
+		if(detectorID >= markerDetectors.size())
+			return false;
+
+		MarkerField* field = markerFields[detectorID];
+		if(!field->enabled || !field->found)
+			return false;
+
+		memcpy(poseMat, field->cameraPose, sizeof(double) * 16);
+		return true;
+	}
+
+	// Makes the detector refine the marker corners found by ALVAR to sub-pixel accuracy from the
+	// image gradient across the marker edges, and fit the poses to the refined corners. Each edge
+	// is sampled at 'samplesPerEdge' points (rounded up to a multiple of 4), and the edge is searched
+	// for within 'searchRadius' pixels of ALVAR's edge. Corners that would move more than 'maxShift'
+	// pixels are kept where ALVAR found them.
+	__declspec(dllexport) int alvar_set_corner_refinement(int detectorID, bool enable, int samplesPerEdge,
+		int searchRadius, double maxShift)
+	{
+		TRACE_EXPORT(alvar_set_corner_refinement);
+
+		if(detectorID >= markerDetectors.size())
+			return -1;
+
+		cornerRefiners[detectorID]->configure(enable, samplesPerEdge, searchRadius, maxShift);
+		return 0;
+	}
+
+	// Detects markers on the frame reduced by 'factor' (1, 2 or 4) with a box filter, which is cheaper
+	// and less noisy but misses markers that are too small in the reduced frame. The markers are
+	// reported in full frame coordinates and their poses are fitted with the full frame camera, after
+	// corner refinement if it is enabled. The band overlap of alvar_set_detect_bands is in reduced pixels.
+	__declspec(dllexport) int alvar_set_detect_scale(int detectorID, int factor)
+	{
+		TRACE_EXPORT(alvar_set_detect_scale);
+
+		if(detectorID >= markerDetectors.size())
+			return -1;
+
+		detectionScalers[detectorID]->configure(factor);
+		return 0;
+	}
+
 	__declspec(dllexport) int alvar_train_feature(char* imageFilename, char* classifierFilename)
 	{
+		TRACE_EXPORT(alvar_train_feature);
+
 		try
 		{
 			std::string imageName(imageFilename);
@@ -157,6 +479,8 @@ extern "C"
 
 	__declspec(dllexport) int alvar_add_feature_detector(char* classifierFilename)
 	{
+		TRACE_EXPORT(alvar_add_feature_detector);
+
 		if(fernDetector.read(classifierFilename))
 			return 0;
 		else
@@ -165,15 +489,20 @@ extern "C"
 
 	__declspec(dllexport) int alvar_set_marker_size(int detectorID, int markerID, double markerSize)
 	{
+		TRACE_EXPORT(alvar_set_marker_size);
+
 		if(detectorID >= markerDetectors.size())
 			return -1;
 
 		markerDetectors[detectorID]->SetMarkerSizeForId(markerID, markerSize);
+		tiledDetectors[detectorID]->setMarkerSizeForId(markerID, markerSize);
 		return 0;
 	}
 
 	__declspec(dllexport) void alvar_add_multi_marker(char* filename)
 	{
+		TRACE_EXPORT(alvar_add_multi_marker);
+
 		MultiMarker marker;
 		if(strstr(filename, ".xml") != NULL)
 			marker.Load(filename, FILE_FORMAT_XML);
@@ -182,10 +511,42 @@ extern "C"
 		multiMarkers.push_back(marker);
 	}
 
+	// Converts a captured BGR24 or BGRX32 frame (srcBytes = 3 or 4) into the tracker image and the
+	// background texture in one pass. Either output may be NULL. Returns false if the format is not supported.
+	__declspec(dllexport) bool alvar_convert_frame(char* srcData, int srcStride, int srcBytes, int width,
+		int height, int format, char* trackerImage, int* textureImage)
+	{
+		TRACE_EXPORT(alvar_convert_frame);
+
+		TRACE_PROBE3(convert__start, width, height, format);
+		bool converted = convertFrame((const unsigned char*)srcData, srcStride, srcBytes, width, height, format,
+			(unsigned char*)trackerImage, textureImage);
+		TRACE_PROBE1(convert__done, converted);
+
+		return converted;
+	}
+
+	// Downscales an 8-bit image with 1 to 4 channels. Exact 2x and 4x reductions are box filtered,
+	// other ratios are area averaged.
+	__declspec(dllexport) bool alvar_resize_image(char* srcData, int srcWidth, int srcHeight, int channels,
+		char* dstData, int dstWidth, int dstHeight)
+	{
+		TRACE_EXPORT(alvar_resize_image);
+
+		TRACE_PROBE4(resize__start, srcWidth, srcHeight, dstWidth, dstHeight);
+		bool resized = resizeImage((const unsigned char*)srcData, srcWidth, srcHeight, srcWidth * channels, 
+			channels, (unsigned char*)dstData, dstWidth, dstHeight, dstWidth * channels, resizeBuffers);
+		TRACE_PROBE1(resize__done, resized);
+
+		return resized;
+	}
+
 	__declspec(dllexport) bool alvar_detect_feature(int camID, int nChannels, 
 		char* colorModel, char* channelSeq, char* imageData, double minInlierRatio,
 		int minMappedPoints, double* inlierRatio, int* mappedPoints)
 	{
+		TRACE_EXPORT(alvar_detect_feature);
+
 		image.nSize = sizeof(IplImage);
 		image.ID = 0;
 		image.nChannels = nChannels;
@@ -219,18 +580,38 @@ extern "C"
 			gray = &image;
 		}
 
-		vector<CvPoint2D64f> ipts;
-		vector<CvPoint3D64f> mpts;
+		// The correspondences are kept across frames so that their storage is reused
+		vector<CvPoint2D64f>& ipts = featureIpts;
+		vector<CvPoint3D64f>& mpts = featureMpts;
+		ipts.clear();
+		mpts.clear();
 
+		TRACE_PROBE2(feature__start, image.width, image.height);
 		fernDetector.findFeatures(gray, true);
 		fernDetector.imagePoints(ipts);
 		fernDetector.modelPoints(mpts, true);
 
 		*inlierRatio = fernDetector.inlierRatio();
 		*mappedPoints = mpts.size();
+		TRACE_PROBE2(feature__done, *inlierRatio, *mappedPoints);
 
 		if (*inlierRatio > minInlierRatio && *mappedPoints > minMappedPoints) {
-			fernEstimator.calculateFromPointCorrespondences(mpts, ipts);
+			// Estimate the pose from the consensus set only, and fall back to all the
+			// correspondences if no hypothesis reaches the required inlier ratio
+			int inliers = prosacEstimator.estimate(mpts, ipts, minInlierRatio);
+			if (inliers >= minInlierRatio * mpts.size() && inliers > minMappedPoints) {
+				inlierIpts.clear();
+				inlierMpts.clear();
+				for (size_t i = 0; i < mpts.size(); ++i) {
+					if (prosacEstimator.inliers[i]) {
+						inlierIpts.push_back(ipts[i]);
+						inlierMpts.push_back(mpts[i]);
+					}
+				}
+				fernEstimator.calculateFromPointCorrespondences(inlierMpts, inlierIpts);
+			}
+			else
+				fernEstimator.calculateFromPointCorrespondences(mpts, ipts);
 			return true;
 		}
 		else
@@ -242,6 +623,8 @@ extern "C"
 		int* numFoundMarkers, int* numInterestedMarkers, double maxMarkerError = 0.08, 
 		double maxTrackError = 0.2)
 	{
+		TRACE_EXPORT(alvar_detect_marker);
+
 		if(detectorID >= markerDetectors.size() || camID >= cams.size())
 			return;
 
@@ -270,62 +653,118 @@ extern "C"
 		image.imageData = imageData;
 		image.imageDataOrigin = NULL;
 
-		markerDetectors[detectorID]->Detect(&image, cams[camID].cam, true, false, maxMarkerError, maxTrackError);
-		curMaxTrackError = maxTrackError;
+		// Frames that are too blurred or badly exposed keep the markers of the last detected frame
+		FrameQualityGate* gate = qualityGates[detectorID];
+		MarkerField* field = markerFields[detectorID];
+		CornerRefiner* refiner = cornerRefiners[detectorID];
+		DetectionScaler* scaler = detectionScalers[detectorID];
+		if(!gate->isEnabled() || gate->evaluate(imageData, image.width, image.height, image.widthStep, nChannels))
+		{
+			IplImage* detectImage = &image;
+			Camera* detectCam = cams[camID].cam;
+			if(scaler->isEnabled())
+			{
+				TRACE_PROBE1(reduce__start, detectorID);
+				detectImage = scaler->reduce(&image, markerDetectors[detectorID]->markers);
+				detectCam = scaler->reducedCamera(cams[camID].calibFile);
+				TRACE_PROBE3(reduce__done, detectorID, detectImage->width, detectImage->height);
+			}
+
+			// Markers of a field only need their corners, since their poses come from the field, and
+			// refined or reduced corners get their poses fitted afterwards
+			bool fitPose = !field->enabled && !refiner->enabled;
+			bool updatePose = fitPose && !scaler->isEnabled();
+			TRACE_PROBE3(detect__start, detectorID, detectImage->width, detectImage->height);
+			if(tiledDetectors[detectorID]->isEnabled())
+				tiledDetectors[detectorID]->detect(markerDetectors[detectorID], detectImage, cams[camID].calibFile,
+					maxMarkerError, maxTrackError, updatePose);
+			else
+				markerDetectors[detectorID]->Detect(detectImage, detectCam, true, false, maxMarkerError, maxTrackError,
+					MarkerDetectorImpl::CVSEQ, updatePose);
+			curMaxTrackError = maxTrackError;
+			if(scaler->isEnabled())
+				scaler->expand(markerDetectors[detectorID]->markers, cams[camID].cam, fitPose);
+			TRACE_PROBE2(detect__done, detectorID, (int)markerDetectors[detectorID]->markers->size());
+
+			if(refiner->enabled)
+			{
+				TRACE_PROBE1(corners__start, detectorID);
+				int moved = refiner->refine(markerDetectors[detectorID]->markers, &image, cams[camID].cam, 
+					!field->enabled);
+				TRACE_PROBE2(corners__done, detectorID, moved);
+			}
+
+			if(field->enabled)
+			{
+				TRACE_PROBE1(field_pose__start, detectorID);
+				int used = field->solve(markerDetectors[detectorID]->markers, cams[camID].cam);
+				TRACE_PROBE2(field_pose__done, detectorID, used);
+			}
+		}
+		else
+		{
+			TRACE_PROBE3(frame__skipped, detectorID, (int)gate->sharpness, (int)gate->brightness);
+		}
 		*numFoundMarkers = markerDetectors[detectorID]->markers->size();
 
 		int interestedMarkerNum = *numInterestedMarkers;
 		int markerCount = 0;
-		int tmpID = 0;
+		vector<pair<int, int> >& idTable = frameArenas[detectorID]->idTable;
+		vector<int>& foundMarkers = frameArenas[detectorID]->foundMarkers;
 		foundMarkers.clear();
 		int size = markerDetectors[detectorID]->markers->size();
 		if(size > 0 && interestedMarkerNum > 0)
 		{
+			// A sorted array of (ID, index) pairs instead of a map, so that no nodes are allocated
+			// per frame. If an ID was found more than once, the last one is used.
 			idTable.clear();
 			for(int i = 0; i < size; ++i)
-			{
-				tmpID = (*(markerDetectors[detectorID]->markers))[i].GetId();
-				idTable[tmpID] = i;
-			}
+				idTable.push_back(make_pair((int)(*(markerDetectors[detectorID]->markers))[i].GetId(), i));
+			sort(idTable.begin(), idTable.end());
 
 			for(int i = 0; i < interestedMarkerNum; ++i)
 			{
-				foundPtr = idTable.find(interestedMarkerIDs[i]);
-				if(foundPtr != idTable.end())
+				vector<pair<int, int> >::const_iterator found = upper_bound(idTable.begin(), idTable.end(),
+					make_pair(interestedMarkerIDs[i], size));
+				if(found != idTable.begin() && (found - 1)->first == interestedMarkerIDs[i] &&
+					(!field->enabled || field->isEstablished(interestedMarkerIDs[i])))
 				{
-					foundMarkers.push_back(foundPtr->second);
+					foundMarkers.push_back((found - 1)->second);
 					markerCount++;
 				}
 			}
 		}
 
 		*numInterestedMarkers = markerCount;
+		TRACE_PROBE3(markers__found, detectorID, *numFoundMarkers, markerCount);
 	}
 
 	__declspec(dllexport) void alvar_get_poses(int detectorID, int* ids, double* poseMats)
 	{
+		TRACE_EXPORT(alvar_get_poses);
+
 		if(detectorID >= markerDetectors.size())
 			return;
 
+		const vector<int>& foundMarkers = frameArenas[detectorID]->foundMarkers;
 		int size = foundMarkers.size();
 		if(size == 0)
 			return;
 
-		double mat[16];
-		int textureIndex = 0;
+		TRACE_PROBE2(pose__start, detectorID, size);
 		for(size_t i = 0; i < foundMarkers.size(); ++i)
 		{
-			Pose p;
-			ids[i] = (*(markerDetectors[detectorID]->markers))[foundMarkers[i]].GetId();
-			p = (*(markerDetectors[detectorID]->markers))[foundMarkers[i]].pose;
-
-			p.GetMatrixGL(mat);
-			memcpy(poseMats + i * 16, &mat, sizeof(double) * 16);
+			MarkerData& marker = (*(markerDetectors[detectorID]->markers))[foundMarkers[i]];
+			ids[i] = marker.GetId();
+			getMarkerPose(detectorID, marker, poseMats + i * 16);
 		}
+		TRACE_PROBE1(pose__done, detectorID);
 	}
 
 	__declspec(dllexport) void alvar_get_feature_pose(double* poseMats)
 	{
+		TRACE_EXPORT(alvar_get_feature_pose);
+
 		Pose pose = fernEstimator.pose();
 		double mat[16];
 
@@ -337,6 +776,8 @@ extern "C"
 	__declspec(dllexport) void alvar_get_multi_marker_poses(int detectorID, int camID, bool detectAdditional,
 		int* ids, double* poseMats, double* errors)
 	{
+		TRACE_EXPORT(alvar_get_multi_marker_poses);
+
 		if(detectorID >= markerDetectors.size() || camID >= cams.size())
 			return;
 
@@ -344,30 +785,164 @@ extern "C"
 		if(size == 0)
 			return;
 
-		double mat[16];
-		int textureIndex = 0;
+		TRACE_PROBE3(multi_pose__start, detectorID, size, (int)multiMarkers.size());
 		for(int i = 0; i < multiMarkers.size(); ++i)
 		{
 			ids[i] = i;
-			Pose pose;
+			errors[i] = getMultiMarkerPose(detectorID, camID, detectAdditional, i, poseMats + i * 16);
+		}
+		TRACE_PROBE1(multi_pose__done, detectorID);
+	}
+
+	// Sets how far a visible marker or multi-marker has to move since its pose was last reported
+	// before alvar_get_pose_changes or alvar_get_multi_marker_pose_changes report it again
+	__declspec(dllexport) void alvar_set_pose_change_thresholds(int detectorID, double translation, 
+		double rotation)
+	{
+		TRACE_EXPORT(alvar_set_pose_change_thresholds);
 
-			if(detectAdditional)
+		if(detectorID >= markerDetectors.size())
+			return;
+
+		markerChanges[detectorID]->translationThreshold = translation;
+		markerChanges[detectorID]->rotationThreshold = rotation;
+		multiMarkerChanges[detectorID]->translationThreshold = translation;
+		multiMarkerChanges[detectorID]->rotationThreshold = rotation;
+	}
+
+	// Returns the number of interested markers found by the last alvar_detect_marker call that 
+	// appeared, moved or were lost since the previous call, and writes their IDs, PoseChange types
+	// and poses. A lost marker carries its last reported pose.
+	__declspec(dllexport) int alvar_get_pose_changes(int detectorID, int* ids, int* changes, double* poseMats)
+	{
+		TRACE_EXPORT(alvar_get_pose_changes);
+
+		if(detectorID >= markerDetectors.size())
+			return 0;
+
+		PoseChangeTracker* tracker = markerChanges[detectorID];
+		tracker->begin(ids, changes, poseMats);
+
+		const vector<int>& foundMarkers = frameArenas[detectorID]->foundMarkers;
+		vector<int>& frameIDs = frameArenas[detectorID]->frameIDs;
+		vector<double>& framePoses = frameArenas[detectorID]->framePoses;
+		frameIDs.resize(foundMarkers.size());
+		framePoses.resize(foundMarkers.size() * 16);
+		for(size_t i = 0; i < foundMarkers.size(); ++i)
+		{
+			MarkerData& marker = (*(markerDetectors[detectorID]->markers))[foundMarkers[i]];
+			frameIDs[i] = marker.GetId();
+			getMarkerPose(detectorID, marker, &framePoses[i * 16]);
+		}
+
+		double refMat[16];
+		bool refFound = referenceFrames[detectorID]->isSet() && findReferencePose(detectorID, refMat);
+		if(applyReferenceFrame(detectorID, refFound ? refMat : NULL))
+		{
+			for(size_t i = 0; i < frameIDs.size(); ++i)
+				tracker->setVisible(frameIDs[i], &framePoses[i * 16]);
+		}
+
+		int numChanges = tracker->end();
+		TRACE_PROBE3(pose_changes, detectorID, (int)frameIDs.size(), numChanges);
+
+		return numChanges;
+	}
+
+	// Same as alvar_get_pose_changes for the multi-markers, which are identified by the order in
+	// which they were added
+	__declspec(dllexport) int alvar_get_multi_marker_pose_changes(int detectorID, int camID, 
+		bool detectAdditional, int* ids, int* changes, double* poseMats)
+	{
+		TRACE_EXPORT(alvar_get_multi_marker_pose_changes);
+
+		if(detectorID >= markerDetectors.size() || camID >= cams.size())
+			return 0;
+
+		PoseChangeTracker* tracker = multiMarkerChanges[detectorID];
+		tracker->begin(ids, changes, poseMats);
+
+		ReferenceFrame* ref = referenceFrames[detectorID];
+		double refMat[16];
+		bool refFound = false;
+
+		vector<int>& frameIDs = frameArenas[detectorID]->frameIDs;
+		vector<double>& framePoses = frameArenas[detectorID]->framePoses;
+		frameIDs.clear();
+		framePoses.resize(multiMarkers.size() * 16);
+		if(markerDetectors[detectorID]->markers->size() > 0)
+		{
+			for(int i = 0; i < multiMarkers.size(); ++i)
 			{
-				errors[i] = multiMarkers.at(i).Update(markerDetectors[detectorID]->markers, 
-					cams[camID].cam, pose);
-				multiMarkers.at(i).SetTrackMarkers(*markerDetectors[detectorID], cams[camID].cam, pose);
-				markerDetectors[detectorID]->DetectAdditional(&image, cams[camID].cam, false, curMaxTrackError);
+				double* mat = &framePoses[frameIDs.size() * 16];
+				if(getMultiMarkerPose(detectorID, camID, detectAdditional, i, mat) != -1)
+				{
+					if(i == ref->multiMarkerIndex)
+					{
+						memcpy(refMat, mat, sizeof(double) * 16);
+						refFound = true;
+					}
+					frameIDs.push_back(i);
+				}
 			}
+		}
+
+		if(ref->markerID >= 0)
+			refFound = findReferencePose(detectorID, refMat);
 
-			errors[i] = multiMarkers.at(i).Update(markerDetectors[detectorID]->markers, cams[camID].cam, pose);
-			pose.GetMatrixGL(mat);
-			memcpy(poseMats + i * 16, &mat, sizeof(double) * 16);
+		if(applyReferenceFrame(detectorID, refFound ? refMat : NULL))
+		{
+			for(size_t i = 0; i < frameIDs.size(); ++i)
+				tracker->setVisible(frameIDs[i], &framePoses[i * 16]);
 		}
+
+		int numChanges = tracker->end();
+		TRACE_PROBE3(multi_pose_changes, detectorID, (int)frameIDs.size(), numChanges);
+
+		return numChanges;
+	}
+
+	// Makes alvar_get_pose_changes and alvar_get_multi_marker_pose_changes express all poses in 
+	// the frame of the marker with 'markerID', or of the multi-marker at 'multiMarkerIndex' if 
+	// markerID is -1, instead of the camera's. Passing -1 for both restores camera space poses.
+	// Markers are reported as lost while the reference is not visible.
+	__declspec(dllexport) void alvar_set_reference_frame(int detectorID, int camID, int markerID, 
+		int multiMarkerIndex)
+	{
+		TRACE_EXPORT(alvar_set_reference_frame);
+
+		if(detectorID >= markerDetectors.size() || camID >= cams.size())
+			return;
+
+		ReferenceFrame* ref = referenceFrames[detectorID];
+		ref->camID = camID;
+		ref->markerID = markerID;
+		ref->multiMarkerIndex = (markerID >= 0) ? -1 : multiMarkerIndex;
+		ref->found = false;
+	}
+
+	// Writes the camera pose in the reference frame found by the last pose changes call, and 
+	// returns false if no reference is set or it was not found
+	__declspec(dllexport) bool alvar_get_reference_camera_pose(int detectorID, double* poseMat)
+	{
+		TRACE_EXPORT(alvar_get_reference_camera_pose);
+
+		if(detectorID >= markerDetectors.size())
+			return false;
+
+		ReferenceFrame* ref = referenceFrames[detectorID];
+		if(!ref->isSet() || !ref->found)
+			return false;
+
+		memcpy(poseMat, ref->cameraPose, sizeof(double) * 16);
+		return true;
 	}
 
 	__declspec(dllexport) bool alvar_calibrate_camera(int camID, int nChannels, char* colorModel, char* channelSeq,
 		char* imageData, double etalon_square_size, int etalon_rows, int etalon_columns)
 	{
+		TRACE_EXPORT(alvar_calibrate_camera);
+
 		if(camID >= cams.size())
 			return false;
 
@@ -404,6 +979,8 @@ extern "C"
 
 	__declspec(dllexport) bool alvar_finalize_calibration(int camID, char* calibrationFilename)
 	{
+		TRACE_EXPORT(alvar_finalize_calibration);
+
 		if(!calibration_started || (camID >= cams.size()))
 			return false;
 
@@ -0,0 +1,293 @@
+/************************************************************************************ 
+ * Copyright (c) 2008-2012, Columbia University
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the Columbia University nor the
+ *       names of its contributors may be used to endorse or promote products
+ *       derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY COLUMBIA UNIVERSITY ''AS IS'' AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL <copyright holder> BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * 
+ * 
+ * ===================================================================================
+ * Authors: Ohan Oda (ohan@cs.columbia.edu) 
+ * 
+ *************************************************************************************/
+
+#include <math.h>
+#include <string.h>
+#include <vector>
+#include <map>
+#include "MarkerDetector.h"
+
+// A set of markers that do not move relative to each other, such as markers fixed to the walls
+// of a room. Instead of fitting a pose to every visible marker, the camera pose in the field's
+// world frame is solved once per frame from the corners of all visible field markers. Markers
+// are either added with a known world pose, or learned: a marker that is seen while the camera
+// pose is known gets its world pose averaged over 'learnFrames' frames before it joins the
+// solve. A learned marker keeps being refined after that with a running average over at most
+// REFINE_WINDOW times 'learnFrames' frames, so that early errors wash out without single frames
+// moving it much. Markers added with a known pose are never refined. If learning is on and the
+// field is empty, the first marker seen becomes the origin.
+// Poses are OpenGL-style column-major 4x4 matrices.
+class MarkerField
+{
+public:
+
+	MarkerField()
+	{
+		enabled = false;
+		learnFrames = 0;
+		found = false;
+	}
+
+	void configure(bool _enabled, int _learnFrames)
+	{
+		enabled = _enabled;
+		learnFrames = (_learnFrames < 0) ? 0 : _learnFrames;
+		found = false;
+	}
+
+	// Adds a marker whose pose in the world frame is known and never refined
+	void addMarker(int id, const double* worldPose)
+	{
+		FieldMarker& marker = markers[id];
+		memcpy(marker.pose, worldPose, sizeof(double) * 16);
+		marker.fixed = true;
+	}
+
+	// Returns whether the marker is part of the camera pose solve
+	bool isEstablished(int id)
+	{
+		std::map<int, FieldMarker>::const_iterator it = markers.find(id);
+		return it != markers.end() && isEstablished(it->second);
+	}
+
+	// Writes the world pose of an established marker
+	bool getMarkerWorldPose(int id, double* mat)
+	{
+		std::map<int, FieldMarker>::const_iterator it = markers.find(id);
+		if(it == markers.end() || !isEstablished(it->second))
+			return false;
+
+		memcpy(mat, it->second.pose, sizeof(double) * 16);
+		return true;
+	}
+
+	// Writes the camera space pose of an established marker in the current frame
+	bool getMarkerPose(int id, double* mat)
+	{
+		std::map<int, FieldMarker>::const_iterator it = markers.find(id);
+		if(!found || it == markers.end() || !isEstablished(it->second))
+			return false;
+
+		multiply(worldPose, it->second.pose, mat);
+		return true;
+	}
+
+	// Solves the camera pose from the detected markers that belong to the field, then refines the
+	// learned markers. Returns the number of field markers used.
+	int solve(std::vector<alvar::MarkerData>* detected, alvar::Camera* cam)
+	{
+		found = false;
+		if(learnFrames > 0 && markers.empty() && detected->size() > 0)
+		{
+			double origin[16] = { 1, 0, 0, 0,  0, 1, 0, 0,  0, 0, 1, 0,  0, 0, 0, 1 };
+			addMarker((*detected)[0].GetId(), origin);
+		}
+
+		worldPoints.clear();
+		imagePoints.clear();
+		int used = 0;
+		for(size_t i = 0; i < detected->size(); ++i)
+		{
+			alvar::MarkerData& marker = (*detected)[i];
+			std::map<int, FieldMarker>::const_iterator it = markers.find(marker.GetId());
+			if(it == markers.end() || !isEstablished(it->second))
+				continue;
+
+			addCorners(marker, it->second.pose, worldPoints, imagePoints);
+			used++;
+		}
+
+		if(used == 0)
+			return 0;
+
+		cam->CalcExteriorOrientation(worldPoints, imagePoints, &pose);
+		pose.GetMatrixGL(worldPose);
+		invert(worldPose, cameraPose);
+		found = true;
+
+		if(learnFrames > 0)
+			learn(detected, cam);
+
+		return used;
+	}
+
+	bool enabled;
+	int learnFrames;
+
+	// Whether the camera pose was solved in the current frame, the pose of the world frame in
+	// camera space, and the camera pose in the world frame
+	bool found;
+	double worldPose[16];
+	double cameraPose[16];
+
+private:
+
+	struct FieldMarker
+	{
+		FieldMarker() : samples(0), fixed(false) 
+		{
+			memset(pose, 0, sizeof(double) * 16);
+		}
+
+		double pose[16];
+		int samples;
+		bool fixed;
+	};
+
+	// The running average of a learned marker covers at most this many times 'learnFrames' frames
+	enum { REFINE_WINDOW = 4 };
+
+	bool isEstablished(const FieldMarker& marker)
+	{
+		return marker.fixed || (learnFrames > 0 && marker.samples >= learnFrames);
+	}
+
+	// Fits a pose to each visible learned marker, moves it into the world frame with the camera
+	// pose of this frame, and adds it to the marker's running average. Once the average covers
+	// the whole window, new samples keep a constant weight.
+	void learn(std::vector<alvar::MarkerData>* detected, alvar::Camera* cam)
+	{
+		double identity[16] = { 1, 0, 0, 0,  0, 1, 0, 0,  0, 0, 1, 0,  0, 0, 0, 1 };
+		for(size_t i = 0; i < detected->size(); ++i)
+		{
+			alvar::MarkerData& marker = (*detected)[i];
+			FieldMarker& fieldMarker = markers[marker.GetId()];
+			if(fieldMarker.fixed)
+				continue;
+
+			markerPoints.clear();
+			markerImagePoints.clear();
+			addCorners(marker, identity, markerPoints, markerImagePoints);
+			cam->CalcExteriorOrientation(markerPoints, markerImagePoints, &markerPose);
+
+			double inCamera[16], inWorld[16];
+			markerPose.GetMatrixGL(inCamera);
+			multiply(cameraPose, inCamera, inWorld);
+
+			if(fieldMarker.samples < REFINE_WINDOW * learnFrames)
+				fieldMarker.samples++;
+			double weight = 1.0 / fieldMarker.samples;
+			for(int k = 0; k < 16; ++k)
+				fieldMarker.pose[k] += (inWorld[k] - fieldMarker.pose[k]) * weight;
+			orthonormalize(fieldMarker.pose);
+		}
+	}
+
+	// Appends the corners of a detected marker, placed in the world frame by 'markerPose', and
+	// their image positions
+	static void addCorners(alvar::MarkerData& marker, const double* markerPose, 
+		std::vector<CvPoint3D64f>& world, std::vector<CvPoint2D64f>& image)
+	{
+		size_t n = marker.marker_corners.size();
+		if(marker.marker_corners_img.size() < n)
+			n = marker.marker_corners_img.size();
+
+		for(size_t k = 0; k < n; ++k)
+		{
+			double x = marker.marker_corners[k].x;
+			double y = marker.marker_corners[k].y;
+
+			CvPoint3D64f w;
+			w.x = markerPose[0] * x + markerPose[4] * y + markerPose[12];
+			w.y = markerPose[1] * x + markerPose[5] * y + markerPose[13];
+			w.z = markerPose[2] * x + markerPose[6] * y + markerPose[14];
+			world.push_back(w);
+
+			CvPoint2D64f p;
+			p.x = marker.marker_corners_img[k].x;
+			p.y = marker.marker_corners_img[k].y;
+			image.push_back(p);
+		}
+	}
+
+	// out = a * b
+	static void multiply(const double* a, const double* b, double* out)
+	{
+		for(int c = 0; c < 4; ++c)
+			for(int r = 0; r < 4; ++r)
+				out[c * 4 + r] = a[r] * b[c * 4] + a[4 + r] * b[c * 4 + 1] + 
+					a[8 + r] * b[c * 4 + 2] + a[12 + r] * b[c * 4 + 3];
+	}
+
+	// Inverts a rigid transform: [R^T | -R^T t]
+	static void invert(const double* pose, double* out)
+	{
+		for(int c = 0; c < 3; ++c)
+		{
+			for(int r = 0; r < 3; ++r)
+				out[c * 4 + r] = pose[r * 4 + c];
+			out[c * 4 + 3] = 0;
+		}
+		for(int r = 0; r < 3; ++r)
+			out[12 + r] = -(pose[r * 4] * pose[12] + pose[r * 4 + 1] * pose[13] + pose[r * 4 + 2] * pose[14]);
+		out[15] = 1;
+	}
+
+	// Turns the averaged rotation part back into a rotation with Gram-Schmidt
+	static void orthonormalize(double* pose)
+	{
+		double* x = pose;
+		double* y = pose + 4;
+		double* z = pose + 8;
+
+		normalize(x);
+		double d = x[0] * y[0] + x[1] * y[1] + x[2] * y[2];
+		for(int k = 0; k < 3; ++k)
+			y[k] -= d * x[k];
+		normalize(y);
+
+		z[0] = x[1] * y[2] - x[2] * y[1];
+		z[1] = x[2] * y[0] - x[0] * y[2];
+		z[2] = x[0] * y[1] - x[1] * y[0];
+
+		pose[3] = pose[7] = pose[11] = 0;
+		pose[15] = 1;
+	}
+
+	static void normalize(double* v)
+	{
+		double length = sqrt(v[0] * v[0] + v[1] * v[1] + v[2] * v[2]);
+		if(length > 0)
+			for(int k = 0; k < 3; ++k)
+				v[k] /= length;
+	}
+
+	std::map<int, FieldMarker> markers;
+
+	// Scratch buffers reused across frames
+	std::vector<CvPoint3D64f> worldPoints;
+	std::vector<CvPoint2D64f> imagePoints;
+	std::vector<CvPoint3D64f> markerPoints;
+	std::vector<CvPoint2D64f> markerImagePoints;
+	alvar::Pose pose;
+	alvar::Pose markerPose;
+};
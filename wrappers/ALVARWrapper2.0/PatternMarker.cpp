@@ -0,0 +1,329 @@
+/************************************************************************************ 
+ * Copyright (c) 2008-2012, Columbia University
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the Columbia University nor the
+ *       names of its contributors may be used to endorse or promote products
+ *       derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY COLUMBIA UNIVERSITY ''AS IS'' AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL <copyright holder> BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * 
+ * 
+ * ===================================================================================
+ * Authors: Ohan Oda (ohan@cs.columbia.edu) 
+ * 
+ *************************************************************************************/
+
+#include <stdio.h>
+#include <math.h>
+#include <string.h>
+#include <vector>
+#include <emmintrin.h>
+#include "MarkerDetector.h"
+
+// Resolution of an ARToolKit pattern in pixels along each side
+#define PATTERN_RES 16
+#define PATTERN_SIZE (PATTERN_RES * PATTERN_RES)
+
+// The ARToolKit pattern markers known to a detector. Every pattern is stored at all four
+// orientations, each zero-mean and unit length, back to back in a single array so that a
+// candidate is compared against the whole library with a run of SIMD dot products. A 64 bit
+// hash of the coarse layout of each template lets most of the comparisons be skipped.
+class PatternBank
+{
+public:
+
+	PatternBank(double _minScore, int _maxHashDistance)
+	{
+		minScore = _minScore;
+		maxHashDistance = _maxHashDistance;
+	}
+
+	int size()
+	{
+		return hashes.size() / 4;
+	}
+
+	// Loads an ARToolKit .patt file, and returns the ID of the pattern or -1 if it could not
+	// be read. Only the first of the four orientations in the file is used, and its three
+	// color channels are averaged.
+	int load(const char* filename)
+	{
+		FILE* file = fopen(filename, "r");
+		if(file == NULL)
+			return -1;
+
+		float gray[PATTERN_SIZE];
+		memset(gray, 0, sizeof(gray));
+		bool valid = true;
+		for(int c = 0; c < 3 && valid; ++c)
+		{
+			for(int i = 0; i < PATTERN_SIZE; ++i)
+			{
+				int value;
+				if(fscanf(file, "%d", &value) != 1)
+				{
+					valid = false;
+					break;
+				}
+				gray[i] += value / 3.0f;
+			}
+		}
+		fclose(file);
+
+		if(!valid)
+			return -1;
+
+		float rotated[PATTERN_SIZE];
+		for(int orientation = 0; orientation < 4; ++orientation)
+		{
+			rotate(gray, orientation, rotated);
+			if(!normalize(rotated))
+				return -1;
+			templates.insert(templates.end(), rotated, rotated + PATTERN_SIZE);
+			hashes.push_back(hash(rotated));
+		}
+
+		return size() - 1;
+	}
+
+	// Finds the pattern and orientation that best match the sampled content of a candidate,
+	// and returns false if none of them scores at least the minimum score
+	bool match(const CvMat* content, int* id, int* orientation)
+	{
+		if(hashes.empty() || content->rows != PATTERN_RES || content->cols != PATTERN_RES)
+			return false;
+
+		__declspec(align(16)) float candidate[PATTERN_SIZE];
+		for(int y = 0; y < PATTERN_RES; ++y)
+		{
+			const unsigned char* row = content->data.ptr + y * content->step;
+			for(int x = 0; x < PATTERN_RES; ++x)
+				candidate[y * PATTERN_RES + x] = row[x];
+		}
+		if(!normalize(candidate))
+			return false;
+
+		unsigned long long candidateHash = hash(candidate);
+
+		float bestScore = (float)minScore;
+		int best = -1;
+		for(size_t t = 0; t < hashes.size(); ++t)
+		{
+			if(maxHashDistance >= 0 && hashDistance(candidateHash, hashes[t]) > maxHashDistance)
+				continue;
+
+			float score = dot(candidate, &templates[t * PATTERN_SIZE]);
+			if(score > bestScore)
+			{
+				bestScore = score;
+				best = t;
+			}
+		}
+
+		if(best < 0)
+			return false;
+
+		*id = best / 4;
+		*orientation = best % 4;
+		return true;
+	}
+
+private:
+
+	// Turns 'src' by 'orientation' quarter turns clockwise
+	static void rotate(const float* src, int orientation, float* dst)
+	{
+		for(int y = 0; y < PATTERN_RES; ++y)
+		{
+			for(int x = 0; x < PATTERN_RES; ++x)
+			{
+				int sx = x, sy = y;
+				for(int r = 0; r < orientation; ++r)
+				{
+					int tmp = sx;
+					sx = sy;
+					sy = PATTERN_RES - 1 - tmp;
+				}
+				dst[y * PATTERN_RES + x] = src[sy * PATTERN_RES + sx];
+			}
+		}
+	}
+
+	// Makes the pattern zero-mean and unit length, and returns false if it is flat
+	static bool normalize(float* pattern)
+	{
+		float mean = 0;
+		for(int i = 0; i < PATTERN_SIZE; ++i)
+			mean += pattern[i];
+		mean /= PATTERN_SIZE;
+
+		float length = 0;
+		for(int i = 0; i < PATTERN_SIZE; ++i)
+		{
+			pattern[i] -= mean;
+			length += pattern[i] * pattern[i];
+		}
+		if(length < 1e-6f)
+			return false;
+
+		float scale = 1.0f / sqrtf(length);
+		for(int i = 0; i < PATTERN_SIZE; ++i)
+			pattern[i] *= scale;
+		return true;
+	}
+
+	// One bit per 2x2 block of a normalized pattern, set if the block is brighter than the mean
+	static unsigned long long hash(const float* pattern)
+	{
+		unsigned long long bits = 0;
+		for(int y = 0; y < PATTERN_RES; y += 2)
+		{
+			for(int x = 0; x < PATTERN_RES; x += 2)
+			{
+				const float* p = pattern + y * PATTERN_RES + x;
+				bits <<= 1;
+				if(p[0] + p[1] + p[PATTERN_RES] + p[PATTERN_RES + 1] > 0)
+					bits |= 1;
+			}
+		}
+		return bits;
+	}
+
+	static int hashDistance(unsigned long long a, unsigned long long b)
+	{
+		unsigned long long v = a ^ b;
+		v = v - ((v >> 1) & 0x5555555555555555ULL);
+		v = (v & 0x3333333333333333ULL) + ((v >> 2) & 0x3333333333333333ULL);
+		v = (v + (v >> 4)) & 0x0F0F0F0F0F0F0F0FULL;
+		return (int)((v * 0x0101010101010101ULL) >> 56);
+	}
+
+	// Normalized cross-correlation of two normalized patterns
+	static float dot(const float* a, const float* b)
+	{
+		__m128 sum0 = _mm_setzero_ps();
+		__m128 sum1 = _mm_setzero_ps();
+		for(int i = 0; i < PATTERN_SIZE; i += 8)
+		{
+			sum0 = _mm_add_ps(sum0, _mm_mul_ps(_mm_load_ps(a + i), _mm_loadu_ps(b + i)));
+			sum1 = _mm_add_ps(sum1, _mm_mul_ps(_mm_load_ps(a + i + 4), _mm_loadu_ps(b + i + 4)));
+		}
+		sum0 = _mm_add_ps(sum0, sum1);
+		sum0 = _mm_add_ps(sum0, _mm_movehl_ps(sum0, sum0));
+		sum0 = _mm_add_ss(sum0, _mm_shuffle_ps(sum0, sum0, 1));
+		return _mm_cvtss_f32(sum0);
+	}
+
+	double minScore;
+	int maxHashDistance;
+	std::vector<float> templates;
+	std::vector<unsigned long long> hashes;
+};
+
+// A marker whose content is decoded by matching it against a PatternBank instead of reading
+// the bits of an ALVAR data marker. The rest of the detection, tracking and pose estimation is
+// left to MarkerData.
+//
+// ALVAR creates and deletes a marker for every candidate it examines, so the memory of deleted
+// markers is kept on a free list and handed to the next one instead of going back to the heap.
+// Detection runs on one thread at a time, so the list is not locked.
+class PatternMarker : public alvar::MarkerData
+{
+public:
+
+	PatternMarker(PatternBank* _bank, double _edge_length = 0, int _res = 0, double _margin = 0)
+		: alvar::MarkerData(_edge_length, _res, _margin)
+	{
+		bank = _bank;
+	}
+
+	static void* operator new(size_t size)
+	{
+		FreeBlock*& head = freeBlocks();
+		if(head == NULL || size != sizeof(PatternMarker))
+			return ::operator new(size);
+
+		void* p = head;
+		head = head->next;
+		return p;
+	}
+
+	static void operator delete(void* p, size_t size)
+	{
+		if(p == NULL)
+			return;
+		if(size != sizeof(PatternMarker))
+		{
+			::operator delete(p);
+			return;
+		}
+
+		FreeBlock* block = (FreeBlock*)p;
+		block->next = freeBlocks();
+		freeBlocks() = block;
+	}
+
+	bool DecodeContent(int* orientation)
+	{
+		int id;
+		if(!bank->match(marker_content, &id, orientation))
+			return false;
+
+		SetId(id);
+		decode_error = 0;
+		return true;
+	}
+
+private:
+
+	struct FreeBlock
+	{
+		FreeBlock* next;
+	};
+
+	// A function local static, since this file is also included by MarkerDetectorWrapper.cpp
+	static FreeBlock*& freeBlocks()
+	{
+		static FreeBlock* head = NULL;
+		return head;
+	}
+
+	PatternBank* bank;
+};
+
+// A detector that finds PatternMarkers. Found markers are stored as MarkerData, so the detector
+// can be used wherever an ALVAR data marker detector is.
+class PatternDetector : public alvar::MarkerDetector<alvar::MarkerData>
+{
+public:
+
+	PatternDetector(double minScore, int maxHashDistance) : bank(minScore, maxHashDistance)
+	{
+	}
+
+	PatternBank bank;
+
+protected:
+
+	alvar::Marker* new_M(double _edge_length = 0, int _res = 0, double _margin = 0)
+	{
+		return new PatternMarker(&bank, _edge_length, _res, _margin);
+	}
+};
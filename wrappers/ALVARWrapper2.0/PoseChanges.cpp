@@ -0,0 +1,164 @@
+/************************************************************************************ 
+ * Copyright (c) 2008-2012, Columbia University
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the Columbia University nor the
+ *       names of its contributors may be used to endorse or promote products
+ *       derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY COLUMBIA UNIVERSITY ''AS IS'' AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL <copyright holder> BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * 
+ * 
+ * ===================================================================================
+ * Authors: Ohan Oda (ohan@cs.columbia.edu) 
+ * 
+ *************************************************************************************/
+
+#include <math.h>
+#include <string.h>
+#include <map>
+
+// Types of visibility changes reported by PoseChangeTracker
+enum PoseChange
+{
+	POSE_APPEARED,
+	POSE_MOVED,
+	POSE_LOST
+};
+
+// Remembers the last reported pose of every marker (or marker bundle) seen by a detector, and
+// reports only the markers that appeared, were lost, or moved further than the thresholds since
+// their pose was last reported. Poses are OpenGL-style column-major 4x4 matrices.
+class PoseChangeTracker
+{
+public:
+
+	PoseChangeTracker()
+	{
+		translationThreshold = 0;
+		rotationThreshold = 0;
+		changeCount = 0;
+	}
+
+	// Starts a new frame. The changes are written to the given arrays, which must be large
+	// enough to hold one entry per tracked marker.
+	void begin(int* _ids, int* _changes, double* _poseMats)
+	{
+		ids = _ids;
+		changes = _changes;
+		poseMats = _poseMats;
+		changeCount = 0;
+
+		for(std::map<int, TrackedPose>::iterator it = states.begin(); it != states.end(); ++it)
+			it->second.seen = false;
+	}
+
+	void setVisible(int id, const double* pose)
+	{
+		TrackedPose& state = states[id];
+		if(state.seen)
+			return;
+		state.seen = true;
+
+		if(!state.visible)
+		{
+			state.visible = true;
+			report(id, POSE_APPEARED, pose, state);
+		}
+		else if(hasMoved(state.pose, pose))
+			report(id, POSE_MOVED, pose, state);
+	}
+
+	// Reports every marker that was visible but not seen in this frame as lost, and returns
+	// the number of changes written
+	int end()
+	{
+		for(std::map<int, TrackedPose>::iterator it = states.begin(); it != states.end(); ++it)
+		{
+			if(it->second.visible && !it->second.seen)
+			{
+				it->second.visible = false;
+				report(it->first, POSE_LOST, it->second.pose, it->second);
+			}
+		}
+
+		return changeCount;
+	}
+
+public:
+
+	// Minimum translation in marker size units, and minimum rotation in radians, for a visible
+	// marker to be reported as moved. With both set to 0, any change of the pose is reported.
+	double translationThreshold;
+	double rotationThreshold;
+
+private:
+
+	struct TrackedPose
+	{
+		TrackedPose() : visible(false), seen(false) {}
+
+		bool visible;
+		bool seen;
+		double pose[16];
+	};
+
+	bool hasMoved(const double* prev, const double* cur)
+	{
+		double dx = cur[12] - prev[12], dy = cur[13] - prev[13], dz = cur[14] - prev[14];
+		double t = translationThreshold;
+		if(dx * dx + dy * dy + dz * dz > t * t)
+			return true;
+
+		if(rotationThreshold <= 0)
+		{
+			for(int c = 0; c < 3; ++c)
+				for(int r = 0; r < 3; ++r)
+					if(prev[c * 4 + r] != cur[c * 4 + r])
+						return true;
+			return false;
+		}
+
+		// trace(prev^T * cur) = 1 + 2cos(angle) for the relative rotation
+		double trace = 0;
+		for(int c = 0; c < 3; ++c)
+			for(int r = 0; r < 3; ++r)
+				trace += prev[c * 4 + r] * cur[c * 4 + r];
+
+		return trace < 1 + 2 * cos(rotationThreshold);
+	}
+
+	void report(int id, PoseChange change, const double* pose, TrackedPose& state)
+	{
+		if(pose != state.pose)
+			memcpy(state.pose, pose, sizeof(double) * 16);
+
+		ids[changeCount] = id;
+		changes[changeCount] = change;
+		memcpy(poseMats + changeCount * 16, pose, sizeof(double) * 16);
+		changeCount++;
+	}
+
+	std::map<int, TrackedPose> states;
+
+	int* ids;
+	int* changes;
+	double* poseMats;
+	int changeCount;
+};
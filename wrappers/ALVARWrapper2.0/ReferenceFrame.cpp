@@ -0,0 +1,113 @@
+/************************************************************************************ 
+ * Copyright (c) 2008-2012, Columbia University
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the Columbia University nor the
+ *       names of its contributors may be used to endorse or promote products
+ *       derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY COLUMBIA UNIVERSITY ''AS IS'' AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL <copyright holder> BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * 
+ * 
+ * ===================================================================================
+ * Authors: Ohan Oda (ohan@cs.columbia.edu) 
+ * 
+ *************************************************************************************/
+
+#include <emmintrin.h>
+
+// A marker or multi-marker whose coordinate frame the poses of a detector are expressed in,
+// instead of the camera's. Poses are OpenGL-style column-major 4x4 rigid transforms.
+class ReferenceFrame
+{
+public:
+
+	ReferenceFrame()
+	{
+		camID = 0;
+		markerID = -1;
+		multiMarkerIndex = -1;
+		found = false;
+	}
+
+	bool isSet()
+	{
+		return markerID >= 0 || multiMarkerIndex >= 0;
+	}
+
+	// Stores the camera space pose of the reference found in the current frame
+	void setReferencePose(const double* pose)
+	{
+		// Camera pose in the reference frame: [R^T | -R^T t]
+		for(int c = 0; c < 3; ++c)
+		{
+			for(int r = 0; r < 3; ++r)
+				cameraPose[c * 4 + r] = pose[r * 4 + c];
+			cameraPose[c * 4 + 3] = 0;
+		}
+		for(int r = 0; r < 3; ++r)
+			cameraPose[12 + r] = -(pose[r * 4] * pose[12] + pose[r * 4 + 1] * pose[13] + pose[r * 4 + 2] * pose[14]);
+		cameraPose[15] = 1;
+
+		found = true;
+	}
+
+	// Re-expresses 'count' consecutive camera space poses in the reference frame in place
+	void transform(double* poseMats, int count)
+	{
+		__m128d cols[4][2];
+		for(int k = 0; k < 4; ++k)
+		{
+			cols[k][0] = _mm_loadu_pd(cameraPose + k * 4);
+			cols[k][1] = _mm_loadu_pd(cameraPose + k * 4 + 2);
+		}
+
+		for(int i = 0; i < count; ++i)
+		{
+			double* pose = poseMats + i * 16;
+
+			// Column j of the product only depends on column j of the pose
+			for(int j = 0; j < 4; ++j)
+			{
+				double* col = pose + j * 4;
+				__m128d lo = _mm_setzero_pd();
+				__m128d hi = _mm_setzero_pd();
+				for(int k = 0; k < 4; ++k)
+				{
+					__m128d s = _mm_set1_pd(col[k]);
+					lo = _mm_add_pd(lo, _mm_mul_pd(cols[k][0], s));
+					hi = _mm_add_pd(hi, _mm_mul_pd(cols[k][1], s));
+				}
+				_mm_storeu_pd(col, lo);
+				_mm_storeu_pd(col + 2, hi);
+			}
+		}
+	}
+
+public:
+
+	// Camera used to compute the pose of a multi-marker reference
+	int camID;
+	int markerID;
+	int multiMarkerIndex;
+
+	// Whether the reference was found in the current frame, and if so, the camera pose in it
+	bool found;
+	double cameraPose[16];
+};
@@ -0,0 +1,241 @@
+/************************************************************************************ 
+ * Copyright (c) 2008-2012, Columbia University
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the Columbia University nor the
+ *       names of its contributors may be used to endorse or promote products
+ *       derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY COLUMBIA UNIVERSITY ''AS IS'' AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL <copyright holder> BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * 
+ * 
+ * ===================================================================================
+ * Authors: Ohan Oda (ohan@cs.columbia.edu) 
+ * 
+ *************************************************************************************/
+
+#include <math.h>
+#include <omp.h>
+#include <string>
+#include <vector>
+#include <map>
+#include "MarkerDetector.h"
+
+// Runs marker detection on overlapping horizontal bands of a single frame in parallel. Each band
+// has its own MarkerDetector, so thresholding, candidate extraction, decoding and pose estimation
+// all run concurrently, and its own Camera whose principal point is shifted by the band offset so
+// that the poses come out in the full frame's camera coordinates.
+class TiledDetector
+{
+public:
+
+	TiledDetector(double _markerSize, int _markerRes, double _margin)
+	{
+		markerSize = _markerSize;
+		markerRes = _markerRes;
+		margin = _margin;
+
+		bandCount = 1;
+		overlap = 0;
+		camWidth = 0;
+		camHeight = 0;
+	}
+
+	~TiledDetector()
+	{
+		clearBands();
+	}
+
+	bool isEnabled()
+	{
+		return bandCount > 1;
+	}
+
+	void configure(int _bandCount, int _overlap)
+	{
+		clearBands();
+		bandCount = (_bandCount < 1) ? 1 : _bandCount;
+		overlap = (_overlap < 0) ? 0 : _overlap;
+	}
+
+	void setMarkerSizeForId(int id, double size)
+	{
+		sizeForId[id] = size;
+		for(size_t i = 0; i < detectors.size(); ++i)
+			detectors[i]->SetMarkerSizeForId(id, size);
+	}
+
+	// Detects markers in all bands and stores the merged result in the 'markers' of 'target', so
+	// that the rest of the wrapper can read it as if target->Detect(...) had been called. If
+	// 'updatePose' is false, only the corners of the markers are found.
+	void detect(alvar::MarkerDetector<alvar::MarkerData>* target, IplImage* image, const std::string& calibFile,
+		double maxMarkerError, double maxTrackError, bool updatePose)
+	{
+		setupBands(image->width, image->height, calibFile);
+
+		#pragma omp parallel for num_threads(bandCount) schedule(static, 1)
+		for(int b = 0; b < bandCount; ++b)
+		{
+			IplImage& band = bandImages[b];
+			band = *image;
+			band.height = bandEnd[b] - bandStart[b];
+			band.imageData = image->imageData + bandStart[b] * image->widthStep;
+			band.imageSize = band.height * band.widthStep;
+
+			detectors[b]->Detect(&band, cameras[b], true, false, maxMarkerError, maxTrackError, 
+				alvar::MarkerDetectorImpl::CVSEQ, updatePose);
+		}
+
+		mergeBands(target);
+	}
+
+private:
+
+	void clearBands()
+	{
+		for(size_t i = 0; i < detectors.size(); ++i)
+		{
+			delete detectors[i];
+			delete cameras[i];
+		}
+		detectors.clear();
+		cameras.clear();
+		camWidth = 0;
+		camHeight = 0;
+	}
+
+	void setupBands(int width, int height, const std::string& calibFile)
+	{
+		if(width == camWidth && height == camHeight && calibFile == camCalibFile && (int)detectors.size() == bandCount)
+			return;
+
+		clearBands();
+		camWidth = width;
+		camHeight = height;
+		camCalibFile = calibFile;
+
+		bandImages.resize(bandCount);
+		bandStart.resize(bandCount);
+		bandEnd.resize(bandCount);
+
+		// Each band is extended downwards by the overlap, so any marker that is at most 'overlap'
+		// pixels tall lies completely inside at least one band
+		int bandHeight = (height + bandCount - 1) / bandCount;
+		for(int b = 0; b < bandCount; ++b)
+		{
+			bandStart[b] = b * bandHeight;
+			bandEnd[b] = bandStart[b] + bandHeight + overlap;
+			if(bandEnd[b] > height)
+				bandEnd[b] = height;
+
+			alvar::Camera* cam = new alvar::Camera();
+			if(calibFile.empty() || !cam->SetCalib(calibFile.c_str(), width, height))
+				cam->SetRes(width, height);
+			cam->calib_K_data[1][2] -= bandStart[b];
+			cameras.push_back(cam);
+
+			alvar::MarkerDetector<alvar::MarkerData>* detector = new alvar::MarkerDetector<alvar::MarkerData>();
+			detector->SetMarkerSize(markerSize, markerRes, margin);
+			for(std::map<int, double>::const_iterator it = sizeForId.begin(); it != sizeForId.end(); ++it)
+				detector->SetMarkerSizeForId(it->first, it->second);
+			detectors.push_back(detector);
+		}
+	}
+
+	// Copies the markers found in every band into 'target' in band order, moving their image
+	// coordinates back into the full frame. A marker that lies in the overlap of two bands is
+	// found by both, so the second detection of the same ID at the same place is dropped.
+	void mergeBands(alvar::MarkerDetector<alvar::MarkerData>* target)
+	{
+		target->markers->clear();
+		centroids.clear();
+
+		for(int b = 0; b < bandCount; ++b)
+		{
+			double offset = bandStart[b];
+			for(size_t i = 0; i < detectors[b]->markers->size(); ++i)
+			{
+				const alvar::MarkerData& found = (*(detectors[b]->markers))[i];
+
+				double cx = 0, cy = 0, edge = 0;
+				int n = found.marker_corners_img.size();
+				for(int k = 0; k < n; ++k)
+				{
+					cx += found.marker_corners_img[k].x / n;
+					cy += (found.marker_corners_img[k].y + offset) / n;
+				}
+				if(n > 1)
+				{
+					double dx = found.marker_corners_img[1].x - found.marker_corners_img[0].x;
+					double dy = found.marker_corners_img[1].y - found.marker_corners_img[0].y;
+					edge = sqrt(dx * dx + dy * dy);
+				}
+
+				bool duplicate = false;
+				for(size_t j = 0; j < centroids.size() && !duplicate; ++j)
+				{
+					const MarkerCentroid& other = centroids[j];
+					double dx = other.x - cx, dy = other.y - cy;
+					double tolerance = 0.25 * ((edge > other.edge) ? edge : other.edge);
+					duplicate = (other.id == found.GetId()) && (dx * dx + dy * dy <= tolerance * tolerance);
+				}
+				if(duplicate)
+					continue;
+
+				MarkerCentroid centroid = {found.GetId(), cx, cy, edge};
+				centroids.push_back(centroid);
+
+				// Marker has no assignment operator of its own, so the copy constructor is the
+				// only safe way to copy one
+				target->markers->push_back(found);
+				alvar::MarkerData& marker = target->markers->back();
+				for(size_t k = 0; k < marker.marker_corners_img.size(); ++k)
+					marker.marker_corners_img[k].y += offset;
+				for(size_t k = 0; k < marker.marker_points_img.size(); ++k)
+					marker.marker_points_img[k].y += offset;
+			}
+		}
+	}
+
+	struct MarkerCentroid
+	{
+		int id;
+		double x;
+		double y;
+		double edge;
+	};
+
+	double markerSize;
+	int markerRes;
+	double margin;
+	std::map<int, double> sizeForId;
+
+	int bandCount;
+	int overlap;
+	int camWidth;
+	int camHeight;
+	std::string camCalibFile;
+
+	std::vector<alvar::MarkerDetector<alvar::MarkerData>*> detectors;
+	std::vector<alvar::Camera*> cameras;
+	std::vector<IplImage> bandImages;
+	std::vector<int> bandStart;
+	std::vector<int> bandEnd;
+	std::vector<MarkerCentroid> centroids;
+};
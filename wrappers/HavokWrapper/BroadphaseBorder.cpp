@@ -37,6 +37,8 @@
 #include <Physics/Dynamics/Entity/hkpRigidBody.h>
 #include <Physics/Dynamics/World/BroadPhaseBorder/hkpBroadPhaseBorder.h>
 
+#include "Tracepoints.cpp"
+
 typedef void (*leaveWorldCallback)(hkpRigidBody* body);
 
 class BroadphaseBorder : public hkpBroadPhaseBorder
@@ -55,6 +57,8 @@ public:
 	{
 		hkpRigidBody* body = static_cast<hkpRigidBody*>(entity);
 
+		TRACE_PROBE(leave_world_callback__start);
 		callback(body);
+		TRACE_PROBE(leave_world_callback__done);
 	}
 };
\ No newline at end of file
@@ -37,6 +37,8 @@
 #include <Physics/Dynamics/Collide/ContactListener/hkpContactListener.h>
 #include <Physics/Dynamics/Entity/hkpEntityListener.h>
 
+#include "Tracepoints.cpp"
+
 typedef void (*contactCallback)(hkpRigidBody* body1, hkpRigidBody* body2, float contactSpeed);
 typedef void (*collisionStarted)(hkpRigidBody* body1, hkpRigidBody* body2);
 typedef void (*collisionEnded)(hkpRigidBody* body1, hkpRigidBody* body2);
@@ -54,19 +56,31 @@ public:
 	void contactPointCallback( const hkpContactPointEvent& evt )
 	{
 		if(callback != NULL)
+		{
+			TRACE_PROBE(contact_callback__start);
 			callback(evt.getBody(0), evt.getBody(1), evt.getSeparatingVelocity());
+			TRACE_PROBE(contact_callback__done);
+		}
 	}
 
 	void collisionAddedCallback( const hkpCollisionEvent& evt )
 	{
 		if(startCallback != NULL)
+		{
+			TRACE_PROBE(collision_started_callback__start);
 			startCallback(evt.getBody(0), evt.getBody(1));
+			TRACE_PROBE(collision_started_callback__done);
+		}
 	}
 
 	void collisionRemovedCallback( const hkpCollisionEvent& evt )
 	{
 		if(endCallback != NULL)
+		{
+			TRACE_PROBE(collision_ended_callback__start);
 			endCallback(evt.getBody(0), evt.getBody(1));
+			TRACE_PROBE(collision_ended_callback__done);
+		}
 	}
 
 	void entityDeletedCallback(hkpEntity* entity)
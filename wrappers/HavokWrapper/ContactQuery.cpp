@@ -0,0 +1,87 @@
+/************************************************************************************ 
+ * Copyright (c) 2008-2012, Columbia University
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the Columbia University nor the
+ *       names of its contributors may be used to endorse or promote products
+ *       derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY COLUMBIA UNIVERSITY ''AS IS'' AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL <copyright holder> BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * 
+ * 
+ * ===================================================================================
+ * Author: Ohan Oda (ohan@cs.columbia.edu)
+ * 
+ *************************************************************************************/
+
+#include <stdlib.h>
+
+#include <Physics/Collide/Agent3/Machine/Nn/hkpAgentNnTrack.h>
+#include <Physics/Dynamics/Collide/hkpSimpleConstraintContactMgr.h>
+#include <Physics/Dynamics/Entity/hkpRigidBody.h>
+
+// Writes the rigid bodies currently touching 'body', along with the normal and penetration depth
+// of their deepest contact point, by walking the collision agents of the body once. The normal 
+// points from the partner toward 'body', and the depth is negative while the bodies are apart 
+// but within the collision tolerance. Returns the number of partners written, at most 'maxContacts'.
+static int getBodyContacts(hkpRigidBody* body, int maxContacts, hkpRigidBody** partners, float* normals, 
+	float* depths)
+{
+	hkpLinkedCollidable* collidable = body->getLinkedCollidable();
+	const hkArray<hkpLinkedCollidable::CollisionEntry>& entries = collidable->getCollisionEntriesNonDeterministic();
+
+	int count = 0;
+	for(int i = 0; i < entries.getSize() && count < maxContacts; ++i)
+	{
+		hkpAgentNnEntry* agent = entries[i].m_agentEntry;
+		if(agent->m_contactMgr->m_type != hkpContactMgr::TYPE_SIMPLE_CONSTRAINT_CONTACT_MGR)
+			continue;
+
+		hkpRigidBody* partner = hkpGetRigidBody(entries[i].m_partner);
+		if(partner == HK_NULL)
+			continue;
+
+		hkpSimpleConstraintContactMgr* mgr = static_cast<hkpSimpleConstraintContactMgr*>(agent->m_contactMgr);
+		int numPoints = mgr->m_contactConstraintData.getNumContactPoints();
+		if(numPoints == 0)
+			continue;
+
+		const hkContactPoint* deepest = &mgr->m_contactConstraintData.getContactPoint(0);
+		for(int j = 1; j < numPoints; ++j)
+		{
+			const hkContactPoint& point = mgr->m_contactConstraintData.getContactPoint(j);
+			if(point.getDistance() < deepest->getDistance())
+				deepest = &point;
+		}
+
+		// Contact normals point from the second collidable of the agent to the first
+		hkVector4 normal = deepest->getNormal();
+		if(agent->m_collidable[0] != collidable)
+			normal.setNeg4(normal);
+
+		partners[count] = partner;
+		normals[count * 3] = normal(0);
+		normals[count * 3 + 1] = normal(1);
+		normals[count * 3 + 2] = normal(2);
+		depths[count] = -deepest->getDistance();
+		count++;
+	}
+
+	return count;
+}
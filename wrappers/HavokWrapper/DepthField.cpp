@@ -0,0 +1,317 @@
+/************************************************************************************ 
+ * Copyright (c) 2008-2012, Columbia University
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the Columbia University nor the
+ *       names of its contributors may be used to endorse or promote products
+ *       derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY COLUMBIA UNIVERSITY ''AS IS'' AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL <copyright holder> BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * 
+ * 
+ * ===================================================================================
+ * Author: Ohan Oda (ohan@cs.columbia.edu)
+ * 
+ *************************************************************************************/
+
+#include <stdlib.h>
+#include <emmintrin.h>
+
+#include <Physics/Collide/Shape/Convex/Box/hkpBoxShape.h>
+
+#include <Physics/Dynamics/World/hkpWorld.h>
+#include <Physics/Dynamics/Entity/hkpRigidBody.h>
+
+#include "QuerySnapshot.cpp"
+
+// Number of box sizes used for the tiles, from the nearest to the farthest depth
+#define DEPTH_BANDS 8
+
+// Turns the frames of a depth camera into static boxes in the world, one per square tile of pixels,
+// so that virtual objects collide with the real scene. The front face of each box sits at the nearest
+// depth found in its tile. Each update only moves the boxes whose depth changed by more than a 
+// threshold, and at most a fixed number of them, so the cost per frame is bounded.
+class DepthField
+{
+public:
+
+	DepthField(hkpWorld* _world, QuerySnapshot* _snapshot, int width, int height, int _tileSize, const float* intrinsics, float _depthScale, 
+		int _depthShift, float nearDepth, float farDepth, float _thickness, float _threshold, int _maxUpdates)
+	{
+		world = _world;
+		snapshot = _snapshot;
+		imageWidth = width;
+		tileSize = _tileSize;
+		tilesX = width / tileSize;
+		tilesY = height / tileSize;
+		fx = intrinsics[0];
+		fy = intrinsics[1];
+		cx = intrinsics[2];
+		cy = intrinsics[3];
+		depthScale = _depthScale;
+		depthShift = _depthShift;
+		minDepth = nearDepth;
+		maxDepth = farDepth;
+		thickness = _thickness;
+		threshold = _threshold;
+		maxUpdates = _maxUpdates;
+		cursor = 0;
+		cameraTransform.setIdentity();
+
+		// Boxes are as wide as a tile at the far end of their band, so neighbors never leave gaps
+		for(int i = 0; i < DEPTH_BANDS; ++i)
+		{
+			float z = minDepth + (maxDepth - minDepth) * (i + 1) / DEPTH_BANDS;
+			hkVector4 halfExtents(tileSize * z / fx * 0.5f, tileSize * z / fy * 0.5f, thickness * 0.5f);
+			bandShapes[i] = new hkpBoxShape(halfExtents, 0);
+		}
+
+		int numTiles = tilesX * tilesY;
+		tiles.setSize(numTiles);
+		tileDepths.setSize(numTiles + 4);
+		updates.reserve(maxUpdates + 4);
+		points.setSize((maxUpdates + 4) * 3);
+		for(int i = 0; i < numTiles; ++i)
+		{
+			hkpRigidBodyCinfo info;
+			info.m_shape = bandShapes[0];
+			info.m_motionType = hkpMotion::MOTION_FIXED;
+
+			tiles[i].body = new hkpRigidBody(info);
+			tiles[i].depth = 0;
+			tiles[i].band = 0;
+		}
+	}
+
+	// Queries may still read the boxes from the last published snapshot, so the bodies, including the
+	// ones already taken out of the world, and the shapes are retired rather than released
+	~DepthField()
+	{
+		world->lock();
+		for(int i = 0; i < tiles.getSize(); ++i)
+		{
+			snapshot->retire(tiles[i].body);
+			if(tiles[i].body->getWorld() != HK_NULL)
+				world->removeEntity(tiles[i].body);
+			tiles[i].body->removeReference();
+		}
+		world->unlock();
+
+		for(int i = 0; i < DEPTH_BANDS; ++i)
+		{
+			snapshot->retire(bandShapes[i]);
+			bandShapes[i]->removeReference();
+		}
+	}
+
+	// Updates the boxes from a depth frame of 16 bit pixels. 'transform' is the column-major camera to
+	// world transform, where the camera looks down -Z with +Y up.
+	void update(const unsigned short* depth, const float* transform)
+	{
+		hkTransform newTransform;
+		newTransform.set4x4ColumnMajor(transform);
+		bool cameraMoved = !newTransform.isApproximatelyEqual(cameraTransform, 1e-4f);
+		cameraTransform = newTransform;
+
+		computeTileDepths(depth);
+
+		// Picks the changed tiles round robin so that every tile is eventually updated
+		updates.clear();
+		int numTiles = tiles.getSize();
+		for(int n = 0; n < numTiles && updates.getSize() < maxUpdates; ++n)
+		{
+			int i = (cursor + n) % numTiles;
+			float z = tileDepths[i];
+			float prev = tiles[i].depth;
+			bool changed = (z == 0) != (prev == 0) || hkMath::fabs(z - prev) > threshold;
+			if(changed || (cameraMoved && z != 0))
+				updates.pushBack(i);
+		}
+		if(updates.getSize() > 0)
+			cursor = (updates.back() + 1) % numTiles;
+
+		backProject();
+
+		world->lock();
+		for(int n = 0; n < updates.getSize(); ++n)
+			applyTile(updates[n], &points[n * 3]);
+		world->unlock();
+	}
+
+private:
+
+	struct Tile
+	{
+		hkpRigidBody* body;
+		float depth;
+		int band;
+	};
+
+	// Finds the nearest valid depth of every tile in meters, or 0 if the tile has no valid pixel.
+	// SSE2 only has a signed 16 bit min, so the depths are offset by 0x8000 around it to compare
+	// them as unsigned. Pixels of 0 are replaced by 0xFFFF, which marks a tile without data.
+	void computeTileDepths(const unsigned short* depth)
+	{
+		__m128i invalid = _mm_set1_epi16((short)0xFFFF);
+		__m128i bias = _mm_set1_epi16((short)0x8000);
+		__m128i zero = _mm_setzero_si128();
+
+		for(int ty = 0; ty < tilesY; ++ty)
+		{
+			for(int tx = 0; tx < tilesX; ++tx)
+			{
+				int nearest = 0xFFFF;
+				for(int y = 0; y < tileSize; ++y)
+				{
+					const unsigned short* row = depth + (ty * tileSize + y) * imageWidth + tx * tileSize;
+					int x = 0;
+					__m128i minv = _mm_xor_si128(invalid, bias);
+					for(; x + 8 <= tileSize; x += 8)
+					{
+						__m128i v = _mm_srli_epi16(_mm_loadu_si128((const __m128i*)(row + x)), depthShift);
+						v = _mm_or_si128(v, _mm_and_si128(_mm_cmpeq_epi16(v, zero), invalid));
+						minv = _mm_min_epi16(minv, _mm_xor_si128(v, bias));
+					}
+					minv = _mm_min_epi16(minv, _mm_srli_si128(minv, 8));
+					minv = _mm_min_epi16(minv, _mm_srli_si128(minv, 4));
+					minv = _mm_min_epi16(minv, _mm_srli_si128(minv, 2));
+					int m = _mm_extract_epi16(minv, 0) ^ 0x8000;
+					for(; x < tileSize; ++x)
+					{
+						int d = row[x] >> depthShift;
+						if(d != 0 && d < m)
+							m = d;
+					}
+					if(m < nearest)
+						nearest = m;
+				}
+
+				float z = nearest * depthScale;
+				tileDepths[ty * tilesX + tx] = (nearest == 0xFFFF || z < minDepth || z > maxDepth) ? 0 : z;
+			}
+		}
+	}
+
+	// Computes the camera space centers of the boxes of the tiles to update, four at a time
+	void backProject()
+	{
+		int count = updates.getSize();
+		for(int n = count; n < ((count + 3) & ~3); ++n)
+			updates.pushBackUnchecked(updates[0]);
+
+		__m128 half = _mm_set1_ps(thickness * 0.5f);
+		__m128 invFx = _mm_set1_ps(1.0f / fx);
+		__m128 invFy = _mm_set1_ps(1.0f / fy);
+		__m128 ccx = _mm_set1_ps(cx);
+		__m128 ccy = _mm_set1_ps(cy);
+		__m128 halfTile = _mm_set1_ps(tileSize * 0.5f);
+
+		HK_ALIGN16(float u[4]);
+		HK_ALIGN16(float v[4]);
+		HK_ALIGN16(float z[4]);
+		HK_ALIGN16(float out[12]);
+		for(int n = 0; n < count; n += 4)
+		{
+			for(int k = 0; k < 4; ++k)
+			{
+				int i = updates[n + k];
+				u[k] = (float)((i % tilesX) * tileSize);
+				v[k] = (float)((i / tilesX) * tileSize);
+				z[k] = tileDepths[i];
+			}
+
+			// The box center is pushed half its thickness behind the surface
+			__m128 depthv = _mm_add_ps(_mm_load_ps(z), half);
+			__m128 x = _mm_mul_ps(_mm_mul_ps(_mm_sub_ps(_mm_add_ps(_mm_load_ps(u), halfTile), ccx), invFx), depthv);
+			__m128 y = _mm_mul_ps(_mm_mul_ps(_mm_sub_ps(_mm_add_ps(_mm_load_ps(v), halfTile), ccy), invFy), depthv);
+			_mm_store_ps(out, x);
+			_mm_store_ps(out + 4, y);
+			_mm_store_ps(out + 8, depthv);
+
+			for(int k = 0; k < 4 && n + k < count; ++k)
+			{
+				float* p = &points[(n + k) * 3];
+				p[0] = out[k];
+				p[1] = -out[4 + k];
+				p[2] = -out[8 + k];
+			}
+		}
+
+		updates.setSize(count);
+	}
+
+	void applyTile(int index, const float* point)
+	{
+		Tile& tile = tiles[index];
+		float z = tileDepths[index];
+		tile.depth = z;
+
+		if(z == 0)
+		{
+			if(tile.body->getWorld() != HK_NULL)
+				world->removeEntity(tile.body);
+			return;
+		}
+
+		int band = (int)((z - minDepth) / (maxDepth - minDepth) * DEPTH_BANDS);
+		if(band >= DEPTH_BANDS)
+			band = DEPTH_BANDS - 1;
+		if(band != tile.band)
+		{
+			tile.body->setShape(bandShapes[band]);
+			tile.band = band;
+		}
+
+		hkTransform local;
+		local.setIdentity();
+		local.getTranslation().set(point[0], point[1], point[2]);
+		hkTransform transform;
+		transform.setMul(cameraTransform, local);
+		tile.body->setTransform(transform);
+
+		if(tile.body->getWorld() == HK_NULL)
+			world->addEntity(tile.body);
+	}
+
+	hkpWorld* world;
+	QuerySnapshot* snapshot;
+
+	int imageWidth;
+	int tileSize;
+	int tilesX;
+	int tilesY;
+	float fx, fy, cx, cy;
+	float depthScale;
+	int depthShift;
+	float minDepth;
+	float maxDepth;
+	float thickness;
+	float threshold;
+	int maxUpdates;
+	int cursor;
+
+	hkTransform cameraTransform;
+	hkpBoxShape* bandShapes[DEPTH_BANDS];
+
+	hkArray<Tile> tiles;
+	hkArray<float> tileDepths;
+	hkArray<int> updates;
+	// Camera space box centers of the tiles being updated, 3 floats each
+	hkArray<float> points;
+};
@@ -0,0 +1,212 @@
+/************************************************************************************ 
+ * Copyright (c) 2008-2012, Columbia University
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the Columbia University nor the
+ *       names of its contributors may be used to endorse or promote products
+ *       derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY COLUMBIA UNIVERSITY ''AS IS'' AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL <copyright holder> BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * 
+ * 
+ * ===================================================================================
+ * Author: Ohan Oda (ohan@cs.columbia.edu)
+ * 
+ *************************************************************************************/
+
+#include <stdlib.h>
+
+#include <Physics/Collide/Shape/Compound/Collection/List/hkpListShape.h>
+#include <Physics/Collide/Shape/Misc/Transform/hkpTransformShape.h>
+#include <Physics/Utilities/Dynamics/Inertia/hkpInertiaTensorComputer.h>
+
+#include <Physics/Dynamics/World/hkpWorld.h>
+#include <Physics/Dynamics/Entity/hkpRigidBody.h>
+#include <Physics/Dynamics/Collide/ContactListener/hkpContactListener.h>
+
+#include "Tracepoints.cpp"
+
+typedef void (*destructibleBreakCallback)(hkpRigidBody* body);
+
+// A pre-fractured object that is simulated as one compound body until a contact hits it harder
+// than the break threshold, and is then replaced by its fragment bodies. The fragment bodies are
+// created up front and kept out of the world, so breaking the object does not allocate. The object
+// keeps a reference to all of its bodies until it is deleted.
+class Destructible : public hkpContactListener
+{
+public:
+
+	// Builds the intact body from the fragment shapes placed at their local transforms, and a pooled
+	// body for each fragment sharing the same shape. 'pendingBreaks' collects the objects to break
+	// once the current simulation step is done. There has to be at least one fragment.
+	Destructible(int numFragments, hkpShape** shapes, const hkTransform* localTransforms, float* masses,
+		const hkTransform& transform, float friction, float restitution, float _breakThreshold, 
+		destructibleBreakCallback _callback, hkArray<Destructible*>* _pendingBreaks)
+	{
+		breakThreshold = _breakThreshold;
+		callback = _callback;
+		pendingBreaks = _pendingBreaks;
+		broken = false;
+
+		hkArray<hkpShape*> children;
+		float totalMass = 0;
+		for(int i = 0; i < numFragments; ++i)
+		{
+			children.pushBack(new hkpTransformShape(shapes[i], localTransforms[i]));
+			totalMass += masses[i];
+		}
+
+		hkpListShape* compound = new hkpListShape(&children[0], children.getSize());
+		for(int i = 0; i < children.getSize(); ++i)
+			children[i]->removeReference();
+
+		intact = createBody(compound, totalMass, transform, friction, restitution);
+		compound->removeReference();
+		intact->addContactListener(this);
+
+		for(int i = 0; i < numFragments; ++i)
+		{
+			fragments.pushBack(createBody(shapes[i], masses[i], localTransforms[i], friction, restitution));
+			shapes[i]->removeReference();
+		}
+	}
+
+	// The bodies must have been removed from the world
+	~Destructible()
+	{
+		intact->removeContactListener(this);
+		intact->removeReference();
+		for(int i = 0; i < fragments.getSize(); ++i)
+			fragments[i]->removeReference();
+	}
+
+	void contactPointCallback( const hkpContactPointEvent& evt )
+	{
+		if(broken || -evt.getSeparatingVelocity() < breakThreshold)
+			return;
+
+		// The world can not be modified during the simulation step
+		broken = true;
+		pendingBreaks->pushBack(this);
+	}
+
+	// Replaces the intact body with the fragment bodies, which inherit its velocity at their
+	// centers of mass
+	void shatter(hkpWorld* world)
+	{
+		const hkTransform& transform = intact->getTransform();
+		hkVector4 angularVelocity = intact->getAngularVelocity();
+
+		for(int i = 0; i < fragments.getSize(); ++i)
+		{
+			hkpRigidBody* fragment = static_cast<hkpRigidBody*>(fragments[i]);
+
+			hkTransform fragmentTransform;
+			fragmentTransform.setMul(transform, fragment->getTransform());
+			fragment->setTransform(fragmentTransform);
+
+			hkVector4 velocity;
+			intact->getPointVelocity(fragment->getCenterOfMassInWorld(), velocity);
+			fragment->setLinearVelocity(velocity);
+			fragment->setAngularVelocity(angularVelocity);
+		}
+
+		world->removeEntity(intact);
+		if(fragments.getSize() > 0)
+			world->addEntityBatch(fragments.begin(), fragments.getSize());
+
+		if(callback != NULL)
+		{
+			TRACE_PROBE(break_callback__start);
+			callback(intact);
+			TRACE_PROBE(break_callback__done);
+		}
+	}
+
+	void getFragments(hkpRigidBody** bodies)
+	{
+		for(int i = 0; i < fragments.getSize(); ++i)
+			bodies[i] = static_cast<hkpRigidBody*>(fragments[i]);
+	}
+
+	int getFragmentCount()
+	{
+		return fragments.getSize();
+	}
+
+	hkpRigidBody* getFragment(int index)
+	{
+		return static_cast<hkpRigidBody*>(fragments[index]);
+	}
+
+	bool hasFragment(hkpRigidBody* body)
+	{
+		return fragments.indexOf(body) >= 0;
+	}
+
+	// Releases a fragment that was removed from the world, or that should not be added when the
+	// object breaks
+	void removeFragment(hkpRigidBody* body)
+	{
+		int index = fragments.indexOf(body);
+		if(index < 0)
+			return;
+
+		fragments.removeAtAndCopy(index);
+		body->removeReference();
+	}
+
+public:
+
+	// Kept referenced by the object so that it stays valid after it is removed from the world
+	hkpRigidBody* intact;
+
+private:
+
+	static hkpRigidBody* createBody(const hkpShape* shape, float mass, const hkTransform& transform,
+		float friction, float restitution)
+	{
+		hkpRigidBodyCinfo bodyInfo;
+		bodyInfo.m_shape = shape;
+		bodyInfo.m_motionType = hkpMotion::MOTION_DYNAMIC;
+		bodyInfo.m_position = transform.getTranslation();
+		bodyInfo.m_rotation.set(transform.getRotation());
+
+		if(friction >= 0)
+			bodyInfo.m_friction = friction;
+		if(restitution >= 0)
+			bodyInfo.m_restitution = restitution;
+
+		hkpMassProperties massProperties;
+		hkpInertiaTensorComputer::computeShapeVolumeMassProperties(shape, mass, massProperties);
+		bodyInfo.m_mass = massProperties.m_mass;
+		bodyInfo.m_centerOfMass = massProperties.m_centerOfMass;
+		bodyInfo.m_inertiaTensor = massProperties.m_inertiaTensor;
+
+		return new hkpRigidBody(bodyInfo);
+	}
+
+	float breakThreshold;
+	destructibleBreakCallback callback;
+	hkArray<Destructible*>* pendingBreaks;
+	bool broken;
+
+	// Fragment transforms are kept relative to the intact body until the object breaks
+	hkArray<hkpEntity*> fragments;
+};
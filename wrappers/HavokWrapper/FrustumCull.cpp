@@ -0,0 +1,173 @@
+/************************************************************************************ 
+ * Copyright (c) 2008-2012, Columbia University
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the Columbia University nor the
+ *       names of its contributors may be used to endorse or promote products
+ *       derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY COLUMBIA UNIVERSITY ''AS IS'' AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL <copyright holder> BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * 
+ * 
+ * ===================================================================================
+ * Author: Ohan Oda (ohan@cs.columbia.edu)
+ * 
+ *************************************************************************************/
+
+#include <stdlib.h>
+#include <xmmintrin.h>
+
+#include <Physics/Collide/Dispatch/BroadPhase/hkpTypedBroadPhaseHandle.h>
+#include <Physics/Internal/Collide/BroadPhase/hkpBroadPhase.h>
+#include <Physics/Internal/Collide/BroadPhase/hkpBroadPhaseHandlePair.h>
+
+#include <Physics/Dynamics/World/hkpWorld.h>
+#include <Physics/Dynamics/Entity/hkpRigidBody.h>
+
+// The maximum number of view frusta tested in one query, which is the number of bits in a mask
+#define MAX_FRUSTA 32
+
+// Finds the bodies whose broadphase AABBs intersect one or more view frusta. The broadphase is
+// queried once with the box bounding all of the frusta, and the candidates are then tested against
+// the planes of each frustum four planes at a time.
+class FrustumCuller
+{
+public:
+
+	// 'planes' holds 6 planes (a, b, c, d) per frustum with the normals pointing out of the frustum,
+	// and 'corners' holds the 8 corners (x, y, z) of each frustum. Writes each visible body and a mask
+	// of the frusta it is in, and returns the number of bodies written, at most 'maxBodies'.
+	int cull(hkpWorld* world, int numFrusta, const float* planes, const float* corners, int maxBodies,
+		hkpRigidBody** bodies, int* masks)
+	{
+		if(numFrusta > MAX_FRUSTA)
+			numFrusta = MAX_FRUSTA;
+
+		setupPlanes(numFrusta, planes);
+
+		hkAabb bounds;
+		bounds.m_min.set(corners[0], corners[1], corners[2]);
+		bounds.m_max = bounds.m_min;
+		for(int i = 1; i < numFrusta * 8; ++i)
+		{
+			hkVector4 corner(corners[i * 3], corners[i * 3 + 1], corners[i * 3 + 2]);
+			bounds.m_min.setMin4(bounds.m_min, corner);
+			bounds.m_max.setMax4(bounds.m_max, corner);
+		}
+
+		const hkpBroadPhase* broadPhase = world->getBroadPhase();
+		pairs.clear();
+		broadPhase->querySingleAabb(bounds, pairs);
+
+		int count = 0;
+		for(int i = 0; i < pairs.getSize() && count < maxBodies; ++i)
+		{
+			const hkpTypedBroadPhaseHandle* handle = static_cast<const hkpTypedBroadPhaseHandle*>(pairs[i].m_b);
+			if(handle->getType() != hkpWorldObject::BROAD_PHASE_ENTITY)
+				continue;
+
+			hkpRigidBody* body = hkpGetRigidBody(static_cast<const hkpCollidable*>(handle->getOwner()));
+			if(body == HK_NULL)
+				continue;
+
+			hkAabb aabb;
+			broadPhase->getAabb(handle, aabb);
+
+			int mask = testAabb(numFrusta, aabb);
+			if(mask == 0)
+				continue;
+
+			bodies[count] = body;
+			masks[count] = mask;
+			count++;
+		}
+
+		return count;
+	}
+
+private:
+
+	// Stores the planes of each frustum transposed in two groups of four, padding the last two
+	// with planes that never reject
+	void setupPlanes(int numFrusta, const float* planes)
+	{
+		for(int f = 0; f < numFrusta; ++f)
+		{
+			float* soa = frustumPlanes[f];
+			for(int p = 0; p < 8; ++p)
+			{
+				int group = (p / 4) * 16 + (p % 4);
+				if(p < 6)
+				{
+					const float* plane = planes + (f * 6 + p) * 4;
+					soa[group] = plane[0];
+					soa[group + 4] = plane[1];
+					soa[group + 8] = plane[2];
+					soa[group + 12] = plane[3];
+				}
+				else
+				{
+					soa[group] = soa[group + 4] = soa[group + 8] = 0;
+					soa[group + 12] = -1;
+				}
+			}
+		}
+	}
+
+	// A box is outside a plane if its center is further out than the projection of its extents
+	int testAabb(int numFrusta, const hkAabb& aabb)
+	{
+		__m128 cx = _mm_set1_ps((aabb.m_min(0) + aabb.m_max(0)) * 0.5f);
+		__m128 cy = _mm_set1_ps((aabb.m_min(1) + aabb.m_max(1)) * 0.5f);
+		__m128 cz = _mm_set1_ps((aabb.m_min(2) + aabb.m_max(2)) * 0.5f);
+		__m128 ex = _mm_set1_ps((aabb.m_max(0) - aabb.m_min(0)) * 0.5f);
+		__m128 ey = _mm_set1_ps((aabb.m_max(1) - aabb.m_min(1)) * 0.5f);
+		__m128 ez = _mm_set1_ps((aabb.m_max(2) - aabb.m_min(2)) * 0.5f);
+		__m128 signMask = _mm_set1_ps(-0.0f);
+
+		int mask = 0;
+		for(int f = 0; f < numFrusta; ++f)
+		{
+			__m128 outside = _mm_setzero_ps();
+			for(int group = 0; group < 2; ++group)
+			{
+				const float* soa = frustumPlanes[f] + group * 16;
+				__m128 nx = _mm_loadu_ps(soa);
+				__m128 ny = _mm_loadu_ps(soa + 4);
+				__m128 nz = _mm_loadu_ps(soa + 8);
+				__m128 d = _mm_loadu_ps(soa + 12);
+
+				__m128 dist = _mm_add_ps(_mm_add_ps(_mm_mul_ps(nx, cx), _mm_mul_ps(ny, cy)),
+					_mm_add_ps(_mm_mul_ps(nz, cz), d));
+				__m128 radius = _mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_andnot_ps(signMask, nx), ex),
+					_mm_mul_ps(_mm_andnot_ps(signMask, ny), ey)), _mm_mul_ps(_mm_andnot_ps(signMask, nz), ez));
+
+				outside = _mm_or_ps(outside, _mm_cmpgt_ps(dist, radius));
+			}
+
+			if(_mm_movemask_ps(outside) == 0)
+				mask |= 1 << f;
+		}
+
+		return mask;
+	}
+
+	float frustumPlanes[MAX_FRUSTA][32];
+	hkArray<hkpBroadPhaseHandlePair> pairs;
+};
@@ -41,6 +41,7 @@
 #include <Common/Base/Memory/System/hkMemorySystem.h>
 #include <Common/Base/Memory/Allocator/hkMemoryAllocator.h>
 #include <Common/Base/Memory/Allocator/Malloc/hkMallocAllocator.h>
+#include <Common/Base/Thread/CriticalSection/hkCriticalSection.h>
 
 #include <Common/Internal/ConvexHull/hkGeometryUtility.h>
 #include <Common/Internal/ConvexHull/hkPlaneEquationUtil.h>
@@ -72,11 +73,49 @@
 #include <Physics/Dynamics/World/hkpPhysicsSystem.h>
 #include <Physics/Dynamics/World/hkpSimulationIsland.h>
 
+#include "Tracepoints.cpp"
 #include "ContactListener.cpp"
 #include "BroadphaseBorder.cpp"
 #include "PhantomCallback.cpp"
+#include "QuerySnapshot.cpp"
+#include "ContactQuery.cpp"
+#include "DepthField.cpp"
+#include "Destructible.cpp"
+#include "FrustumCull.cpp"
+#include "MeshShape.cpp"
+#include "RaycastVehicle.cpp"
+#include "ShapeCooker.cpp"
+#include "StepBudget.cpp"
+
+TRACE_DEFINE_PROVIDER();
 
 hkpWorld* world;
+hkArray<Destructible*> destructibles;
+hkArray<Destructible*> pendingBreaks;
+hkArray<RaycastVehicle*> vehicles;
+hkArray<DepthField*> depthFields;
+FrustumCuller frustumCuller;
+QuerySnapshot querySnapshot;
+
+// A body that is kept out of the world until update adds it. Either its shape is still being
+// cooked and it holds a small placeholder shape, or its add was deferred by the step budget and
+// 'shape' is NULL.
+struct PendingBody
+{
+	hkpRigidBody* body;
+	PendingShape* shape;
+	float mass;
+};
+
+ShapeCooker shapeCooker;
+hkArray<PendingBody> pendingBodies;
+// Guards pendingBodies, which the scene thread fills and cancels while update drains it on the
+// physics thread. It is always taken before the world lock.
+hkCriticalSection pendingLock(0);
+hkpShape* placeholderShape = HK_NULL;
+
+StepBudget stepBudget;
+bool snapshotDeferred = false;
 
 static void HK_CALL errorReportFunction(const char* str, void*)
 {
@@ -92,12 +131,237 @@ static bool allZero(float vals[], int count)
 	return true;
 }
 
+static hkpRigidBody* createRigidBody(hkpShape* shape, float mass, hkpMotion::MotionType motionType, 
+	hkpCollidableQualityType collideQuality, float pos[], float rot[], float linearVelocity[], float linearDamping, 
+	float maxLinearVelocity, float angularVelocity[], float angularDamping, float maxAngularVelocity, float friction, 
+	float restitution, float allowedPenetrationDepth, bool neverDeactivate, float gravityFactor)
+{
+	hkpRigidBodyCinfo bodyInfo;
+	
+	bodyInfo.m_shape = shape;
+	bodyInfo.m_motionType = motionType;
+	bodyInfo.m_position.set(pos[0], pos[1], pos[2]);
+	bodyInfo.m_rotation.set(rot[0], rot[1], rot[2], rot[3]);
+
+	if(friction >= 0)
+		bodyInfo.m_friction = friction;
+	if(restitution >= 0)
+		bodyInfo.m_restitution = restitution;
+	if(allowedPenetrationDepth >= 0)
+		bodyInfo.m_allowedPenetrationDepth = allowedPenetrationDepth;
+	if(collideQuality >= 0)
+		bodyInfo.m_qualityType = collideQuality;
+	bodyInfo.m_gravityFactor = gravityFactor;
+
+	if(!(motionType == hkpMotion::MOTION_FIXED || motionType == hkpMotion::MOTION_KEYFRAMED))
+	{
+		hkpMassProperties massProperties;
+		hkpInertiaTensorComputer::computeShapeVolumeMassProperties(shape, mass, massProperties);
+
+		bodyInfo.m_mass = massProperties.m_mass;
+		bodyInfo.m_centerOfMass = massProperties.m_centerOfMass;
+		bodyInfo.m_inertiaTensor = massProperties.m_inertiaTensor;
+
+		if(!allZero(linearVelocity, 3))
+			bodyInfo.m_linearVelocity.set(linearVelocity[0], linearVelocity[1], linearVelocity[2]);
+		if(linearDamping >= 0)
+			bodyInfo.m_linearDamping = linearDamping;
+		if(!allZero(angularVelocity, 3))
+			bodyInfo.m_angularVelocity.set(angularVelocity[0], angularVelocity[1], angularVelocity[2]);
+		if(angularDamping >= 0)
+			bodyInfo.m_angularDamping = angularDamping;
+		if(maxLinearVelocity >= 0)
+			bodyInfo.m_maxLinearVelocity = maxLinearVelocity;
+		if(maxAngularVelocity >= 0)
+			bodyInfo.m_maxAngularVelocity = maxAngularVelocity;
+
+		bodyInfo.m_enableDeactivation = !neverDeactivate;
+	}
+
+	return new hkpRigidBody(bodyInfo);
+}
+
+// Removes a destructible object and all of its bodies from the world and deletes it. The bodies
+// are retired even if shatter already took them out of the world, since the query snapshot may
+// still refer to them. The world must be locked.
+static void removeDestructible(Destructible* destructible)
+{
+	destructibles.removeAt(destructibles.indexOf(destructible));
+	int index = pendingBreaks.indexOf(destructible);
+	if(index >= 0)
+		pendingBreaks.removeAtAndCopy(index);
+
+	hkpRigidBody* intact = destructible->intact;
+	querySnapshot.retire(intact);
+	if(intact->getWorld() != HK_NULL)
+		world->removeEntity(intact);
+
+	for(int i = 0; i < destructible->getFragmentCount(); ++i)
+	{
+		hkpRigidBody* fragment = destructible->getFragment(i);
+		querySnapshot.retire(fragment);
+		if(fragment->getWorld() != HK_NULL)
+			world->removeEntity(fragment);
+	}
+
+	delete destructible;
+}
+
+// Removes 'body' if it belongs to a destructible object, either the whole object if it is the
+// intact body or only the fragment otherwise, so that shatter does not add it back. Returns false
+// for other bodies.
+static bool removeDestructibleBody(hkpRigidBody* body)
+{
+	for(int i = 0; i < destructibles.getSize(); ++i)
+	{
+		Destructible* destructible = destructibles[i];
+		if(destructible->intact == body)
+		{
+			world->lock();
+			removeDestructible(destructible);
+			world->unlock();
+			return true;
+		}
+
+		if(destructible->hasFragment(body))
+		{
+			world->lock();
+			if(body->getWorld() != HK_NULL)
+			{
+				querySnapshot.retire(body);
+				world->removeEntity(body);
+			}
+			destructible->removeFragment(body);
+			world->unlock();
+			return true;
+		}
+	}
+
+	return false;
+}
+
+// Adds the pending bodies whose shapes are ready to the world in the order they were queued, after
+// swapping in their cooked shapes, while the step budget allows. Returns the number of bodies that
+// are still pending.
+static int activatePendingBodies()
+{
+	// The list stays locked until each body is in the world, so a body is always either pending or
+	// in the world for remove_rigid_body
+	pendingLock.enter();
+
+	int activated = 0;
+	for(int i = 0; i < pendingBodies.getSize(); )
+	{
+		PendingBody pending = pendingBodies[i];
+		if(pending.shape != HK_NULL && !shapeCooker.isReady(pending.shape))
+		{
+			++i;
+			continue;
+		}
+
+		// This runs before the step, so the time the last step took is kept for it
+		if(!stepBudget.allows(activated, stepBudget.lastStepSeconds))
+			break;
+
+		hkpRigidBody* body = pending.body;
+		hkpShape* shape = (pending.shape != HK_NULL) ? shapeCooker.take(pending.shape) : HK_NULL;
+		pendingBodies.removeAtAndCopy(i);
+
+		// The cooker was stopped before building the shape
+		if(pending.shape != HK_NULL && shape == HK_NULL)
+		{
+			body->removeReference();
+			continue;
+		}
+
+		world->lock();
+
+		if(shape != HK_NULL)
+		{
+			body->setShape(shape);
+			if(!body->isFixedOrKeyframed())
+			{
+				hkpMassProperties massProperties;
+				hkpInertiaTensorComputer::computeShapeVolumeMassProperties(shape, pending.mass, massProperties);
+				body->setMass(massProperties.m_mass);
+				body->setCenterOfMassLocal(massProperties.m_centerOfMass);
+				body->setInertiaLocal(massProperties.m_inertiaTensor);
+			}
+			shape->removeReference();
+		}
+
+		world->addEntity(body);
+		body->removeReference();
+
+		world->unlock();
+
+		activated++;
+	}
+
+	int remaining = pendingBodies.getSize();
+	pendingLock.leave();
+
+	return remaining;
+}
+
+// Adds a body whose add was deferred to the world right away, for callers that need it there. The
+// world must not be locked by the caller. Returns false if the body still waits for its shape to be
+// cooked, in which case it cannot be added yet.
+static bool addDeferredBody(hkpRigidBody* body)
+{
+	bool added = true;
+	pendingLock.enter();
+	for(int i = 0; i < pendingBodies.getSize(); ++i)
+	{
+		if(pendingBodies[i].body != body)
+			continue;
+
+		if(pendingBodies[i].shape != HK_NULL)
+		{
+			added = false;
+			break;
+		}
+
+		pendingBodies.removeAtAndCopy(i);
+		world->lock();
+		world->addEntity(body);
+		body->removeReference();
+		world->unlock();
+		break;
+	}
+	pendingLock.leave();
+	return added;
+}
+
+// Drops a body that is not in the world yet, and returns false if the body is not pending
+static bool cancelPendingBody(hkpRigidBody* body)
+{
+	bool cancelled = false;
+	pendingLock.enter();
+	for(int i = 0; i < pendingBodies.getSize(); ++i)
+	{
+		if(pendingBodies[i].body == body)
+		{
+			if(pendingBodies[i].shape != HK_NULL)
+				shapeCooker.release(pendingBodies[i].shape);
+			body->removeReference();
+			pendingBodies.removeAtAndCopy(i);
+			cancelled = true;
+			break;
+		}
+	}
+	pendingLock.leave();
+	return cancelled;
+}
+
 extern "C"
 {
 	__declspec(dllexport) bool init_world(float gravity[], float worldSize, float collisionTolerance,
 		hkpWorldCinfo::SimulationType simType, hkpWorldCinfo::SolverType solverType, bool fireCollisionCallbacks,
 		bool enableDeactivation, float contactRestingVelocity)
 	{
+		TRACE_EXPORT(init_world);
+
 		hkMallocAllocator mallocBase;
 		hkMemorySystem::FrameInfo frameInfo(0);
 
@@ -134,6 +398,8 @@ extern "C"
 
 	__declspec(dllexport) void set_gravity(float gravity[])
 	{
+		TRACE_EXPORT(set_gravity);
+
 		if(world == NULL)
 			return;
 
@@ -143,6 +409,8 @@ extern "C"
 
 	__declspec(dllexport) void add_world_leave_callback(leaveWorldCallback callback)
 	{
+		TRACE_EXPORT(add_world_leave_callback);
+
 		world->lock();
 
 		BroadphaseBorder* border = new BroadphaseBorder( world, callback );
@@ -154,17 +422,23 @@ extern "C"
 
 	__declspec(dllexport) hkpShape* create_box_shape(float dim[], float convexRadius)
 	{
+		TRACE_EXPORT(create_box_shape);
+
 		hkVector4 halfExtent(dim[0] / 2, dim[1] / 2, dim[2] / 2);
 		return new hkpBoxShape(halfExtent, convexRadius);
 	}
 
 	__declspec(dllexport) hkpShape* create_sphere_shape(float radius)
 	{
+		TRACE_EXPORT(create_sphere_shape);
+
 		return new hkpSphereShape(radius);
 	}
 
 	__declspec(dllexport) hkpShape* create_triangle_shape(float v0[], float v1[], float v2[], float convexRadius)
 	{
+		TRACE_EXPORT(create_triangle_shape);
+
 		hkVector4 _v0(v0[0], v0[1], v0[2]);
 		hkVector4 _v1(v1[0], v1[1], v1[2]);
 		hkVector4 _v2(v2[0], v2[1], v2[2]);
@@ -174,6 +448,8 @@ extern "C"
 
 	__declspec(dllexport) hkpShape* create_capsule_shape(float top[], float bottom[], float radius)
 	{
+		TRACE_EXPORT(create_capsule_shape);
+
 		hkVector4 _v0(top[0], top[1], top[2]);
 		hkVector4 _v1(bottom[0], bottom[1], bottom[2]);
 
@@ -182,6 +458,8 @@ extern "C"
 
 	__declspec(dllexport) hkpShape* create_cylinder_shape(float top[], float bottom[], float radius, float convexRadius)
 	{
+		TRACE_EXPORT(create_cylinder_shape);
+
 		hkVector4 _v0(top[0], top[1], top[2]);
 		hkVector4 _v1(bottom[0], bottom[1], bottom[2]);
 
@@ -191,23 +469,9 @@ extern "C"
 	__declspec(dllexport) hkpShape* create_convex_shape(int numVertices, float vertices[], int stride, 
 		float convexRadius)
 	{
-		hkStridedVertices stridedVerts;
-		stridedVerts.m_numVertices = numVertices;
-		stridedVerts.m_striding = stride;
-		stridedVerts.m_vertices = vertices;
-
-		hkGeometry* geometry = new hkGeometry();
-		hkInplaceArrayAligned16<hkVector4,32> transformedPlanes;
-
-		hkGeometryUtility::createConvexGeometry(stridedVerts, *geometry, transformedPlanes);
+		TRACE_EXPORT(create_convex_shape);
 
-		stridedVerts.m_numVertices = geometry->m_vertices.getSize();
-		stridedVerts.m_striding = sizeof(hkVector4);
-		stridedVerts.m_vertices = &(geometry->m_vertices[0](0));
-
-		hkpConvexVerticesShape* shape = new hkpConvexVerticesShape(stridedVerts, transformedPlanes, convexRadius);
-
-		return shape;
+		return createConvexHull(numVertices, vertices, stride, convexRadius);
 	}
 
 	/*__declspec(dllexport) hkpShape* create_mesh_shape(int numVertices, float vertices[], int vertexStride, 
@@ -236,21 +500,87 @@ extern "C"
 	__declspec(dllexport) hkpShape* create_mesh_shape(int numVertices, float vertices[], int vertexStride, 
 		int numTriangles, int indices[], float convexRadius)
 	{
+		TRACE_EXPORT(create_mesh_shape);
+
 		hkArray<hkpShape*> shapeArray;
 
+		char* base = (char*)vertices;
 		for(int i = 0; i < numTriangles * 3; i += 3)
 		{
-			hkpShape* triShape = create_triangle_shape(&vertices[indices[i] * 3], &vertices[indices[i + 1] * 3],
-				&vertices[indices[i + 2] * 3], convexRadius);
+			hkpShape* triShape = create_triangle_shape((float*)(base + indices[i] * vertexStride), 
+				(float*)(base + indices[i + 1] * vertexStride), (float*)(base + indices[i + 2] * vertexStride), 
+				convexRadius);
 			shapeArray.pushBack(triShape);
 		}
 
 		return new hkpListShape(&shapeArray[0], shapeArray.getSize());
 	}
 
+	// Creates a triangle mesh directly from interleaved vertex buffers and 16 or 32 bit index buffers.
+	// See createStridedMesh for when the buffers are referenced rather than copied. Returns NULL if
+	// 'scale' or 'weldVertices' is given for referenced buffers.
+	__declspec(dllexport) hkpShape* create_strided_mesh_shape(int numVertices, char* vertices, int vertexStride, 
+		int numTriangles, char* indices, int indexSize, float scale[], bool copyData, bool weldEdges, 
+		bool weldVertices, float convexRadius)
+	{
+		TRACE_EXPORT(create_strided_mesh_shape);
+
+		return createStridedMesh(numVertices, vertices, vertexStride, numTriangles, indices, indexSize, scale,
+			copyData, weldEdges, weldVertices, convexRadius);
+	}
+
+	// Queues the convex hull of the vertices to be built on the shape cooker's worker thread, and
+	// returns a handle that is passed to is_shape_ready, wait_for_shape, release_pending_shape or
+	// add_pending_rigid_body. The vertices are copied before returning.
+	__declspec(dllexport) PendingShape* create_convex_shape_async(int numVertices, float vertices[], int stride, 
+		float convexRadius)
+	{
+		TRACE_EXPORT(create_convex_shape_async);
+
+		return shapeCooker.cookConvexHull(numVertices, vertices, stride, convexRadius);
+	}
+
+	// Queues a MOPP accelerated triangle mesh like create_strided_mesh_shape with copyData set, and
+	// returns a handle like create_convex_shape_async. The buffers are copied before returning.
+	__declspec(dllexport) PendingShape* create_strided_mesh_shape_async(int numVertices, char* vertices, 
+		int vertexStride, int numTriangles, char* indices, int indexSize, float scale[], bool weldEdges, 
+		bool weldVertices, float convexRadius)
+	{
+		TRACE_EXPORT(create_strided_mesh_shape_async);
+
+		return shapeCooker.cookStridedMesh(numVertices, vertices, vertexStride, numTriangles, indices, 
+			indexSize, scale, weldEdges, weldVertices, convexRadius);
+	}
+
+	__declspec(dllexport) bool is_shape_ready(PendingShape* pending)
+	{
+		TRACE_EXPORT(is_shape_ready);
+
+		return shapeCooker.isReady(pending);
+	}
+
+	// Blocks until the shape is built, releases the handle, and returns the shape
+	__declspec(dllexport) hkpShape* wait_for_shape(PendingShape* pending)
+	{
+		TRACE_EXPORT(wait_for_shape);
+
+		shapeCooker.wait(pending);
+		return shapeCooker.take(pending);
+	}
+
+	// Gives up a handle whose shape is no longer needed. A shape that is still queued is not built.
+	__declspec(dllexport) void release_pending_shape(PendingShape* pending)
+	{
+		TRACE_EXPORT(release_pending_shape);
+
+		shapeCooker.release(pending);
+	}
+
 	__declspec(dllexport) hkpShape* create_phantom_shape(hkpShape* boundingShape,
 		phantomEnterCallback enter, phantomLeaveCallback leave)
 	{
+		TRACE_EXPORT(create_phantom_shape);
+
 		PhantomCallback* phantom = new PhantomCallback(enter, leave);
 		hkpBvShape* bvShape = new hkpBvShape(boundingShape, phantom);
 		phantom->removeReference();
@@ -263,70 +593,256 @@ extern "C"
 		float maxLinearVelocity, float angularVelocity[], float angularDamping, float maxAngularVelocity, float friction, 
 		float restitution, float allowedPenetrationDepth, bool neverDeactivate, float gravityFactor)
 	{
-		world->lock();
+		TRACE_EXPORT(add_rigid_body);
 
-		hkpRigidBodyCinfo bodyInfo;
-		
-		bodyInfo.m_shape = shape;
-		bodyInfo.m_motionType = motionType;
-		bodyInfo.m_position.set(pos[0], pos[1], pos[2]);
-		bodyInfo.m_rotation.set(rot[0], rot[1], rot[2], rot[3]);
-
-		if(friction >= 0)
-			bodyInfo.m_friction = friction;
-		if(restitution >= 0)
-			bodyInfo.m_restitution = restitution;
-		if(allowedPenetrationDepth >= 0)
-			bodyInfo.m_allowedPenetrationDepth = allowedPenetrationDepth;
-		if(collideQuality >= 0)
-			bodyInfo.m_qualityType = collideQuality;
-		bodyInfo.m_gravityFactor = gravityFactor;
-
-		if(!(motionType == hkpMotion::MOTION_FIXED || motionType == hkpMotion::MOTION_KEYFRAMED))
+		hkpRigidBody* body = createRigidBody(shape, mass, motionType, collideQuality, pos, rot, linearVelocity,
+			linearDamping, maxLinearVelocity, angularVelocity, angularDamping, maxAngularVelocity, friction,
+			restitution, allowedPenetrationDepth, neverDeactivate, gravityFactor);
+		shape->removeReference();
+
+		// Queued bodies are added by update while its budget allows, and are pending until then
+		if(stepBudget.defersAdds())
 		{
-			hkpMassProperties massProperties;
-			hkpInertiaTensorComputer::computeShapeVolumeMassProperties(shape, mass, massProperties);
-
-			bodyInfo.m_mass = massProperties.m_mass;
-			bodyInfo.m_centerOfMass = massProperties.m_centerOfMass;
-			bodyInfo.m_inertiaTensor = massProperties.m_inertiaTensor;
-
-			if(!allZero(linearVelocity, 3))
-				bodyInfo.m_linearVelocity.set(linearVelocity[0], linearVelocity[1], linearVelocity[2]);
-			if(linearDamping >= 0)
-				bodyInfo.m_linearDamping = linearDamping;
-			if(!allZero(angularVelocity, 3))
-				bodyInfo.m_angularVelocity.set(angularVelocity[0], angularVelocity[1], angularVelocity[2]);
-			if(angularDamping >= 0)
-				bodyInfo.m_angularDamping = angularDamping;
-			if(maxLinearVelocity >= 0)
-				bodyInfo.m_maxLinearVelocity = maxLinearVelocity;
-			if(maxAngularVelocity >= 0)
-				bodyInfo.m_maxAngularVelocity = maxAngularVelocity;
-
-			bodyInfo.m_enableDeactivation = !neverDeactivate;
+			pendingLock.enter();
+			PendingBody& pendingBody = pendingBodies.expandOne();
+			pendingBody.body = body;
+			pendingBody.shape = HK_NULL;
+			pendingBody.mass = mass;
+			pendingLock.leave();
+			return body;
 		}
 
-		hkpRigidBody* body = new hkpRigidBody(bodyInfo);
+		world->lock();
 
 		world->addEntity(body);
 		body->removeReference();
 
-		shape->removeReference();
-
 		world->unlock();
 
 		return body;
 	}
 
+	// Same as add_rigid_body, but takes a handle from one of the create_*_async functions instead of
+	// a shape. The body is returned right away and is added to the world by the first update after
+	// the shape is ready. Until then, is_body_pending returns true for it and it does not collide.
+	__declspec(dllexport) hkpRigidBody* add_pending_rigid_body(PendingShape* pending, float mass, 
+		hkpMotion::MotionType motionType, hkpCollidableQualityType collideQuality, float pos[], float rot[], 
+		float linearVelocity[], float linearDamping, float maxLinearVelocity, float angularVelocity[], 
+		float angularDamping, float maxAngularVelocity, float friction, float restitution, 
+		float allowedPenetrationDepth, bool neverDeactivate, float gravityFactor)
+	{
+		TRACE_EXPORT(add_pending_rigid_body);
+
+		if(placeholderShape == HK_NULL)
+			placeholderShape = new hkpSphereShape(0.01f);
+
+		hkpRigidBody* body = createRigidBody(placeholderShape, mass, motionType, collideQuality, pos, rot, 
+			linearVelocity, linearDamping, maxLinearVelocity, angularVelocity, angularDamping, maxAngularVelocity, 
+			friction, restitution, allowedPenetrationDepth, neverDeactivate, gravityFactor);
+
+		pendingLock.enter();
+		PendingBody& pendingBody = pendingBodies.expandOne();
+		pendingBody.body = body;
+		pendingBody.shape = pending;
+		pendingBody.mass = mass;
+		pendingLock.leave();
+
+		return body;
+	}
+
+	__declspec(dllexport) bool is_body_pending(hkpRigidBody* body)
+	{
+		TRACE_EXPORT(is_body_pending);
+
+		bool pending = false;
+		pendingLock.enter();
+		for(int i = 0; i < pendingBodies.getSize() && !pending; ++i)
+			pending = (pendingBodies[i].body == body);
+		pendingLock.leave();
+
+		return pending;
+	}
+
 	__declspec(dllexport) void remove_rigid_body(hkpRigidBody* body)
 	{
-		world->removeEntity(body);
+		TRACE_EXPORT(remove_rigid_body);
+
+		if(cancelPendingBody(body))
+			return;
+
+		if(removeDestructibleBody(body))
+			return;
+
+		if(body->getWorld() != HK_NULL)
+		{
+			querySnapshot.retire(body);
+			world->removeEntity(body);
+		}
+	}
+
+	// Adds a pre-fractured object that is simulated as one body until a contact approaching it faster
+	// than 'breakThreshold' breaks it into its fragments, and returns the intact body. The fragment 
+	// bodies are written to 'fragmentBodies' and are added to the world when the object breaks.
+	// 'localPos' and 'localRot' (3 and 4 floats per fragment) place the fragment shapes in the object.
+	// Returns NULL, and keeps the shape references, if there are no fragments or an array is missing.
+	__declspec(dllexport) hkpRigidBody* add_destructible(int numFragments, hkpShape** shapes, float localPos[],
+		float localRot[], float masses[], float pos[], float rot[], float friction, float restitution, 
+		float breakThreshold, destructibleBreakCallback callback, hkpRigidBody** fragmentBodies)
+	{
+		TRACE_EXPORT(add_destructible);
+
+		if(numFragments <= 0 || shapes == NULL || localPos == NULL || localRot == NULL || masses == NULL ||
+			pos == NULL || rot == NULL || fragmentBodies == NULL)
+			return HK_NULL;
+		for(int i = 0; i < numFragments; ++i)
+		{
+			if(shapes[i] == HK_NULL)
+				return HK_NULL;
+		}
+
+		world->lock();
+
+		hkArray<hkTransform> localTransforms(numFragments);
+		for(int i = 0; i < numFragments; ++i)
+		{
+			hkQuaternion r(localRot[i * 4], localRot[i * 4 + 1], localRot[i * 4 + 2], localRot[i * 4 + 3]);
+			hkVector4 t(localPos[i * 3], localPos[i * 3 + 1], localPos[i * 3 + 2]);
+			localTransforms[i].set(r, t);
+		}
+
+		hkTransform transform(hkQuaternion(rot[0], rot[1], rot[2], rot[3]), hkVector4(pos[0], pos[1], pos[2]));
+
+		Destructible* destructible = new Destructible(numFragments, shapes, &localTransforms[0], masses,
+			transform, friction, restitution, breakThreshold, callback, &pendingBreaks);
+		destructible->getFragments(fragmentBodies);
+
+		world->addEntity(destructible->intact);
+		destructibles.pushBack(destructible);
+
+		world->unlock();
+
+		return destructible->intact;
+	}
+
+	// Removes the destructible object whose intact body is 'intact', together with all of its
+	// fragment bodies, whether it broke or not, and frees it
+	__declspec(dllexport) void remove_destructible(hkpRigidBody* intact)
+	{
+		TRACE_EXPORT(remove_destructible);
+
+		removeDestructibleBody(intact);
+	}
+
+	// Turns 'chassis' into a raycast vehicle with 'numWheels' wheels described by WHEEL_PARAMS floats
+	// each. Vehicles are indexed in the order they were added by set_vehicle_inputs and 
+	// get_wheel_transforms.
+	__declspec(dllexport) RaycastVehicle* add_vehicle(hkpRigidBody* chassis, int numWheels, float wheelParams[])
+	{
+		TRACE_EXPORT(add_vehicle);
+
+		// The actions of a world can only refer to bodies in it, so a chassis that is still waiting
+		// for its shape is rejected
+		if(!addDeferredBody(chassis))
+			return HK_NULL;
+
+		world->lock();
+
+		RaycastVehicle* vehicle = new RaycastVehicle(chassis, numWheels, wheelParams);
+		world->addAction(vehicle);
+		vehicles.pushBack(vehicle);
+
+		world->unlock();
+
+		return vehicle;
+	}
+
+	__declspec(dllexport) void remove_vehicle(RaycastVehicle* vehicle)
+	{
+		TRACE_EXPORT(remove_vehicle);
+
+		world->lock();
+
+		int index = vehicles.indexOf(vehicle);
+		if(index >= 0)
+		{
+			vehicles.removeAtAndCopy(index);
+			if(vehicle->getWorld() != HK_NULL)
+				world->removeAction(vehicle);
+			vehicle->removeReference();
+		}
+
+		world->unlock();
+	}
+
+	// Sets the steering angle, drive force and brake force (3 floats each) of every vehicle at once
+	__declspec(dllexport) void set_vehicle_inputs(float inputs[])
+	{
+		TRACE_EXPORT(set_vehicle_inputs);
+
+		for(int i = 0; i < vehicles.getSize(); ++i)
+			vehicles[i]->setInput(inputs + i * 3);
+	}
+
+	// Writes the world transforms of the wheels of every vehicle, in order, as column-major matrices
+	__declspec(dllexport) void get_wheel_transforms(float* transforms)
+	{
+		TRACE_EXPORT(get_wheel_transforms);
+
+		world->markForRead();
+
+		for(int i = 0; i < vehicles.getSize(); ++i)
+		{
+			vehicles[i]->getWheelTransforms(transforms);
+			transforms += vehicles[i]->numWheels * 16;
+		}
+
+		world->unmarkForRead();
+	}
+
+	// Creates static collision geometry for a depth camera of 'width' by 'height' pixels, with one box
+	// per 'tileSize' square of pixels. 'intrinsics' are fx, fy, cx and cy in pixels. A pixel value is
+	// shifted right by 'depthShift' and multiplied by 'depthScale' to get meters, and depths outside 
+	// 'nearDepth' to 'farDepth' are ignored. Boxes are 'thickness' deep, and each update moves at most
+	// 'maxUpdates' of those whose depth changed by more than 'threshold'.
+	__declspec(dllexport) DepthField* add_depth_field(int width, int height, int tileSize, float intrinsics[],
+		float depthScale, int depthShift, float nearDepth, float farDepth, float thickness, float threshold, 
+		int maxUpdates)
+	{
+		TRACE_EXPORT(add_depth_field);
+
+		DepthField* field = new DepthField(world, &querySnapshot, width, height, tileSize, intrinsics, depthScale, depthShift,
+			nearDepth, farDepth, thickness, threshold, maxUpdates);
+		depthFields.pushBack(field);
+
+		return field;
+	}
+
+	// Updates the geometry from a depth frame. 'cameraTransform' is the column-major camera to world
+	// transform.
+	__declspec(dllexport) void update_depth_field(DepthField* field, unsigned short depth[], float cameraTransform[])
+	{
+		TRACE_EXPORT(update_depth_field);
+
+		field->update(depth, cameraTransform);
+	}
+
+	__declspec(dllexport) void remove_depth_field(DepthField* field)
+	{
+		TRACE_EXPORT(remove_depth_field);
+
+		int index = depthFields.indexOf(field);
+		if(index >= 0)
+		{
+			depthFields.removeAtAndCopy(index);
+			delete field;
+		}
 	}
 
 	__declspec(dllexport) void add_contact_listener(hkpRigidBody* body, contactCallback cc,
 		collisionStarted cs, collisionEnded ce)
 	{
+		TRACE_EXPORT(add_contact_listener);
+
 		world->lock();
 
 		ContactListener* listener = new ContactListener(body);
@@ -339,24 +855,32 @@ extern "C"
 
 	__declspec(dllexport) void add_force(hkpRigidBody* body, float timeStep, float force[])
 	{
+		TRACE_EXPORT(add_force);
+
 		hkVector4 _force(force[0], force[1], force[2]);
 		body->applyForce(timeStep, _force);
 	}
 
 	__declspec(dllexport) void add_torque(hkpRigidBody* body, float timeStep, float torque[])
 	{
+		TRACE_EXPORT(add_torque);
+
 		hkVector4 _torque(torque[0], torque[1], torque[2]);
 		body->applyTorque(timeStep, _torque);
 	}
 
 	__declspec(dllexport) void set_linear_velocity(hkpRigidBody* body, float vel[])
 	{
+		TRACE_EXPORT(set_linear_velocity);
+
 		hkVector4 velocity(vel[0], vel[1], vel[2]);
 		body->setLinearVelocity(velocity);
 	}
 
 	__declspec(dllexport) void get_linear_velocity(hkpRigidBody* body, float* vel)
 	{
+		TRACE_EXPORT(get_linear_velocity);
+
 		hkVector4 velocity = body->getLinearVelocity();
 		vel[0] = velocity(0);
 		vel[1] = velocity(1);
@@ -365,12 +889,16 @@ extern "C"
 
 	__declspec(dllexport) void set_angular_velocity(hkpRigidBody* body, float vel[])
 	{
+		TRACE_EXPORT(set_angular_velocity);
+
 		hkVector4 velocity(vel[0], vel[1], vel[2]);
 		body->setAngularVelocity(velocity);
 	}
 
 	__declspec(dllexport) void get_angular_velocity(hkpRigidBody* body, float* vel)
 	{
+		TRACE_EXPORT(get_angular_velocity);
+
 		hkVector4 velocity = body->getAngularVelocity();
 		vel[0] = velocity(0);
 		vel[1] = velocity(1);
@@ -379,6 +907,8 @@ extern "C"
 
 	__declspec(dllexport) void apply_hard_keyframe(hkpRigidBody* body, float position[], float rotation[], float timeStep)
 	{
+		TRACE_EXPORT(apply_hard_keyframe);
+
 		world->lock();
 
 		hkVector4 pos(position[0], position[1], position[2]);
@@ -393,6 +923,8 @@ extern "C"
 		float linearVelocityFactor[], float maxAngularAcceleration, float maxLinearAcceleration, float maxAllowedDistance, 
 		float timeStep)
 	{
+		TRACE_EXPORT(apply_soft_keyframe);
+
 		world->lock();
 
 		hkpKeyFrameUtility::KeyFrameInfo keyInfo;
@@ -422,6 +954,8 @@ extern "C"
 
 	__declspec(dllexport) void get_AABB(hkpRigidBody* body, float* min, float* max)
 	{
+		TRACE_EXPORT(get_AABB);
+
 		hkAabb aabb;
 		body->getCollidable()->getShape()->getAabb(body->getTransform(), 0.0f, aabb);
 
@@ -439,17 +973,103 @@ extern "C"
 		max[2] = center(2) + halfExtent(2);
 	}
 
+	// Sets the time in seconds one update may take before it defers the work that can wait: adding
+	// bodies whose shapes were cooked, shattering broken destructible objects, and publishing the
+	// query snapshot, which is skipped for at most one update in a row. If 'deferAdds' is true,
+	// add_rigid_body also queues its bodies, and is_body_pending returns true for them until they are
+	// added. A budget of 0 turns this off.
+	__declspec(dllexport) void set_step_budget(float budgetSeconds, bool deferAdds)
+	{
+		TRACE_EXPORT(set_step_budget);
+
+		stepBudget.configure(budgetSeconds, deferAdds);
+	}
+
+	// Writes how long the simulation step and the whole of the last update took in seconds, and
+	// returns the number of work items that are still deferred
+	__declspec(dllexport) int get_step_stats(float* stepSeconds, float* updateSeconds)
+	{
+		TRACE_EXPORT(get_step_stats);
+
+		*stepSeconds = stepBudget.lastStepSeconds;
+		*updateSeconds = stepBudget.lastUpdateSeconds;
+
+		pendingLock.enter();
+		int pendingCount = pendingBodies.getSize();
+		pendingLock.leave();
+		return pendingCount + pendingBreaks.getSize() + (snapshotDeferred ? 1 : 0);
+	}
+
 	__declspec(dllexport) void update(float elapsedSeconds)
 	{
+		TRACE_EXPORT(update);
+
+		stepBudget.begin();
+
+		pendingLock.enter();
+		int pendingCount = pendingBodies.getSize();
+		pendingLock.leave();
+		if(pendingCount > 0)
+		{
+			TRACE_PROBE1(activate__start, pendingCount);
+			pendingCount = activatePendingBodies();
+			TRACE_PROBE1(activate__done, pendingCount);
+		}
+
 		hkCheckDeterminismUtil::workerThreadStartFrame(true);
 
+		float stepStart = stepBudget.elapsed();
+		TRACE_PROBE1(step__start, elapsedSeconds);
 		world->stepDeltaTime(elapsedSeconds);
+		TRACE_PROBE(step__done);
+		stepBudget.lastStepSeconds = stepBudget.elapsed() - stepStart;
 
 		hkCheckDeterminismUtil::workerThreadFinishFrame();
+
+		if(pendingBreaks.getSize() > 0)
+		{
+			TRACE_PROBE1(breaks__start, pendingBreaks.getSize());
+			world->lock();
+
+			int shattered = 0;
+			while(pendingBreaks.getSize() > 0 && stepBudget.allows(shattered))
+			{
+				// The break callback may remove the object, so it is taken off the list first
+				Destructible* destructible = pendingBreaks[0];
+				pendingBreaks.removeAtAndCopy(0);
+				if(destructible->intact->getWorld() != HK_NULL)
+					destructible->shatter(world);
+				shattered++;
+			}
+
+			world->unlock();
+			TRACE_PROBE1(breaks__done, pendingBreaks.getSize());
+		}
+
+		// Queries keep reading the last published snapshot meanwhile
+		if(snapshotDeferred || stepBudget.allows(1))
+		{
+			world->markForRead();
+			TRACE_PROBE1(snapshot__start, world->getActiveSimulationIslands().getSize());
+			querySnapshot.publish(world);
+			TRACE_PROBE(snapshot__done);
+			world->unmarkForRead();
+			snapshotDeferred = false;
+		}
+		else
+		{
+			TRACE_PROBE(snapshot__deferred);
+			snapshotDeferred = true;
+		}
+
+		stepBudget.end();
+		TRACE_PROBE2(budget, stepBudget.lastStepSeconds, stepBudget.lastUpdateSeconds);
 	}
 
 	__declspec(dllexport) void get_body_transform(hkpRigidBody* body, float* transform)
 	{
+		TRACE_EXPORT(get_body_transform);
+
 		hkTransform mat;
 		body->approxCurrentTransform( mat );
 
@@ -458,6 +1078,8 @@ extern "C"
 
 	__declspec(dllexport) void get_body_position(hkpRigidBody* body, float* position)
 	{
+		TRACE_EXPORT(get_body_position);
+
 		hkVector4 pos = body->getPosition();
 		position[0] = pos(0);
 		position[1] = pos(1);
@@ -466,6 +1088,8 @@ extern "C"
 
 	__declspec(dllexport) void get_body_rotation(hkpRigidBody* body, float* rotation)
 	{
+		TRACE_EXPORT(get_body_rotation);
+
 		hkQuaternion rot = body->getRotation();
 		rotation[0] = rot(0);
 		rotation[1] = rot(1);
@@ -475,7 +1099,10 @@ extern "C"
 
 	__declspec(dllexport) void get_updated_transforms(int* bodyPtr, float* transformPtr, int &totalSize)
 	{
+		TRACE_EXPORT(get_updated_transforms);
+
 		world->markForRead();
+		TRACE_PROBE(readback__start);
 
 		const hkArray<hkpSimulationIsland*>& activeIslands = world->getActiveSimulationIslands();
 		totalSize = 0;
@@ -501,11 +1128,117 @@ extern "C"
 			}
 		}
 
+		TRACE_PROBE1(readback__done, totalSize);
 		world->unmarkForRead();
 	}
 
+	// For each of the 'numBodies' bodies, writes the number of bodies touching it to 'contactCounts',
+	// and appends the touching bodies with the normal and depth of their deepest contact to the packed
+	// 'partners', 'normals' (3 floats each) and 'depths' arrays. Returns the total number of contacts
+	// written, which is at most 'maxContacts'.
+	__declspec(dllexport) int get_contacts(int numBodies, hkpRigidBody** bodies, int maxContacts, int* contactCounts,
+		hkpRigidBody** partners, float* normals, float* depths)
+	{
+		TRACE_EXPORT(get_contacts);
+
+		world->markForRead();
+
+		int total = 0;
+		for(int i = 0; i < numBodies; ++i)
+		{
+			contactCounts[i] = getBodyContacts(bodies[i], maxContacts - total, partners + total, 
+				normals + total * 3, depths + total);
+			total += contactCounts[i];
+		}
+
+		world->unmarkForRead();
+
+		return total;
+	}
+
+	// Finds the bodies whose broadphase AABBs intersect any of the 'numFrusta' view frusta, and writes 
+	// them along with a bit mask of the frusta each is in. See FrustumCuller::cull for the layout of 
+	// 'planes' and 'corners'.
+	__declspec(dllexport) int cull_bodies(int numFrusta, float planes[], float corners[], int maxBodies,
+		hkpRigidBody** bodies, int* masks)
+	{
+		TRACE_EXPORT(cull_bodies);
+
+		world->markForRead();
+
+		int count = frustumCuller.cull(world, numFrusta, planes, corners, maxBodies, bodies, masks);
+
+		world->unmarkForRead();
+
+		return count;
+	}
+
+	// The snapshot_ queries run against the state at the end of the last completed update, and can be
+	// called from any thread, including while update is running on another one
+
+	// Returns whether the ray from 'from' to 'to' hits a body, and if so, writes the closest body, the
+	// fraction of the ray to the hit point and the surface normal there
+	__declspec(dllexport) bool snapshot_cast_ray(float from[], float to[], hkpRigidBody** body, float* hitFraction,
+		float* normal)
+	{
+		TRACE_EXPORT(snapshot_cast_ray);
+
+		hkVector4 _from(from[0], from[1], from[2]);
+		hkVector4 _to(to[0], to[1], to[2]);
+		return querySnapshot.castRay(_from, _to, body, hitFraction, normal);
+	}
+
+	// Writes the bodies whose AABBs overlap the box from 'min' to 'max', and returns their number
+	__declspec(dllexport) int snapshot_overlap_aabb(float min[], float max[], int maxBodies, hkpRigidBody** bodies)
+	{
+		TRACE_EXPORT(snapshot_overlap_aabb);
+
+		hkAabb aabb;
+		aabb.m_min.set(min[0], min[1], min[2]);
+		aabb.m_max.set(max[0], max[1], max[2]);
+		return querySnapshot.overlapAabb(aabb, maxBodies, bodies);
+	}
+
+	// Returns whether a body's AABB is within 'maxDistance' of 'point', and if so, writes the closest 
+	// body and its distance
+	__declspec(dllexport) bool snapshot_nearest_body(float point[], float maxDistance, hkpRigidBody** body, 
+		float* distance)
+	{
+		TRACE_EXPORT(snapshot_nearest_body);
+
+		hkVector4 _point(point[0], point[1], point[2]);
+		return querySnapshot.nearestBody(_point, maxDistance, body, distance);
+	}
+
 	__declspec(dllexport) void dispose()
 	{
+		TRACE_EXPORT(dispose);
+
+		// Clearing the snapshot releases the bodies and shapes the destructible objects and depth
+		// fields retire
+		while(destructibles.getSize() > 0)
+			removeDestructible(destructibles[0]);
+		for(int i = 0; i < depthFields.getSize(); ++i)
+			delete depthFields[i];
+		depthFields.clear();
+		querySnapshot.clear();
+
+		for(int i = 0; i < vehicles.getSize(); ++i)
+			vehicles[i]->removeReference();
+		vehicles.clear();
+
+		pendingBreaks.clear();
+		snapshotDeferred = false;
+
+		shapeCooker.stop();
+		while(pendingBodies.getSize() > 0)
+			cancelPendingBody(pendingBodies[0].body);
+		if(placeholderShape != HK_NULL)
+		{
+			placeholderShape->removeReference();
+			placeholderShape = HK_NULL;
+		}
+
 		world->removeAll();
 		world->removeReference();
 	}
@@ -0,0 +1,205 @@
+/************************************************************************************ 
+ * Copyright (c) 2008-2012, Columbia University
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the Columbia University nor the
+ *       names of its contributors may be used to endorse or promote products
+ *       derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY COLUMBIA UNIVERSITY ''AS IS'' AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL <copyright holder> BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * 
+ * 
+ * ===================================================================================
+ * Author: Ohan Oda (ohan@cs.columbia.edu)
+ * 
+ *************************************************************************************/
+
+#pragma once
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <Physics/Collide/Shape/Compound/Collection/ExtendedMeshShape/hkpExtendedMeshShape.h>
+#include <Physics/Collide/Shape/Compound/Tree/Mopp/hkpMoppBvTreeShape.h>
+#include <Physics/Collide/Shape/Compound/Tree/Mopp/hkpMoppUtility.h>
+#include <Physics/Collide/Util/Welding/hkpMeshWeldingUtility.h>
+
+// An extended mesh shape that owns a packed copy of the vertex and index data it references
+class OwnedMeshShape : public hkpExtendedMeshShape
+{
+public:
+
+	OwnedMeshShape(float convexRadius) : hkpExtendedMeshShape(convexRadius)
+	{
+		vertexData = NULL;
+		indexData = NULL;
+	}
+
+	~OwnedMeshShape()
+	{
+		delete[] vertexData;
+		delete[] indexData;
+	}
+
+	float* vertexData;
+	char* indexData;
+};
+
+struct WeldVertex
+{
+	float position[3];
+	int index;
+};
+
+// Orders vertices by position, and vertices at the same position by index
+static int compareWeldVertices(const void* a, const void* b)
+{
+	const WeldVertex* va = (const WeldVertex*)a;
+	const WeldVertex* vb = (const WeldVertex*)b;
+	for(int k = 0; k < 3; ++k)
+	{
+		if(va->position[k] != vb->position[k])
+			return (va->position[k] < vb->position[k]) ? -1 : 1;
+	}
+	return va->index - vb->index;
+}
+
+// Merges the packed vertices that have exactly the same position, such as the copies an interleaved
+// buffer makes of a corner for each of its normals or texture coordinates, and rewrites the indices
+// to match. The vertices that are kept stay in order at the front of 'vertices'. Returns how many
+// are kept.
+static int weldDuplicateVertices(float* vertices, int numVertices, char* indices, int numIndices, int indexSize)
+{
+	WeldVertex* sorted = new WeldVertex[numVertices];
+	for(int i = 0; i < numVertices; ++i)
+	{
+		memcpy(sorted[i].position, vertices + i * 3, sizeof(float) * 3);
+		sorted[i].index = i;
+	}
+	qsort(sorted, numVertices, sizeof(WeldVertex), compareWeldVertices);
+
+	// Every vertex first maps to the lowest index at its position, and then to where that one moves
+	int* remap = new int[numVertices];
+	for(int i = 0; i < numVertices; ++i)
+	{
+		bool same = (i > 0) && sorted[i].position[0] == sorted[i - 1].position[0] && 
+			sorted[i].position[1] == sorted[i - 1].position[1] && sorted[i].position[2] == sorted[i - 1].position[2];
+		remap[sorted[i].index] = same ? remap[sorted[i - 1].index] : sorted[i].index;
+	}
+
+	int kept = 0;
+	for(int i = 0; i < numVertices; ++i)
+	{
+		if(remap[i] == i)
+		{
+			memmove(vertices + kept * 3, vertices + i * 3, sizeof(float) * 3);
+			remap[i] = kept++;
+		}
+		else
+			remap[i] = remap[remap[i]];
+	}
+
+	for(int i = 0; i < numIndices; ++i)
+	{
+		if(indexSize == 2)
+			((unsigned short*)indices)[i] = (unsigned short)remap[((unsigned short*)indices)[i]];
+		else
+			((int*)indices)[i] = remap[((int*)indices)[i]];
+	}
+
+	delete[] sorted;
+	delete[] remap;
+	return kept;
+}
+
+// Creates a MOPP accelerated triangle mesh from vertices that are 'vertexStride' bytes apart and
+// 16 or 32 bit triangle indices ('indexSize' of 2 or 4). Unless 'copyData' is set, the mesh references
+// the given buffers, which must then stay valid and unmoved for the lifetime of the shape. When the
+// data is copied, the vertices are packed and multiplied by 'scale' if it is not NULL, and vertices
+// at the same position are merged if 'weldVertices' is set. Since both change the data, a referenced
+// mesh cannot have either, and NULL is returned if one is asked for. 'weldEdges' welds the contact
+// normals across neighboring triangles.
+static hkpShape* createStridedMesh(int numVertices, const char* vertices, int vertexStride, int numTriangles,
+	const char* indices, int indexSize, const float* scale, bool copyData, bool weldEdges, bool weldVertices, 
+	float convexRadius)
+{
+	hkpExtendedMeshShape* mesh;
+	hkpExtendedMeshShape::TrianglesSubpart part;
+
+	if(!copyData && (scale != NULL || weldVertices))
+		return HK_NULL;
+
+	if(copyData)
+	{
+		OwnedMeshShape* owned = new OwnedMeshShape(convexRadius);
+
+		owned->vertexData = new float[numVertices * 3];
+		for(int i = 0; i < numVertices; ++i)
+		{
+			const float* v = (const float*)(vertices + i * vertexStride);
+			float* dst = owned->vertexData + i * 3;
+			if(scale != NULL)
+			{
+				dst[0] = v[0] * scale[0];
+				dst[1] = v[1] * scale[1];
+				dst[2] = v[2] * scale[2];
+			}
+			else
+				memcpy(dst, v, sizeof(float) * 3);
+		}
+
+		owned->indexData = new char[numTriangles * 3 * indexSize];
+		memcpy(owned->indexData, indices, numTriangles * 3 * indexSize);
+
+		if(weldVertices)
+			numVertices = weldDuplicateVertices(owned->vertexData, numVertices, owned->indexData, numTriangles * 3, 
+				indexSize);
+
+		vertices = (const char*)owned->vertexData;
+		vertexStride = sizeof(float) * 3;
+		indices = owned->indexData;
+		mesh = owned;
+	}
+	else
+		mesh = new hkpExtendedMeshShape(convexRadius);
+
+	part.m_vertexBase = (const float*)vertices;
+	part.m_vertexStriding = vertexStride;
+	part.m_numVertices = numVertices;
+
+	part.m_indexBase = indices;
+	part.m_indexStriding = indexSize * 3;
+	part.m_numTriangleShapes = numTriangles;
+	part.m_stridingType = (indexSize == 2) ? hkpExtendedMeshShape::INDICES_INT16 : 
+		hkpExtendedMeshShape::INDICES_INT32;
+
+	mesh->addTrianglesSubpart(part);
+
+	hkpMoppCompilerInput moppInput;
+	hkpMoppCode* code = hkpMoppUtility::buildCode(mesh, moppInput);
+	hkpMoppBvTreeShape* tree = new hkpMoppBvTreeShape(mesh, code);
+	code->removeReference();
+	mesh->removeReference();
+
+	// Welds the contact normals across neighboring triangles so objects do not bump on the inner edges
+	if(weldEdges)
+		hkpMeshWeldingUtility::computeWeldingInfo(mesh, tree, hkpWeldingUtility::WELDING_TYPE_ANTICLOCKWISE);
+
+	return tree;
+}
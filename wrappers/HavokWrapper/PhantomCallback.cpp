@@ -36,6 +36,8 @@
 
 #include <Physics/Dynamics/Entity/hkpRigidBody.h>
 
+#include "Tracepoints.cpp"
+
 typedef void (*phantomEnterCallback)(hkpRigidBody* body);
 typedef void (*phantomLeaveCallback)(hkpRigidBody* body);
 
@@ -58,7 +60,9 @@ public:
 		if(enterEvent != NULL)
 		{
 			hkpRigidBody* owner = hkpGetRigidBody(collidableB);
+			TRACE_PROBE(phantom_enter_callback__start);
 			enterEvent(owner);
+			TRACE_PROBE(phantom_enter_callback__done);
 		}
 	}
 
@@ -68,7 +72,9 @@ public:
 		if(leaveEvent != NULL)
 		{
 			hkpRigidBody* owner = hkpGetRigidBody(collidableB);
+			TRACE_PROBE(phantom_leave_callback__start);
 			leaveEvent(owner);
+			TRACE_PROBE(phantom_leave_callback__done);
 		}
 	}
 };
\ No newline at end of file
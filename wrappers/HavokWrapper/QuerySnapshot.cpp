@@ -0,0 +1,337 @@
+/************************************************************************************ 
+ * Copyright (c) 2008-2012, Columbia University
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the Columbia University nor the
+ *       names of its contributors may be used to endorse or promote products
+ *       derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY COLUMBIA UNIVERSITY ''AS IS'' AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL <copyright holder> BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * 
+ * 
+ * ===================================================================================
+ * Author: Ohan Oda (ohan@cs.columbia.edu)
+ * 
+ *************************************************************************************/
+
+#pragma once
+
+#include <stdlib.h>
+#include <intrin.h>
+
+#include <Common/Base/Thread/CriticalSection/hkCriticalSection.h>
+
+#include <Physics/Collide/Shape/Query/hkpShapeRayCastInput.h>
+#include <Physics/Collide/Shape/Query/hkpShapeRayCastOutput.h>
+#include <Physics/Internal/Collide/BroadPhase/hkpBroadPhase.h>
+
+#include <Physics/Dynamics/World/hkpWorld.h>
+#include <Physics/Dynamics/World/hkpSimulationIsland.h>
+#include <Physics/Dynamics/Entity/hkpRigidBody.h>
+
+#define SNAPSHOT_BUFFERS 3
+
+// A read-only copy of the bodies' shapes, transforms and broadphase AABBs, published at the end of
+// every step. Queries run against the last published copy from any thread without locking the world,
+// so they never wait for, or see a partial result of, a step in progress.
+//
+// The copies are triple buffered. A reader pins the latest buffer with a reader count, and the
+// writer only refills a buffer that is neither the latest nor pinned, skipping the publish if there
+// is none. Removed bodies, and shapes their owners stopped referencing, are kept alive until no
+// buffer refers to them anymore.
+class QuerySnapshot
+{
+public:
+
+	QuerySnapshot() : retireLock(0)
+	{
+		latest = -1;
+		publishCount = 0;
+		for(int i = 0; i < SNAPSHOT_BUFFERS; ++i)
+		{
+			buffers[i].readers = 0;
+			buffers[i].publishedAt = 0;
+		}
+	}
+
+	// Called by the stepping thread while the world is marked for read
+	void publish(hkpWorld* world)
+	{
+		int target = -1;
+		for(int i = 0; i < SNAPSHOT_BUFFERS && target < 0; ++i)
+			if(i != latest && buffers[i].readers == 0)
+				target = i;
+		if(target < 0)
+			return;
+
+		Buffer& buffer = buffers[target];
+		buffer.bodies.clear();
+
+		const hkpBroadPhase* broadPhase = world->getBroadPhase();
+		addIslands(world->getActiveSimulationIslands(), broadPhase, buffer);
+		addIslands(world->getInactiveSimulationIslands(), broadPhase, buffer);
+		addEntities(world->getFixedIsland()->getEntities(), broadPhase, buffer);
+
+		buffer.publishedAt = ++publishCount;
+		_InterlockedExchange(&latest, target);
+
+		releaseRetired();
+	}
+
+	// Keeps a body that is about to be removed from the world, or a shape that a published body may
+	// still use, alive for the readers
+	void retire(hkReferencedObject* object)
+	{
+		object->addReference();
+
+		retireLock.enter();
+		retired.pushBack(object);
+		retiredAt.pushBack(publishCount);
+		retireLock.leave();
+	}
+
+	void clear()
+	{
+		retireLock.enter();
+		for(int i = 0; i < retired.getSize(); ++i)
+			retired[i]->removeReference();
+		retired.clear();
+		retiredAt.clear();
+		retireLock.leave();
+
+		_InterlockedExchange(&latest, -1);
+		for(int i = 0; i < SNAPSHOT_BUFFERS; ++i)
+			buffers[i].bodies.clear();
+	}
+
+	// Finds the closest body hit by the ray from 'from' to 'to', testing the exact shape of the 
+	// bodies whose AABBs the ray enters
+	bool castRay(const hkVector4& from, const hkVector4& to, hkpRigidBody** hitBody, float* hitFraction, 
+		float* normal)
+	{
+		int index = acquire();
+		if(index < 0)
+			return false;
+
+		const hkArray<BodyState>& bodies = buffers[index].bodies;
+		hkVector4 dir;
+		dir.setSub4(to, from);
+
+		hkReal best = 1;
+		bool hit = false;
+		for(int i = 0; i < bodies.getSize(); ++i)
+		{
+			const BodyState& state = bodies[i];
+			if(!rayHitsAabb(from, dir, state.aabb, best))
+				continue;
+
+			hkpShapeRayCastInput input;
+			input.m_from.setTransformedInversePos(state.transform, from);
+			input.m_to.setTransformedInversePos(state.transform, to);
+
+			hkpShapeRayCastOutput output;
+			output.m_hitFraction = best;
+			if(state.shape->castRay(input, output) && output.m_hitFraction < best)
+			{
+				best = output.m_hitFraction;
+				hkVector4 worldNormal;
+				worldNormal.setRotatedDir(state.transform.getRotation(), output.m_normal);
+				normal[0] = worldNormal(0);
+				normal[1] = worldNormal(1);
+				normal[2] = worldNormal(2);
+				*hitBody = state.body;
+				hit = true;
+			}
+		}
+
+		release(index);
+
+		*hitFraction = best;
+		return hit;
+	}
+
+	// Writes the bodies whose AABBs overlap the given box, and returns their number
+	int overlapAabb(const hkAabb& aabb, int maxBodies, hkpRigidBody** result)
+	{
+		int index = acquire();
+		if(index < 0)
+			return 0;
+
+		const hkArray<BodyState>& bodies = buffers[index].bodies;
+		int count = 0;
+		for(int i = 0; i < bodies.getSize() && count < maxBodies; ++i)
+			if(bodies[i].aabb.overlaps(aabb))
+				result[count++] = bodies[i].body;
+
+		release(index);
+
+		return count;
+	}
+
+	// Finds the body whose AABB is closest to 'point' within 'maxDistance'
+	bool nearestBody(const hkVector4& point, float maxDistance, hkpRigidBody** nearest, float* distance)
+	{
+		int index = acquire();
+		if(index < 0)
+			return false;
+
+		const hkArray<BodyState>& bodies = buffers[index].bodies;
+		hkReal best = maxDistance * maxDistance;
+		bool found = false;
+		for(int i = 0; i < bodies.getSize(); ++i)
+		{
+			hkVector4 closest;
+			closest.setMax4(point, bodies[i].aabb.m_min);
+			closest.setMin4(closest, bodies[i].aabb.m_max);
+			closest.sub4(point);
+
+			hkReal d = closest.lengthSquared3();
+			if(d <= best)
+			{
+				best = d;
+				*nearest = bodies[i].body;
+				found = true;
+			}
+		}
+
+		release(index);
+
+		*distance = hkMath::sqrt(best);
+		return found;
+	}
+
+private:
+
+	struct BodyState
+	{
+		hkTransform transform;
+		hkAabb aabb;
+		const hkpShape* shape;
+		hkpRigidBody* body;
+	};
+
+	struct Buffer
+	{
+		hkArray<BodyState> bodies;
+		volatile long readers;
+		int publishedAt;
+	};
+
+	int acquire()
+	{
+		while(true)
+		{
+			long index = latest;
+			if(index < 0)
+				return -1;
+
+			_InterlockedIncrement(&buffers[index].readers);
+			if(latest == index)
+				return index;
+
+			// The writer published another buffer in between, and may be refilling this one
+			_InterlockedDecrement(&buffers[index].readers);
+		}
+	}
+
+	void release(int index)
+	{
+		_InterlockedDecrement(&buffers[index].readers);
+	}
+
+	void addIslands(const hkArray<hkpSimulationIsland*>& islands, const hkpBroadPhase* broadPhase, Buffer& buffer)
+	{
+		for(int i = 0; i < islands.getSize(); ++i)
+			addEntities(islands[i]->getEntities(), broadPhase, buffer);
+	}
+
+	void addEntities(const hkArray<hkpEntity*>& entities, const hkpBroadPhase* broadPhase, Buffer& buffer)
+	{
+		for(int i = 0; i < entities.getSize(); ++i)
+		{
+			hkpRigidBody* body = static_cast<hkpRigidBody*>(entities[i]);
+			const hkpCollidable* collidable = body->getCollidable();
+
+			BodyState& state = buffer.bodies.expandOne();
+			state.body = body;
+			state.shape = collidable->getShape();
+			state.transform = body->getTransform();
+			broadPhase->getAabb(collidable->getBroadPhaseHandle(), state.aabb);
+		}
+	}
+
+	// Slab test of the ray against the box, which passes if the ray enters it before 'maxFraction'
+	static bool rayHitsAabb(const hkVector4& from, const hkVector4& dir, const hkAabb& aabb, hkReal maxFraction)
+	{
+		hkReal tMin = 0, tMax = maxFraction;
+		for(int axis = 0; axis < 3; ++axis)
+		{
+			hkReal d = dir(axis);
+			if(hkMath::fabs(d) < HK_REAL_EPSILON)
+			{
+				if(from(axis) < aabb.m_min(axis) || from(axis) > aabb.m_max(axis))
+					return false;
+				continue;
+			}
+
+			hkReal t0 = (aabb.m_min(axis) - from(axis)) / d;
+			hkReal t1 = (aabb.m_max(axis) - from(axis)) / d;
+			if(t0 > t1)
+			{
+				hkReal t = t0; t0 = t1; t1 = t;
+			}
+			if(t0 > tMin)
+				tMin = t0;
+			if(t1 < tMax)
+				tMax = t1;
+			if(tMin > tMax)
+				return false;
+		}
+		return true;
+	}
+
+	// Releases the retired objects that every buffer has been refilled without
+	void releaseRetired()
+	{
+		int oldest = buffers[0].publishedAt;
+		for(int i = 1; i < SNAPSHOT_BUFFERS; ++i)
+			if(buffers[i].publishedAt < oldest)
+				oldest = buffers[i].publishedAt;
+
+		retireLock.enter();
+		for(int i = retired.getSize() - 1; i >= 0; --i)
+		{
+			if(retiredAt[i] < oldest)
+			{
+				retired[i]->removeReference();
+				retired.removeAt(i);
+				retiredAt.removeAt(i);
+			}
+		}
+		retireLock.leave();
+	}
+
+	Buffer buffers[SNAPSHOT_BUFFERS];
+	volatile long latest;
+	int publishCount;
+
+	hkCriticalSection retireLock;
+	hkArray<hkReferencedObject*> retired;
+	hkArray<int> retiredAt;
+};
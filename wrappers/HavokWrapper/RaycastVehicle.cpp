@@ -0,0 +1,269 @@
+/************************************************************************************ 
+ * Copyright (c) 2008-2012, Columbia University
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the Columbia University nor the
+ *       names of its contributors may be used to endorse or promote products
+ *       derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY COLUMBIA UNIVERSITY ''AS IS'' AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL <copyright holder> BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * 
+ * 
+ * ===================================================================================
+ * Author: Ohan Oda (ohan@cs.columbia.edu)
+ * 
+ *************************************************************************************/
+
+#include <stdlib.h>
+#include <math.h>
+
+#include <Physics/Collide/Query/CastUtil/hkpWorldRayCastInput.h>
+#include <Physics/Collide/Query/Collector/RayCollector/hkpRayHitCollector.h>
+#include <Physics/Collide/Shape/Query/hkpShapeRayCastCollectorOutput.h>
+
+#include <Physics/Dynamics/World/hkpWorld.h>
+#include <Physics/Dynamics/Entity/hkpRigidBody.h>
+#include <Physics/Dynamics/Action/hkpUnaryAction.h>
+
+// Number of floats describing a wheel: hard point (3), suspension rest length, stiffness, damping,
+// radius, friction, steering factor and drive factor
+#define WHEEL_PARAMS 10
+
+// Keeps the closest hit of a ray that does not belong to the ignored collidable
+class WheelRayCollector : public hkpRayHitCollector
+{
+public:
+
+	WheelRayCollector(const hkpCollidable* _ignore)
+	{
+		ignore = _ignore;
+		hit = false;
+	}
+
+	virtual void addRayHit( const hkpCdBody& cdBody, const hkpShapeRayCastCollectorOutput& hitInfo )
+	{
+		if(cdBody.getRootCollidable() == ignore || hitInfo.m_hitFraction >= m_earlyOutHitFraction)
+			return;
+
+		m_earlyOutHitFraction = hitInfo.m_hitFraction;
+		normal = hitInfo.m_normal;
+		hit = true;
+	}
+
+	const hkpCollidable* ignore;
+	bool hit;
+	hkVector4 normal;
+};
+
+// A vehicle whose wheels are rays cast down from hard points on the chassis. The suspension, tire
+// and drive forces are applied to the chassis from inside the simulation step, so a vehicle costs
+// no managed calls per wheel. The chassis is expected to face -Z with +Y up in its local space.
+class RaycastVehicle : public hkpUnaryAction
+{
+public:
+
+	RaycastVehicle(hkpRigidBody* chassis, int _numWheels, const float* wheelParams) : hkpUnaryAction(chassis)
+	{
+		numWheels = _numWheels;
+		wheels.setSize(numWheels);
+		for(int i = 0; i < numWheels; ++i)
+		{
+			const float* p = wheelParams + i * WHEEL_PARAMS;
+			Wheel& wheel = wheels[i];
+			wheel.hardPoint.set(p[0], p[1], p[2]);
+			wheel.restLength = p[3];
+			wheel.stiffness = p[4];
+			wheel.damping = p[5];
+			wheel.radius = p[6];
+			wheel.friction = p[7];
+			wheel.steerFactor = p[8];
+			wheel.driveFactor = p[9];
+			wheel.length = wheel.restLength;
+			wheel.spin = 0;
+		}
+
+		steering = 0;
+		driveForce = 0;
+		brakeForce = 0;
+	}
+
+	void setInput(const float* input)
+	{
+		steering = input[0];
+		driveForce = input[1];
+		brakeForce = input[2];
+	}
+
+	virtual void applyAction( const hkStepInfo& stepInfo )
+	{
+		hkpRigidBody* chassis = getRigidBody();
+		const hkTransform& transform = chassis->getTransform();
+		const hkRotation& rot = transform.getRotation();
+		hkReal dt = stepInfo.m_deltaTime;
+
+		hkVector4 up = rot.getColumn(1);
+		hkVector4 forward;
+		forward.setNeg4(rot.getColumn(2));
+
+		// The chassis mass is shared by the wheels when cancelling sliding
+		hkReal massPerWheel = chassis->getMass() / numWheels;
+
+		for(int i = 0; i < numWheels; ++i)
+		{
+			Wheel& wheel = wheels[i];
+
+			hkVector4 from;
+			from.setTransformedPos(transform, wheel.hardPoint);
+			hkReal rayLength = wheel.restLength + wheel.radius;
+
+			hkpWorldRayCastInput input;
+			input.m_from = from;
+			input.m_to.setAddMul4(from, up, -rayLength);
+
+			WheelRayCollector collector(chassis->getCollidable());
+			chassis->getWorld()->castRay(input, collector);
+
+			hkReal angle = steering * wheel.steerFactor;
+			wheel.forward.setMul4(cos(angle), forward);
+			hkVector4 lateral;
+			lateral.setCross(up, forward);
+			wheel.forward.addMul4(sin(angle), lateral);
+
+			if(!collector.hit)
+			{
+				wheel.length = wheel.restLength;
+				continue;
+			}
+
+			hkReal distance = collector.m_earlyOutHitFraction * rayLength;
+			wheel.length = distance - wheel.radius;
+			if(wheel.length < 0)
+				wheel.length = 0;
+
+			hkVector4 contact;
+			contact.setAddMul4(from, up, -distance);
+
+			hkVector4 velocity;
+			chassis->getPointVelocity(contact, velocity);
+
+			// Spring and damper along the chassis up axis
+			hkReal compression = rayLength - distance;
+			hkReal load = wheel.stiffness * compression - wheel.damping * velocity.dot3(up);
+			if(load <= 0)
+				continue;
+
+			hkVector4 force;
+			force.setMul4(load, up);
+			chassis->applyForce(dt, force, contact);
+
+			// Tire forces in the ground plane, limited by the friction circle
+			hkVector4 side;
+			side.setCross(wheel.forward, collector.normal);
+			side.normalize3();
+			hkVector4 rolling;
+			rolling.setCross(collector.normal, side);
+
+			hkReal sideForce = -velocity.dot3(side) * massPerWheel / dt;
+			hkReal rollingSpeed = velocity.dot3(rolling);
+			hkReal rollingForce = driveForce * wheel.driveFactor;
+			if(rollingSpeed > 0)
+				rollingForce -= brakeForce;
+			else if(rollingSpeed < 0)
+				rollingForce += brakeForce;
+
+			hkReal maxForce = wheel.friction * load;
+			hkReal total = sqrt(sideForce * sideForce + rollingForce * rollingForce);
+			if(total > maxForce)
+			{
+				sideForce *= maxForce / total;
+				rollingForce *= maxForce / total;
+			}
+
+			force.setMul4(sideForce, side);
+			force.addMul4(rollingForce, rolling);
+			chassis->applyForce(dt, force, contact);
+
+			wheel.spin += rollingSpeed / wheel.radius * dt;
+		}
+	}
+
+	// Writes the world transform of each wheel as a column-major 4x4 matrix
+	void getWheelTransforms(float* transforms)
+	{
+		const hkTransform& transform = getRigidBody()->getTransform();
+		hkQuaternion chassisRot(transform.getRotation());
+		hkVector4 up = transform.getRotation().getColumn(1);
+		hkVector4 xAxis(1, 0, 0);
+		hkVector4 yAxis(0, 1, 0);
+
+		for(int i = 0; i < numWheels; ++i)
+		{
+			Wheel& wheel = wheels[i];
+
+			hkQuaternion steer(yAxis, steering * wheel.steerFactor);
+			hkQuaternion spin(xAxis, -wheel.spin);
+			hkQuaternion local;
+			local.setMul(steer, spin);
+			hkQuaternion rot;
+			rot.setMul(chassisRot, local);
+
+			hkVector4 pos;
+			pos.setTransformedPos(transform, wheel.hardPoint);
+			pos.addMul4(-wheel.length, up);
+
+			hkTransform wheelTransform(rot, pos);
+			wheelTransform.get4x4ColumnMajor(transforms + i * 16);
+		}
+	}
+
+	virtual hkpAction* clone( const hkArray<hkpEntity*>& newEntities, const hkArray<hkpPhantom*>& newPhantoms ) const
+	{
+		return HK_NULL;
+	}
+
+public:
+
+	int numWheels;
+
+private:
+
+	struct Wheel
+	{
+		hkVector4 hardPoint;
+		hkReal restLength;
+		hkReal stiffness;
+		hkReal damping;
+		hkReal radius;
+		hkReal friction;
+		hkReal steerFactor;
+		hkReal driveFactor;
+
+		// Current suspension length, steered forward direction and accumulated rotation
+		hkReal length;
+		hkVector4 forward;
+		hkReal spin;
+	};
+
+	// hkArray keeps the vectors 16 byte aligned
+	hkArray<Wheel> wheels;
+
+	hkReal steering;
+	hkReal driveForce;
+	hkReal brakeForce;
+};
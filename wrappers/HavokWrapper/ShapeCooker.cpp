@@ -0,0 +1,327 @@
+/************************************************************************************ 
+ * Copyright (c) 2008-2012, Columbia University
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the Columbia University nor the
+ *       names of its contributors may be used to endorse or promote products
+ *       derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY COLUMBIA UNIVERSITY ''AS IS'' AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL <copyright holder> BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * 
+ * 
+ * ===================================================================================
+ * Author: Ohan Oda (ohan@cs.columbia.edu)
+ * 
+ *************************************************************************************/
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <Common/Base/hkBase.h>
+#include <Common/Base/System/hkBaseSystem.h>
+#include <Common/Base/Memory/System/hkMemorySystem.h>
+#include <Common/Base/Thread/Thread/hkThread.h>
+#include <Common/Base/Thread/Semaphore/hkSemaphore.h>
+#include <Common/Base/Thread/CriticalSection/hkCriticalSection.h>
+#include <Common/Internal/ConvexHull/hkGeometryUtility.h>
+
+#include <Physics/Collide/Shape/Convex/ConvexVertices/hkpConvexVerticesShape.h>
+
+#include "MeshShape.cpp"
+
+// Builds the convex hull of a point cloud whose points are 'stride' bytes apart
+static hkpShape* createConvexHull(int numVertices, const float* vertices, int stride, float convexRadius)
+{
+	hkStridedVertices stridedVerts;
+	stridedVerts.m_numVertices = numVertices;
+	stridedVerts.m_striding = stride;
+	stridedVerts.m_vertices = vertices;
+
+	hkGeometry geometry;
+	hkInplaceArrayAligned16<hkVector4,32> transformedPlanes;
+
+	hkGeometryUtility::createConvexGeometry(stridedVerts, geometry, transformedPlanes);
+
+	stridedVerts.m_numVertices = geometry.m_vertices.getSize();
+	stridedVerts.m_striding = sizeof(hkVector4);
+	stridedVerts.m_vertices = &(geometry.m_vertices[0](0));
+
+	return new hkpConvexVerticesShape(stridedVerts, transformedPlanes, convexRadius);
+}
+
+// A collision shape that is queued on, or being built by, the ShapeCooker. The handle is shared by
+// the caller and the cooker, and is deleted when both have released it, so the caller may release
+// it before the shape is ready.
+class PendingShape
+{
+public:
+
+	enum Kind
+	{
+		CONVEX_HULL,
+		STRIDED_MESH
+	};
+
+	PendingShape(Kind _kind) : done(0, 1)
+	{
+		kind = _kind;
+		numVertices = 0;
+		numTriangles = 0;
+		indexSize = 0;
+		weldEdges = false;
+		weldVertices = false;
+		convexRadius = 0;
+
+		shape = HK_NULL;
+		ready = false;
+		references = 2;
+	}
+
+	// Builds the shape from the copied input data. Runs on the cooker's worker thread.
+	hkpShape* build()
+	{
+		if(kind == CONVEX_HULL)
+			return createConvexHull(numVertices, &vertices[0], sizeof(float) * 3, convexRadius);
+
+		return createStridedMesh(numVertices, (const char*)&vertices[0], sizeof(float) * 3, numTriangles,
+			&indices[0], indexSize, HK_NULL, true, weldEdges, weldVertices, convexRadius);
+	}
+
+	Kind kind;
+
+	// Packed copies of the input, freed once the shape is built
+	hkArray<float> vertices;
+	hkArray<char> indices;
+	int numVertices;
+	int numTriangles;
+	int indexSize;
+	bool weldEdges;
+	bool weldVertices;
+	float convexRadius;
+
+	// Guarded by the cooker's lock
+	hkpShape* shape;
+	bool ready;
+	int references;
+
+	// Released once when the shape is ready
+	hkSemaphore done;
+};
+
+// Builds convex hulls and MOPP accelerated meshes on a worker thread, so that spawning complex
+// objects does not stall the thread that steps the simulation. The worker is started by the first
+// request and serves the requests in order. It has to be stopped before the DLL is unloaded, since
+// threads cannot be joined from static destructors.
+class ShapeCooker
+{
+public:
+
+	ShapeCooker() : jobsAvailable(0, 1 << 20)
+	{
+		thread = HK_NULL;
+		stopping = false;
+	}
+
+	PendingShape* cookConvexHull(int numVertices, const float* vertices, int stride, float convexRadius)
+	{
+		PendingShape* job = new PendingShape(PendingShape::CONVEX_HULL);
+		job->numVertices = numVertices;
+		job->convexRadius = convexRadius;
+		job->vertices.setSize(numVertices * 3);
+		for(int i = 0; i < numVertices; ++i)
+			memcpy(&job->vertices[i * 3], (const char*)vertices + i * stride, sizeof(float) * 3);
+
+		enqueue(job);
+		return job;
+	}
+
+	// The mesh always owns a copy of the data, packed and multiplied by 'scale' if it is not NULL
+	PendingShape* cookStridedMesh(int numVertices, const char* vertices, int vertexStride, int numTriangles,
+		const char* indices, int indexSize, const float* scale, bool weldEdges, bool weldVertices, 
+		float convexRadius)
+	{
+		PendingShape* job = new PendingShape(PendingShape::STRIDED_MESH);
+		job->numVertices = numVertices;
+		job->numTriangles = numTriangles;
+		job->indexSize = indexSize;
+		job->weldEdges = weldEdges;
+		job->weldVertices = weldVertices;
+		job->convexRadius = convexRadius;
+
+		job->vertices.setSize(numVertices * 3);
+		for(int i = 0; i < numVertices; ++i)
+		{
+			const float* v = (const float*)(vertices + i * vertexStride);
+			float* dst = &job->vertices[i * 3];
+			for(int k = 0; k < 3; ++k)
+				dst[k] = (scale != HK_NULL) ? v[k] * scale[k] : v[k];
+		}
+
+		job->indices.setSize(numTriangles * 3 * indexSize);
+		memcpy(&job->indices[0], indices, numTriangles * 3 * indexSize);
+
+		enqueue(job);
+		return job;
+	}
+
+	bool isReady(PendingShape* job)
+	{
+		lock.enter();
+		bool ready = job->ready;
+		lock.leave();
+		return ready;
+	}
+
+	// Blocks until the shape is ready
+	void wait(PendingShape* job)
+	{
+		job->done.acquire();
+		job->done.release();
+	}
+
+	// Takes the shape out of a ready handle and releases the handle. The caller owns the returned
+	// reference, which is NULL if the cooker was stopped before building it.
+	hkpShape* take(PendingShape* job)
+	{
+		lock.enter();
+		hkpShape* shape = job->shape;
+		job->shape = HK_NULL;
+		lock.leave();
+
+		release(job);
+		return shape;
+	}
+
+	// Gives up the caller's share of the handle. A shape that is not built yet is discarded.
+	void release(PendingShape* job)
+	{
+		lock.enter();
+		bool orphaned = (--job->references == 0);
+		lock.leave();
+
+		if(orphaned)
+			destroy(job);
+	}
+
+	// Discards the queued requests and stops the worker after the shape it is building
+	void stop()
+	{
+		if(thread == HK_NULL)
+			return;
+
+		lock.enter();
+		stopping = true;
+		for(int i = 0; i < queue.getSize(); ++i)
+			finish(queue[i], HK_NULL);
+		queue.clear();
+		lock.leave();
+
+		jobsAvailable.release();
+		thread->joinThread();
+		delete thread;
+		thread = HK_NULL;
+		stopping = false;
+	}
+
+private:
+
+	void enqueue(PendingShape* job)
+	{
+		lock.enter();
+		queue.pushBack(job);
+		lock.leave();
+
+		if(thread == HK_NULL)
+		{
+			thread = new hkThread();
+			thread->startThread(workerMain, this, "ShapeCooker");
+		}
+		jobsAvailable.release();
+	}
+
+	// Publishes the result and drops the cooker's share of the handle. Called with the lock held.
+	void finish(PendingShape* job, hkpShape* shape)
+	{
+		job->shape = shape;
+		job->ready = true;
+		job->vertices.clearAndDeallocate();
+		job->indices.clearAndDeallocate();
+
+		if(--job->references == 0)
+			destroy(job);
+		else
+			job->done.release();
+	}
+
+	static void destroy(PendingShape* job)
+	{
+		if(job->shape != HK_NULL)
+			job->shape->removeReference();
+		delete job;
+	}
+
+	static void* HK_CALL workerMain(void* arg)
+	{
+		ShapeCooker* cooker = (ShapeCooker*)arg;
+
+		hkMemoryRouter memoryRouter;
+		hkMemorySystem::getInstance().threadInit(memoryRouter, "ShapeCooker");
+		hkBaseSystem::initThread(&memoryRouter);
+
+		while(true)
+		{
+			cooker->jobsAvailable.acquire();
+
+			cooker->lock.enter();
+			if(cooker->stopping)
+			{
+				cooker->lock.leave();
+				break;
+			}
+			// Requests discarded by stop() leave their signals behind
+			if(cooker->queue.isEmpty())
+			{
+				cooker->lock.leave();
+				continue;
+			}
+			PendingShape* job = cooker->queue[0];
+			cooker->queue.removeAtAndCopy(0);
+
+			// Nobody is waiting for a shape whose handle was already released
+			bool wanted = (job->references > 1);
+			cooker->lock.leave();
+
+			hkpShape* shape = wanted ? job->build() : HK_NULL;
+
+			cooker->lock.enter();
+			cooker->finish(job, shape);
+			cooker->lock.leave();
+		}
+
+		hkBaseSystem::quitThread();
+		hkMemorySystem::getInstance().threadQuit(memoryRouter);
+		return HK_NULL;
+	}
+
+	hkThread* thread;
+	hkSemaphore jobsAvailable;
+	hkCriticalSection lock;
+	hkArray<PendingShape*> queue;
+	bool stopping;
+};
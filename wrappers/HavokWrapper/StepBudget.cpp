@@ -0,0 +1,97 @@
+/************************************************************************************ 
+ * Copyright (c) 2008-2012, Columbia University
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the Columbia University nor the
+ *       names of its contributors may be used to endorse or promote products
+ *       derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY COLUMBIA UNIVERSITY ''AS IS'' AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL <copyright holder> BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * 
+ * 
+ * ===================================================================================
+ * Author: Ohan Oda (ohan@cs.columbia.edu)
+ * 
+ *************************************************************************************/
+
+#include <Common/Base/System/Stopwatch/hkStopwatch.h>
+
+// Keeps the time spent in one update within a budget. The simulation step always runs. Work that
+// can wait, such as adding queued bodies or shattering broken objects, is done one item at a time
+// only while the update is within its budget, and the rest waits for the next update. The first
+// item of each kind always runs, so that the queues keep draining even when the step alone uses up
+// the budget. A budget of 0 turns this off, and all work is done in the update it is queued in.
+class StepBudget
+{
+public:
+
+	StepBudget()
+	{
+		budget = 0;
+		deferAdds = false;
+		startTicks = 0;
+		lastStepSeconds = 0;
+		lastUpdateSeconds = 0;
+	}
+
+	// If 'deferAdds' is true and the budget is on, add_rigid_body queues its bodies for update
+	void configure(float _budget, bool _deferAdds)
+	{
+		budget = (_budget < 0) ? 0 : _budget;
+		deferAdds = _deferAdds;
+	}
+
+	bool defersAdds()
+	{
+		return budget > 0 && deferAdds;
+	}
+
+	void begin()
+	{
+		startTicks = hkStopwatch::getTickCounter();
+	}
+
+	void end()
+	{
+		lastUpdateSeconds = elapsed();
+	}
+
+	// Seconds since begin()
+	float elapsed()
+	{
+		return (float)(hkStopwatch::getTickCounter() - startTicks) / (float)hkStopwatch::getTicksPerSecond();
+	}
+
+	// Whether another item may run after 'done' items of the same kind in this update, with
+	// 'reserve' seconds kept for work that still has to follow
+	bool allows(int done, float reserve = 0)
+	{
+		return budget <= 0 || done == 0 || elapsed() + reserve < budget;
+	}
+
+	// Durations of the simulation step and of the whole last update
+	float lastStepSeconds;
+	float lastUpdateSeconds;
+
+private:
+
+	float budget;
+	bool deferAdds;
+	hkUint64 startTicks;
+};
@@ -0,0 +1,106 @@
+/************************************************************************************ 
+ * Copyright (c) 2008-2012, Columbia University
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the Columbia University nor the
+ *       names of its contributors may be used to endorse or promote products
+ *       derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY COLUMBIA UNIVERSITY ''AS IS'' AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL <copyright holder> BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * 
+ * 
+ * ===================================================================================
+ * Author: Ohan Oda (ohan@cs.columbia.edu)
+ * 
+ *************************************************************************************/
+
+// Static tracepoints for tracing the Havok wrapper on a live system without rebuilding it. The
+// probes compile to nothing unless GOBLIN_TRACEPOINTS is defined. On Linux they are USDT probes of
+// the 'goblin_havok' provider, which are a single nop until perf or bpftrace attaches to them. On
+// Windows they are TraceLogging events of the 'GoblinXNA.Havok' provider, which cost a test of
+// whether a session has enabled the provider.
+//
+// Stages are bracketed by a pair of probes named 'stage__start' and 'stage__done', so that their
+// latency can be measured from the probe timestamps, and every export fires 'name__entry' and
+// 'name__return' through TRACE_EXPORT.
+
+#pragma once
+
+#ifdef GOBLIN_TRACEPOINTS
+
+#ifdef _WIN32
+
+#include <windows.h>
+#include <TraceLoggingProvider.h>
+
+TRACELOGGING_DECLARE_PROVIDER(traceProvider);
+
+// Defines the provider, and registers it when the DLL is loaded and unregisters it when it is
+// unloaded. Used once at global scope in the file that includes all of the others.
+#define TRACE_DEFINE_PROVIDER() \
+	TRACELOGGING_DEFINE_PROVIDER(traceProvider, "GoblinXNA.Havok", \
+		(0x508fb433, 0xe7b8, 0x40ba, 0x88, 0xac, 0xb2, 0x7d, 0x1c, 0xa7, 0xd3, 0x96)); \
+	static struct TraceRegistration \
+	{ \
+		TraceRegistration() { TraceLoggingRegister(traceProvider); } \
+		~TraceRegistration() { TraceLoggingUnregister(traceProvider); } \
+	} traceRegistration
+
+#define TRACE_PROBE(name) TraceLoggingWrite(traceProvider, #name)
+#define TRACE_PROBE1(name, a) TraceLoggingWrite(traceProvider, #name, TraceLoggingValue(a))
+#define TRACE_PROBE2(name, a, b) TraceLoggingWrite(traceProvider, #name, TraceLoggingValue(a), \
+	TraceLoggingValue(b))
+#define TRACE_PROBE3(name, a, b, c) TraceLoggingWrite(traceProvider, #name, TraceLoggingValue(a), \
+	TraceLoggingValue(b), TraceLoggingValue(c))
+#define TRACE_PROBE4(name, a, b, c, d) TraceLoggingWrite(traceProvider, #name, TraceLoggingValue(a), \
+	TraceLoggingValue(b), TraceLoggingValue(c), TraceLoggingValue(d))
+
+#else
+
+#include <sys/sdt.h>
+
+#define TRACE_DEFINE_PROVIDER()
+
+#define TRACE_PROBE(name) DTRACE_PROBE(goblin_havok, name)
+#define TRACE_PROBE1(name, a) DTRACE_PROBE1(goblin_havok, name, a)
+#define TRACE_PROBE2(name, a, b) DTRACE_PROBE2(goblin_havok, name, a, b)
+#define TRACE_PROBE3(name, a, b, c) DTRACE_PROBE3(goblin_havok, name, a, b, c)
+#define TRACE_PROBE4(name, a, b, c, d) DTRACE_PROBE4(goblin_havok, name, a, b, c, d)
+
+#endif
+
+// Fires 'name__entry' here and 'name__return' when the enclosing scope is left
+#define TRACE_EXPORT(name) \
+	struct TraceExport_##name \
+	{ \
+		TraceExport_##name() { TRACE_PROBE(name##__entry); } \
+		~TraceExport_##name() { TRACE_PROBE(name##__return); } \
+	} traceExport_##name
+
+#else
+
+#define TRACE_DEFINE_PROVIDER()
+#define TRACE_PROBE(name)
+#define TRACE_PROBE1(name, a)
+#define TRACE_PROBE2(name, a, b)
+#define TRACE_PROBE3(name, a, b, c)
+#define TRACE_PROBE4(name, a, b, c, d)
+#define TRACE_EXPORT(name)
+
+#endif